@@ -36,10 +36,11 @@ endif (FFTW_USE_STATIC_LIBS AND NOT MSVC)
       /sw/include
   )
 
+  # the single precision library, the samples are processed as float
   find_library(FFTW_LIBRARY
     NAMES
-      fftw3
-      libfftw3${LIBFFTW_LIB_SUFFIX}
+      fftw3f
+      libfftw3f${LIBFFTW_LIB_SUFFIX}
     PATHS
       /usr/lib
       /usr/local/lib
@@ -60,13 +61,13 @@ endif (FFTW_USE_STATIC_LIBS AND NOT MSVC)
 
   if (FFTW_FOUND)
     if (NOT FFTW_FIND_QUIETLY)
-      message(STATUS "Found libfftw3:")
+      message(STATUS "Found libfftw3f:")
 	  message(STATUS " - Includes: ${FFTW_INCLUDE_DIRS}")
 	  message(STATUS " - Libraries: ${FFTW_LIBRARIES}")
     endif (NOT FFTW_FIND_QUIETLY)
   else (FFTW_FOUND)
     if (FFTW_FIND_REQUIRED)
-      message(FATAL_ERROR "Could not find libfftw3")
+      message(FATAL_ERROR "Could not find libfftw3f")
     endif (FFTW_FIND_REQUIRED)
   endif (FFTW_FOUND)
 
@@ -48,7 +48,7 @@ if(CMAKE_HOST_UNIX AND WIN32)
     message(STATUS "Found dlltool: ${isExists}")
     if("${isExists}" MATCHES "${DLLTOOL}")
         execute_process(
-	    COMMAND ${DLLTOOL} ${LIBEXE_64} -d ${CMAKE_BINARY_DIR}/fftw/libfftw3-3.def -l ${CMAKE_BINARY_DIR}/fftw/libfftw3-3.lib
+	    COMMAND ${DLLTOOL} ${LIBEXE_64} -d ${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.def -l ${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.lib
 	    WORKING_DIRECTORY "${CMAKE_BINARY_DIR}/fftw"
 	    OUTPUT_VARIABLE OutVar
 	    ERROR_VARIABLE ErrVar
@@ -59,7 +59,7 @@ if(CMAKE_HOST_UNIX AND WIN32)
     endif()
 else()
     execute_process(
-	COMMAND "${_vs_bin_path}/lib.exe" ${LIBEXE_64} /def:${CMAKE_BINARY_DIR}/fftw/libfftw3-3.def /out:${CMAKE_BINARY_DIR}/fftw/libfftw3-3.lib
+	COMMAND "${_vs_bin_path}/lib.exe" ${LIBEXE_64} /def:${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.def /out:${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.lib
 	WORKING_DIRECTORY "${CMAKE_BINARY_DIR}/fftw"
 	OUTPUT_VARIABLE OutVar
 	ERROR_VARIABLE ErrVar
@@ -68,14 +68,14 @@ else()
 endif()
 
 
-target_link_libraries(${PROJECT_NAME} "${CMAKE_BINARY_DIR}/fftw/libfftw3-3.lib")
+target_link_libraries(${PROJECT_NAME} "${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.lib")
 target_include_directories(${PROJECT_NAME} PRIVATE "${CMAKE_BINARY_DIR}/fftw")
 
 file(COPY "${CMAKE_BINARY_DIR}/fftw/fftw3.h" DESTINATION "${CMAKE_SOURCE_DIR}/src")
 
 add_custom_command(TARGET ${PROJECT_NAME}
         POST_BUILD
-        COMMAND ${CMAKE_COMMAND} -E copy_if_different "${CMAKE_BINARY_DIR}/fftw/libfftw3-3.dll" $<TARGET_FILE_DIR:${PROJECT_NAME}>
+        COMMAND ${CMAKE_COMMAND} -E copy_if_different "${CMAKE_BINARY_DIR}/fftw/libfftw3f-3.dll" $<TARGET_FILE_DIR:${PROJECT_NAME}>
         COMMENT "Copy fftw3 dlls for ${PROJECT_NAME}"
 )
 
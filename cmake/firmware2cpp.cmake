@@ -0,0 +1,121 @@
+# Converts Intel HEX firmware images into C++ tables of contiguous address/data segments,
+# so the firmware upload neither parses text nor needs a temporary file at runtime.
+#
+# Usage: cmake -DOUTPUT=<file.cpp> -DINPUTS="<a-firmware.hex>;<b-firmware.hex>" -P firmware2cpp.cmake
+# The firmware token of an image is the file name without "-firmware.hex".
+
+set(HEX_DIGITS "0123456789ABCDEF")
+
+# Convert an upper case hex string into a decimal number
+function(hex_to_dec HEX RESULT)
+    set(VALUE 0)
+    string(LENGTH "${HEX}" DIGITS)
+    math(EXPR LAST "${DIGITS} - 1")
+    foreach(INDEX RANGE ${LAST})
+        string(SUBSTRING "${HEX}" ${INDEX} 1 DIGIT)
+        string(FIND "${HEX_DIGITS}" "${DIGIT}" NIBBLE)
+        if(NIBBLE LESS 0)
+            message(FATAL_ERROR "Invalid hex digit '${DIGIT}'")
+        endif()
+        math(EXPR VALUE "${VALUE} * 16 + ${NIBBLE}")
+    endforeach()
+    set(${RESULT} ${VALUE} PARENT_SCOPE)
+endfunction()
+
+set(SOURCE "// Generated by cmake/firmware2cpp.cmake, do not edit.\n\n#include \"usb/firmwareimage.h\"\n\nnamespace {\n")
+set(TABLE "")
+set(IMAGES 0)
+foreach(INPUT ${INPUTS})
+    get_filename_component(NAME "${INPUT}" NAME)
+    string(REPLACE "-firmware.hex" "" TOKEN "${NAME}")
+    string(MAKE_C_IDENTIFIER "${TOKEN}" ID)
+    # file(STRINGS) would decode the records itself, the text is split here
+    file(READ "${INPUT}" CONTENT)
+    string(REGEX MATCHALL "[^\r\n]+" LINES "${CONTENT}")
+
+    set(DATA "")
+    set(SEGMENTS "")
+    set(SEGMENT_COUNT 0)
+    set(OFFSET 0)          # bytes in DATA
+    set(SEGMENT_OFFSET 0)  # start of the open segment in DATA
+    set(SEGMENT_ADDRESS -1)
+    set(SEGMENT_END -1)
+    set(END_SEEN FALSE)
+    foreach(LINE ${LINES})
+        string(STRIP "${LINE}" LINE)
+        string(TOUPPER "${LINE}" LINE)
+        if(LINE STREQUAL "" OR LINE MATCHES "^#") # comment extension of ezusb
+            continue()
+        endif()
+        if(NOT LINE MATCHES "^:([0-9A-F][0-9A-F])([0-9A-F][0-9A-F][0-9A-F][0-9A-F])([0-9A-F][0-9A-F])([0-9A-F]*)([0-9A-F][0-9A-F])$")
+            message(FATAL_ERROR "${NAME}: not an ihex record: ${LINE}")
+        endif()
+        set(RECORD_TYPE ${CMAKE_MATCH_3})
+        set(RECORD_DATA ${CMAKE_MATCH_4})
+        hex_to_dec(${CMAKE_MATCH_1} LENGTH)
+        hex_to_dec(${CMAKE_MATCH_2} ADDRESS)
+        string(LENGTH "${RECORD_DATA}" DATA_DIGITS)
+        math(EXPR EXPECTED "${LENGTH} * 2")
+        if(NOT DATA_DIGITS EQUAL EXPECTED)
+            message(FATAL_ERROR "${NAME}: wrong record length: ${LINE}")
+        endif()
+        # the sum of all bytes including the checksum is 0 modulo 256
+        string(SUBSTRING "${LINE}" 1 -1 BYTES)
+        string(REGEX MATCHALL ".." BYTES "${BYTES}")
+        set(SUM 0)
+        foreach(BYTE ${BYTES})
+            hex_to_dec(${BYTE} VALUE)
+            math(EXPR SUM "(${SUM} + ${VALUE}) % 256")
+        endforeach()
+        if(NOT SUM EQUAL 0)
+            message(FATAL_ERROR "${NAME}: checksum error: ${LINE}")
+        endif()
+        if(RECORD_TYPE STREQUAL "01")
+            set(END_SEEN TRUE)
+            break()
+        endif()
+        if(NOT RECORD_TYPE STREQUAL "00")
+            message(FATAL_ERROR "${NAME}: unsupported record type ${RECORD_TYPE}")
+        endif()
+        if(LENGTH EQUAL 0)
+            continue()
+        endif()
+        # records that continue the open segment are merged into it
+        if(NOT ADDRESS EQUAL SEGMENT_END)
+            if(SEGMENT_ADDRESS GREATER -1)
+                math(EXPR SEGMENT_LENGTH "${OFFSET} - ${SEGMENT_OFFSET}")
+                string(APPEND SEGMENTS "    {${SEGMENT_ADDRESS}, ${SEGMENT_LENGTH}, ${SEGMENT_OFFSET}},\n")
+                math(EXPR SEGMENT_COUNT "${SEGMENT_COUNT} + 1")
+            endif()
+            set(SEGMENT_ADDRESS ${ADDRESS})
+            set(SEGMENT_OFFSET ${OFFSET})
+        endif()
+        math(EXPR SEGMENT_END "${ADDRESS} + ${LENGTH}")
+        math(EXPR OFFSET "${OFFSET} + ${LENGTH}")
+        string(REGEX REPLACE "(..)" "0x\\1," RECORD_BYTES "${RECORD_DATA}")
+        string(APPEND DATA "    ${RECORD_BYTES}\n")
+    endforeach()
+    if(NOT END_SEEN)
+        message(FATAL_ERROR "${NAME}: EOF without EOF record")
+    endif()
+    if(SEGMENT_ADDRESS GREATER -1)
+        math(EXPR SEGMENT_LENGTH "${OFFSET} - ${SEGMENT_OFFSET}")
+        string(APPEND SEGMENTS "    {${SEGMENT_ADDRESS}, ${SEGMENT_LENGTH}, ${SEGMENT_OFFSET}},\n")
+        math(EXPR SEGMENT_COUNT "${SEGMENT_COUNT} + 1")
+    endif()
+
+    string(APPEND SOURCE "\nconst unsigned char ${ID}Data[] = {\n${DATA}};\n")
+    string(APPEND SOURCE "const FirmwareSegment ${ID}Segments[] = {\n${SEGMENTS}};\n")
+    string(APPEND TABLE "    {\"${TOKEN}\", ${ID}Segments, ${SEGMENT_COUNT}, ${ID}Data, ${OFFSET}},\n")
+    math(EXPR IMAGES "${IMAGES} + 1")
+endforeach()
+string(APPEND SOURCE "\n} // namespace\n\nextern const FirmwareImage firmwareImages[] = {\n${TABLE}};\n")
+string(APPEND SOURCE "extern const unsigned firmwareImageCount = ${IMAGES};\n")
+
+# an unchanged file is not written, nothing is recompiled then
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" PREVIOUS)
+endif()
+if(NOT PREVIOUS STREQUAL SOURCE)
+    file(WRITE "${OUTPUT}" "${SOURCE}")
+endif()
@@ -27,6 +27,21 @@ DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) :
     graphGroup = new QGroupBox(tr("Graph"));
     graphGroup->setLayout(graphLayout);
 
+    historyMemoryLabel = new QLabel(tr("Memory"));
+    historyMemorySpinBox = new QSpinBox();
+    historyMemorySpinBox->setMinimum(0);
+    historyMemorySpinBox->setMaximum(HISTORY_MEMORY_MAX);
+    historyMemorySpinBox->setSuffix(tr(" MiB"));
+    historyMemorySpinBox->setSpecialValueText(tr("Off"));
+    historyMemorySpinBox->setValue(int(settings->scope.horizontal.historyMemory));
+
+    historyLayout = new QGridLayout();
+    historyLayout->addWidget(historyMemoryLabel, 0, 0);
+    historyLayout->addWidget(historyMemorySpinBox, 0, 1);
+
+    historyGroup = new QGroupBox(tr("Acquisition history"));
+    historyGroup->setLayout(historyLayout);
+
     cursorsLabel = new QLabel(tr("Position"));
     cursorsComboBox = new QComboBox();
     cursorsComboBox->addItem(tr("Left"), Qt::LeftToolBarArea);
@@ -42,6 +57,7 @@ DsoConfigScopePage::DsoConfigScopePage(DsoSettings *settings, QWidget *parent) :
 
     mainLayout = new QVBoxLayout();
     mainLayout->addWidget(graphGroup);
+    mainLayout->addWidget(historyGroup);
     mainLayout->addWidget(cursorsGroup);
     mainLayout->addStretch(1);
 
@@ -53,4 +69,5 @@ void DsoConfigScopePage::saveSettings() {
     settings->view.interpolation = (Dso::InterpolationMode)interpolationComboBox->currentIndex();
     settings->view.digitalPhosphorDepth = digitalPhosphorDepthSpinBox->value();
     settings->view.cursorGridPosition = (Qt::ToolBarArea)cursorsComboBox->currentData().toUInt();
+    settings->scope.horizontal.historyMemory = unsigned(historyMemorySpinBox->value());
 }
@@ -38,6 +38,11 @@ class DsoConfigScopePage : public QWidget {
     QLabel *interpolationLabel;
     QComboBox *interpolationComboBox;
 
+    QGroupBox *historyGroup;
+    QGridLayout *historyLayout;
+    QLabel *historyMemoryLabel;
+    QSpinBox *historyMemorySpinBox;
+
     QGroupBox *cursorsGroup;
     QGridLayout *cursorsLayout;
     QLabel *cursorsLabel;
@@ -6,6 +6,7 @@
 #include <QDockWidget>
 #include <QLabel>
 #include <QSignalBlocker>
+#include <QSpinBox>
 #include <QCoreApplication>
 #include <QDebug>
 
@@ -64,6 +65,45 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     this->calfreqSiSpinBox->setMinimum(50);
     this->calfreqSiSpinBox->setMaximum(100e3);
 
+    recordLengthSteps << 20000 << 50000 << 100000 << 200000 << 500000 << 1000000 << 2000000 << RECORDLENGTH_MAX;
+
+    this->recordLengthLabel = new QLabel(tr("Record length"));
+    this->recordLengthComboBox = new QComboBox();
+    for (unsigned recordLength : recordLengthSteps)
+        this->recordLengthComboBox->addItem(valueToString(recordLength, UNIT_SAMPLES, -1));
+    this->peakDetectCheckBox = new QCheckBox(tr("Peak detect"));
+
+    this->segmentCountLabel = new QLabel(tr("Segments"));
+    this->segmentCountSpinBox = new QSpinBox();
+    this->segmentCountSpinBox->setRange(0, SEGMENT_COUNT_MAX);
+    this->segmentCountSpinBox->setSpecialValueText(tr("Off"));
+    this->segmentLengthLabel = new QLabel(tr("Segment length"));
+    this->segmentLengthSiSpinBox = new SiSpinBox(UNIT_SAMPLES);
+    this->segmentLengthSiSpinBox->setSteps(timebaseSteps); // 1,2,5,10
+    this->segmentLengthSiSpinBox->setMinimum(SEGMENT_LENGTH_MIN);
+    this->segmentLengthSiSpinBox->setMaximum(RECORDLENGTH_MAX);
+    this->segmentViewLabel = new QLabel(tr("Show segment"));
+    this->segmentViewSpinBox = new QSpinBox();
+    this->segmentViewSpinBox->setSpecialValueText(tr("All"));
+    this->averagingLabel = new QLabel(tr("Average"));
+    this->averagingComboBox = new QComboBox();
+    for (Dso::AveragingMode mode : Dso::AveragingModeEnum)
+        this->averagingComboBox->addItem(Dso::averagingModeString(mode));
+    this->averageCountSpinBox = new QSpinBox();
+    this->averageCountSpinBox->setRange(2, AVERAGE_COUNT_MAX);
+    this->averageCountSpinBox->setSuffix(tr(" frames"));
+    this->etsLabel = new QLabel(tr("ETS"));
+    this->etsSpinBox = new QSpinBox();
+    this->etsSpinBox->setRange(1, ETS_FACTOR_MAX);
+    this->etsSpinBox->setPrefix("x");
+    this->etsSpinBox->setSpecialValueText(tr("Off"));
+    this->etsSpinBox->setToolTip(tr("Equivalent-time sampling of repetitive signals"));
+    this->historyLabel = new QLabel(tr("History"));
+    this->historySpinBox = new QSpinBox();
+    this->historySpinBox->setRange(0, HISTORY_FRAMES_MAX);
+    this->historySpinBox->setPrefix("-");
+    this->historySpinBox->setSpecialValueText(tr("Live"));
+
     this->dockLayout = new QGridLayout();
     this->dockLayout->setColumnMinimumWidth(0, 64);
     this->dockLayout->setColumnStretch(1, 1);
@@ -74,6 +114,22 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     this->dockLayout->addWidget(this->timebaseSiSpinBox, row++, 1);
     this->dockLayout->addWidget(this->samplerateLabel, row, 0);
     this->dockLayout->addWidget(this->samplerateSiSpinBox, row++, 1);
+    this->dockLayout->addWidget(this->recordLengthLabel, row, 0);
+    this->dockLayout->addWidget(this->recordLengthComboBox, row++, 1);
+    this->dockLayout->addWidget(this->peakDetectCheckBox, row++, 1);
+    this->dockLayout->addWidget(this->segmentCountLabel, row, 0);
+    this->dockLayout->addWidget(this->segmentCountSpinBox, row++, 1);
+    this->dockLayout->addWidget(this->segmentLengthLabel, row, 0);
+    this->dockLayout->addWidget(this->segmentLengthSiSpinBox, row++, 1);
+    this->dockLayout->addWidget(this->segmentViewLabel, row, 0);
+    this->dockLayout->addWidget(this->segmentViewSpinBox, row++, 1);
+    this->dockLayout->addWidget(this->averagingLabel, row, 0);
+    this->dockLayout->addWidget(this->averagingComboBox, row++, 1);
+    this->dockLayout->addWidget(this->averageCountSpinBox, row++, 1);
+    this->dockLayout->addWidget(this->etsLabel, row, 0);
+    this->dockLayout->addWidget(this->etsSpinBox, row++, 1);
+    this->dockLayout->addWidget(this->historyLabel, row, 0);
+    this->dockLayout->addWidget(this->historySpinBox, row++, 1);
     this->dockLayout->addWidget(this->frequencybaseLabel, row, 0);
     this->dockLayout->addWidget(this->frequencybaseSiSpinBox, row++, 1);
     this->dockLayout->addWidget(this->formatLabel, row, 0);
@@ -90,8 +146,22 @@ HorizontalDock::HorizontalDock(DsoSettingsScope *scope, QWidget *parent, Qt::Win
     connect(this->frequencybaseSiSpinBox, SELECT<double>::OVERLOAD_OF(&QDoubleSpinBox::valueChanged), this, &HorizontalDock::frequencybaseSelected);
     connect(this->formatComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::formatSelected);
     connect(this->calfreqSiSpinBox, SELECT<double>::OVERLOAD_OF(&QDoubleSpinBox::valueChanged), this, &HorizontalDock::calfreqSelected);
+    connect(this->recordLengthComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::recordLengthSelected);
+    connect(this->peakDetectCheckBox, &QCheckBox::toggled, this, &HorizontalDock::peakDetectSelected);
+    connect(this->segmentCountSpinBox, SELECT<int>::OVERLOAD_OF(&QSpinBox::valueChanged), this, &HorizontalDock::segmentsSelected);
+    connect(this->segmentLengthSiSpinBox, SELECT<double>::OVERLOAD_OF(&QDoubleSpinBox::valueChanged), this, &HorizontalDock::segmentsSelected);
+    connect(this->segmentViewSpinBox, SELECT<int>::OVERLOAD_OF(&QSpinBox::valueChanged), this, &HorizontalDock::segmentViewSelected);
+    connect(this->historySpinBox, SELECT<int>::OVERLOAD_OF(&QSpinBox::valueChanged), this, &HorizontalDock::historySelected);
+    connect(this->etsSpinBox, SELECT<int>::OVERLOAD_OF(&QSpinBox::valueChanged), this, &HorizontalDock::etsSelected);
+    connect(this->averagingComboBox, SELECT<int>::OVERLOAD_OF(&QComboBox::currentIndexChanged), this, &HorizontalDock::averagingSelected);
+    connect(this->averageCountSpinBox, SELECT<int>::OVERLOAD_OF(&QSpinBox::valueChanged), this, &HorizontalDock::averagingSelected);
 
     // Set values
+    this->setRecordLength(scope->horizontal.recordLength);
+    this->setPeakDetect(scope->horizontal.peakDetect);
+    this->setSegments(scope->horizontal.segmentCount, scope->horizontal.segmentLength);
+    this->setEts(scope->horizontal.etsFactor);
+    this->setAveraging(scope->horizontal.averaging, scope->horizontal.averageCount);
     this->setSamplerate(scope->horizontal.samplerate);
     this->setTimebase(scope->horizontal.timebase);
     this->setFrequencybase(scope->horizontal.frequencybase);
@@ -144,6 +214,62 @@ double HorizontalDock::setTimebase(double timebase) {
 }
 
 
+void HorizontalDock::setRecordLength(unsigned int recordLength) {
+    QSignalBlocker blocker(recordLengthComboBox);
+    int index = recordLengthSteps.indexOf(recordLength);
+    if (index < 0) // unsupported value from an old config file
+        index = 0;
+    recordLengthComboBox->setCurrentIndex(index);
+    scope->horizontal.recordLength = recordLengthSteps.at(index);
+}
+
+
+void HorizontalDock::setPeakDetect(bool peakDetect) {
+    QSignalBlocker blocker(peakDetectCheckBox);
+    peakDetectCheckBox->setChecked(peakDetect);
+    scope->horizontal.peakDetect = peakDetect;
+}
+
+
+void HorizontalDock::setSegments(unsigned count, unsigned length) {
+    QSignalBlocker countBlocker(segmentCountSpinBox);
+    QSignalBlocker lengthBlocker(segmentLengthSiSpinBox);
+    segmentLengthSiSpinBox->setValue(length);
+    // the memory for the segments is limited
+    const unsigned countMax = unsigned(SEGMENT_ARENA_MAX) / unsigned(segmentLengthSiSpinBox->value());
+    segmentCountSpinBox->setMaximum(int(qMin(unsigned(SEGMENT_COUNT_MAX), countMax)));
+    segmentCountSpinBox->setValue(int(count));
+    scope->horizontal.segmentCount = unsigned(segmentCountSpinBox->value());
+    scope->horizontal.segmentLength = unsigned(segmentLengthSiSpinBox->value());
+    segmentViewSpinBox->setEnabled(scope->horizontal.segmentCount > 0);
+    segmentViewSpinBox->setMaximum(segmentCountSpinBox->value()); // numbered from 1, 0 shows all
+}
+
+
+void HorizontalDock::setEts(unsigned factor) {
+    QSignalBlocker blocker(etsSpinBox);
+    etsSpinBox->setValue(int(factor));
+    scope->horizontal.etsFactor = unsigned(etsSpinBox->value());
+}
+
+
+void HorizontalDock::setAveraging(Dso::AveragingMode mode, unsigned count) {
+    QSignalBlocker modeBlocker(averagingComboBox);
+    QSignalBlocker countBlocker(averageCountSpinBox);
+    averagingComboBox->setCurrentIndex(int(mode));
+    averageCountSpinBox->setValue(int(count));
+    averageCountSpinBox->setEnabled(mode != Dso::AveragingMode::Off);
+    scope->horizontal.averaging = mode;
+    scope->horizontal.averageCount = unsigned(averageCountSpinBox->value());
+}
+
+
+void HorizontalDock::setHistory(unsigned age) {
+    QSignalBlocker blocker(historySpinBox);
+    historySpinBox->setValue(int(age));
+}
+
+
 int HorizontalDock::setFormat(Dso::GraphFormat format) {
     QSignalBlocker blocker(formatComboBox);
     if (format >= Dso::GraphFormat::TY && format <= Dso::GraphFormat::XY) {
@@ -183,9 +309,8 @@ void HorizontalDock::setSamplerateSteps(int mode, const QList<double> steps) {
     // Make reasonable adjustments to the timebase spinbox
     QSignalBlocker timebaseBlocker(timebaseSiSpinBox);
     timebaseSiSpinBox->setMinimum( pow( 10, floor( log10( 1.0 / steps.last() ) ) ) );
-    // max 1000 ms
-    double maxTime = pow(10, ceil(log10(1000.0 / (steps.first()))));
-    timebaseSiSpinBox->setMaximum( maxTime );
+    // the slow timebases scroll in roll mode
+    timebaseSiSpinBox->setMaximum( TIMEBASE_MAX );
     calculateSamplerateSteps( timebaseSiSpinBox->value() );
 }
 
@@ -233,8 +358,8 @@ void HorizontalDock::calculateSamplerateSteps(double timebase) {
             }
             // max must be > minRate
             // find max samplesrate to get not more then this number of samples per div
-            // number should be <= 1000 to get enough samples for two full screens (to ensure triggering)
-            if ( id && sRate * timebase <= 1000 ) {
+            // at most half of the record on screen to get enough samples for two full screens (to ensure triggering)
+            if ( id && sRate * timebase * DIVS_TIME <= scope->horizontal.recordLength / 2 ) {
                 max = sRate;
             }
         }
@@ -252,6 +377,57 @@ void HorizontalDock::formatSelected(int index) {
 }
 
 
+/// \brief Called when the record length combo box changes its value.
+/// \param index The index of the combo box item.
+void HorizontalDock::recordLengthSelected(int index) {
+    if (index < 0)
+        return;
+    scope->horizontal.recordLength = recordLengthSteps.at(index);
+    calculateSamplerateSteps( scope->horizontal.timebase );
+    emit recordLengthChanged(scope->horizontal.recordLength);
+}
+
+
+/// \brief Called when the peak detect check box is toggled.
+/// \param checked true if the peak detect mode is enabled.
+void HorizontalDock::peakDetectSelected(bool checked) {
+    scope->horizontal.peakDetect = checked;
+    emit peakDetectChanged(checked);
+}
+
+
+/// \brief Called when the segment count or length spinbox changes its value.
+void HorizontalDock::segmentsSelected() {
+    setSegments(unsigned(segmentCountSpinBox->value()), unsigned(segmentLengthSiSpinBox->value()));
+    emit segmentsChanged(scope->horizontal.segmentCount, scope->horizontal.segmentLength);
+}
+
+
+/// \brief Called when the shown segment spinbox changes its value.
+/// \param segment The segment number starting with 1, 0 for all segments.
+void HorizontalDock::segmentViewSelected(int segment) { emit segmentViewChanged(segment - 1); }
+
+
+/// \brief Called when the averaging mode or the frame count changes.
+void HorizontalDock::averagingSelected() {
+    setAveraging(Dso::AveragingMode(averagingComboBox->currentIndex()), unsigned(averageCountSpinBox->value()));
+    emit averagingChanged(scope->horizontal.averaging, scope->horizontal.averageCount);
+}
+
+
+/// \brief Called when the ETS spinbox changes its value.
+/// \param factor The bins per sample interval, 1 switches the equivalent-time sampling off.
+void HorizontalDock::etsSelected(int factor) {
+    scope->horizontal.etsFactor = unsigned(factor);
+    emit etsChanged(unsigned(factor));
+}
+
+
+/// \brief Called when the history spinbox changes its value.
+/// \param age 1 for the last acquisition, 2 for the one before, ... 0 for the live acquisition.
+void HorizontalDock::historySelected(int age) { emit historyChanged(unsigned(age)); }
+
+
 /// \brief Called when the calfreq spinbox changes its value.
 /// \param calfreq The calibration frequency in hertz.
 void HorizontalDock::calfreqSelected(double calfreq) {
@@ -12,6 +12,7 @@
 class QLabel;
 class QCheckBox;
 class QComboBox;
+class QSpinBox;
 
 class SiSpinBox;
 
@@ -44,6 +45,22 @@ class HorizontalDock : public QDockWidget {
     /// \brief Changes the record length if the new value is supported.
     /// \param recordLength The record length in samples.
     void setRecordLength(unsigned int recordLength);
+    /// \brief Enables or disables the peak detect mode.
+    /// \param peakDetect true if the min/max envelope should be shown.
+    void setPeakDetect(bool peakDetect);
+    /// \brief Changes the setup of the segmented acquisition.
+    /// \param count The number of segments, 0 if the segmented mode is off.
+    /// \param length The samples per channel of one segment.
+    void setSegments(unsigned count, unsigned length);
+    /// \brief Selects the shown acquisition of the history.
+    /// \param age 1 is the last acquisition, 2 the one before, ... 0 is the live acquisition.
+    void setHistory(unsigned age);
+    /// \brief Changes the equivalent-time sampling.
+    /// \param factor The bins per sample interval, 1 if the equivalent-time sampling is off.
+    void setEts(unsigned factor);
+    /// \brief Changes the averaging of the triggered frames.
+    /// \param count The number of averaged frames.
+    void setAveraging(Dso::AveragingMode mode, unsigned count);
     /// \brief Changes the format if the new value is supported.
     /// \param format The format for the horizontal axis.
     /// \return Index of format-value, -1 on error.
@@ -70,17 +87,34 @@ class HorizontalDock : public QDockWidget {
     QLabel *frequencybaseLabel;        ///< The label for the frequencybase spinbox
     QLabel *formatLabel;               ///< The label for the format combobox
     QLabel *calfreqLabel;              ///< The label for the calibration frequency spinbox
+    QLabel *recordLengthLabel;         ///< The label for the record length combobox
+    QLabel *segmentCountLabel;         ///< The label for the segment count spinbox
+    QLabel *segmentLengthLabel;        ///< The label for the segment length spinbox
+    QLabel *segmentViewLabel;          ///< The label for the shown segment spinbox
+    QLabel *historyLabel;              ///< The label for the history spinbox
+    QLabel *etsLabel;                  ///< The label for the ETS spinbox
+    QLabel *averagingLabel;            ///< The label for the averaging combobox
     SiSpinBox *samplerateSiSpinBox;    ///< Selects the samplerate for aquisitions
     SiSpinBox *timebaseSiSpinBox;      ///< Selects the timebase for voltage graphs
     SiSpinBox *frequencybaseSiSpinBox; ///< Selects the frequencybase for spectrum graphs
     QComboBox *formatComboBox;         ///< Selects the way the sampled data is
                                        ///  interpreted and shown
     SiSpinBox *calfreqSiSpinBox;       ///< Selects the calibration frequency
+    QComboBox *recordLengthComboBox;   ///< Selects the number of samples per acquisition
+    QCheckBox *peakDetectCheckBox;     ///< Keeps glitches visible when downsampling
+    QSpinBox *segmentCountSpinBox;     ///< Selects the number of segments, 0 = off
+    SiSpinBox *segmentLengthSiSpinBox; ///< Selects the samples of one segment
+    QSpinBox *segmentViewSpinBox;      ///< Selects the shown segment, 0 = all
+    QSpinBox *historySpinBox;          ///< Selects the shown acquisition of the history, 0 = live
+    QSpinBox *etsSpinBox;              ///< Selects the equivalent-time sampling factor, 1 = off
+    QComboBox *averagingComboBox;      ///< Selects the averaging mode
+    QSpinBox *averageCountSpinBox;     ///< Selects the number of averaged frames
 
     DsoSettingsScope *scope;           ///< The settings provided by the parent class
     QList<double> timebaseSteps;       ///< Steps for the timebase spinbox
     QList<double> calfreqSteps;        ///< Steps for the calfreq spinbox
     QList<double> samplerateSteps;     ///< Possible sampe rates
+    QList<unsigned> recordLengthSteps; ///< Selectable record lengths
 
     QStringList formatStrings;         ///< Strings for the formats
 
@@ -90,12 +124,25 @@ class HorizontalDock : public QDockWidget {
     void timebaseSelected(double timebase);
     void formatSelected(int index);
     void calfreqSelected(double calfreq);
+    void recordLengthSelected(int index);
+    void peakDetectSelected(bool checked);
+    void segmentsSelected();
+    void segmentViewSelected(int segment);
+    void historySelected(int age);
+    void etsSelected(int factor);
+    void averagingSelected();
 
   signals:
     void frequencybaseChanged(double frequencybase);      ///< The frequencybase has been changed
     void samplerateChanged(double samplerate);            ///< The samplerate has been changed
     void timebaseChanged(double timebase);                ///< The timebase has been changed
-    void recordLengthChanged(unsigned long recordLength); ///< The recordd length has been changed
+    void recordLengthChanged(unsigned long recordLength); ///< The record length has been changed
+    void peakDetectChanged(bool peakDetect);              ///< The peak detect mode has been changed
+    void segmentsChanged(unsigned count, unsigned length); ///< The segmented acquisition has been changed
+    void segmentViewChanged(int segment);                 ///< The shown segment has been changed, < 0 = all
+    void historyChanged(unsigned age);                    ///< The shown acquisition has been changed, 0 = live
+    void etsChanged(unsigned factor);                     ///< The equivalent-time sampling has been changed
+    void averagingChanged(Dso::AveragingMode mode, unsigned count); ///< The averaging has been changed
     void formatChanged(Dso::GraphFormat format);          ///< The viewing format has been changed
     void calfreqChanged(double calfreq);                  ///< The timebase has been changed
 };
@@ -42,6 +42,30 @@ TriggerDock::TriggerDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
     this->sourceComboBox = new QComboBox();
     this->sourceComboBox->addItems(this->sourceStandardStrings);
 
+    this->typeLabel = new QLabel(tr("Type"));
+    this->typeComboBox = new QComboBox();
+    for (Dso::TriggerType type : Dso::TriggerTypeEnum) this->typeComboBox->addItem(Dso::triggerTypeString(type));
+
+    this->conditionLabel = new QLabel(tr("Condition"));
+    this->conditionComboBox = new QComboBox();
+
+    this->timeLabel = new QLabel(tr("Time"));
+    this->timeSiSpinBox = new SiSpinBox(UNIT_SECONDS);
+    this->timeSiSpinBox->setMinimum(1e-8);
+    this->timeSiSpinBox->setMaximum(10);
+    this->timeUpperLabel = new QLabel(tr("Upper time"));
+    this->timeUpperSiSpinBox = new SiSpinBox(UNIT_SECONDS);
+    this->timeUpperSiSpinBox->setMinimum(1e-8);
+    this->timeUpperSiSpinBox->setMaximum(10);
+
+    this->secondLevelLabel = new QLabel(tr("Level 2"));
+    this->secondLevelSiSpinBox = new SiSpinBox(UNIT_VOLTS);
+    this->secondLevelSiSpinBox->setMinimum(-1000);
+    this->secondLevelSiSpinBox->setMaximum(1000);
+
+    this->fastAcquisitionCheckBox = new QCheckBox(tr("Fast acquisition"));
+    this->fastAcquisitionCheckBox->setToolTip(tr("Overlay all trigger events of each acquisition"));
+
     this->dockLayout = new QGridLayout();
     this->dockLayout->setColumnMinimumWidth(0, 64);
     this->dockLayout->setColumnStretch(1, 1);
@@ -52,6 +76,17 @@ TriggerDock::TriggerDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
     this->dockLayout->addWidget(this->sourceComboBox, 1, 1);
     this->dockLayout->addWidget(this->slopeLabel, 2, 0);
     this->dockLayout->addWidget(this->slopeComboBox, 2, 1);
+    this->dockLayout->addWidget(this->typeLabel, 3, 0);
+    this->dockLayout->addWidget(this->typeComboBox, 3, 1);
+    this->dockLayout->addWidget(this->conditionLabel, 4, 0);
+    this->dockLayout->addWidget(this->conditionComboBox, 4, 1);
+    this->dockLayout->addWidget(this->timeLabel, 5, 0);
+    this->dockLayout->addWidget(this->timeSiSpinBox, 5, 1);
+    this->dockLayout->addWidget(this->timeUpperLabel, 6, 0);
+    this->dockLayout->addWidget(this->timeUpperSiSpinBox, 6, 1);
+    this->dockLayout->addWidget(this->secondLevelLabel, 7, 0);
+    this->dockLayout->addWidget(this->secondLevelSiSpinBox, 7, 1);
+    this->dockLayout->addWidget(this->fastAcquisitionCheckBox, 8, 1);
 
     this->dockWidget = new QWidget();
     SetupDockWidget(this, dockWidget, dockLayout);
@@ -60,6 +95,10 @@ TriggerDock::TriggerDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
     setMode(scope->trigger.mode);
     setSlope(scope->trigger.slope);
     setSource(scope->trigger.source);
+    setType(scope->trigger.type);
+    setCondition(scope->trigger.condition, scope->trigger.time, scope->trigger.timeUpper);
+    setSecondLevel(scope->trigger.secondLevel);
+    setFastAcquisition(scope->trigger.fastAcquisition);
 
     // Connect signals and slots
     connect(this->modeComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
@@ -78,6 +117,40 @@ TriggerDock::TriggerDock(DsoSettingsScope *scope, const Dso::ControlSpecificatio
                 this->scope->trigger.source = (unsigned)index & (mSpec->channels - 1) ;
                 emit sourceChanged((unsigned)index & (mSpec->channels - 1), smooth );
             });
+    connect(this->typeComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                this->scope->trigger.type = (Dso::TriggerType)index;
+                updateTypeControls(); // may change the condition
+                emit typeChanged(this->scope->trigger.type);
+                emit conditionChanged(this->scope->trigger.condition, this->scope->trigger.time,
+                                      this->scope->trigger.timeUpper);
+            });
+    connect(this->conditionComboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            [this](int index) {
+                this->scope->trigger.condition = (Dso::TriggerCondition)conditionComboBox->itemData(index).toInt();
+                updateTypeControls();
+                emit conditionChanged(this->scope->trigger.condition, this->scope->trigger.time,
+                                      this->scope->trigger.timeUpper);
+            });
+    connect(this->timeSiSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) {
+                this->scope->trigger.time = value;
+                emit conditionChanged(this->scope->trigger.condition, value, this->scope->trigger.timeUpper);
+            });
+    connect(this->timeUpperSiSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) {
+                this->scope->trigger.timeUpper = value;
+                emit conditionChanged(this->scope->trigger.condition, this->scope->trigger.time, value);
+            });
+    connect(this->secondLevelSiSpinBox, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
+            [this](double value) {
+                this->scope->trigger.secondLevel = value;
+                emit secondLevelChanged(value);
+            });
+    connect(this->fastAcquisitionCheckBox, &QCheckBox::toggled, [this](bool checked) {
+        this->scope->trigger.fastAcquisition = checked;
+        emit fastAcquisitionChanged(checked);
+    });
 }
 
 /// \brief Don't close the dock, just hide it
@@ -105,3 +178,57 @@ void TriggerDock::setSource(unsigned int id) {
     QSignalBlocker blocker(sourceComboBox);
     sourceComboBox->setCurrentIndex(id);
 }
+
+void TriggerDock::setType(Dso::TriggerType type) {
+    QSignalBlocker blocker(typeComboBox);
+    typeComboBox->setCurrentIndex((int)type);
+    updateTypeControls();
+}
+
+void TriggerDock::setCondition(Dso::TriggerCondition condition, double time, double timeUpper) {
+    QSignalBlocker conditionBlocker(conditionComboBox);
+    QSignalBlocker timeBlocker(timeSiSpinBox);
+    QSignalBlocker timeUpperBlocker(timeUpperSiSpinBox);
+    int index = conditionComboBox->findData((int)condition);
+    if (index >= 0)
+        conditionComboBox->setCurrentIndex(index);
+    timeSiSpinBox->setValue(time);
+    timeUpperSiSpinBox->setValue(timeUpper);
+    updateTypeControls();
+}
+
+void TriggerDock::setSecondLevel(double level) {
+    QSignalBlocker blocker(secondLevelSiSpinBox);
+    secondLevelSiSpinBox->setValue(level);
+}
+
+void TriggerDock::setFastAcquisition(bool enabled) {
+    QSignalBlocker blocker(fastAcquisitionCheckBox);
+    fastAcquisitionCheckBox->setChecked(enabled);
+}
+
+void TriggerDock::updateTypeControls() {
+    const Dso::TriggerType type = scope->trigger.type;
+    {
+        // the pulse width compares with one or two times, the window is entered (Inside) or left (Outside)
+        QSignalBlocker blocker(conditionComboBox);
+        conditionComboBox->clear();
+        for (Dso::TriggerCondition condition : Dso::TriggerConditionEnum) {
+            if (type == Dso::TriggerType::PulseWidth ||
+                (type == Dso::TriggerType::Window && condition >= Dso::TriggerCondition::Inside))
+                conditionComboBox->addItem(Dso::triggerConditionString(condition), (int)condition);
+        }
+        int index = conditionComboBox->findData((int)scope->trigger.condition);
+        if (index < 0 && conditionComboBox->count()) { // the condition does not apply to this type
+            index = 0;
+            scope->trigger.condition = (Dso::TriggerCondition)conditionComboBox->itemData(index).toInt();
+        }
+        conditionComboBox->setCurrentIndex(index);
+    }
+    const bool twoTimes = scope->trigger.condition == Dso::TriggerCondition::Inside ||
+                          scope->trigger.condition == Dso::TriggerCondition::Outside;
+    conditionComboBox->setEnabled(conditionComboBox->count() > 0);
+    timeSiSpinBox->setEnabled(type == Dso::TriggerType::PulseWidth || type == Dso::TriggerType::Timeout);
+    timeUpperSiSpinBox->setEnabled(type == Dso::TriggerType::PulseWidth && twoTimes);
+    secondLevelSiSpinBox->setEnabled(type == Dso::TriggerType::Runt || type == Dso::TriggerType::Window);
+}
@@ -17,7 +17,7 @@ struct ControlSpecification;
 }
 
 /// \brief Dock window for the trigger settings.
-/// It contains the settings for the trigger mode, source and slope.
+/// It contains the settings for the trigger mode, source and slope and the advanced trigger types.
 class TriggerDock : public QDockWidget {
     Q_OBJECT
 
@@ -41,9 +41,26 @@ class TriggerDock : public QDockWidget {
     /// \param slope The trigger slope.
     void setSlope(Dso::Slope slope);
 
+    /// \brief Changes the trigger type and enables the controls it uses.
+    void setType(Dso::TriggerType type);
+
+    /// \brief Changes the condition of the pulse width and window triggers.
+    /// \param time The pulse width limit or the timeout in s.
+    /// \param timeUpper The upper pulse width limit in s.
+    void setCondition(Dso::TriggerCondition condition, double time, double timeUpper);
+
+    /// \brief Changes the second level of the runt and window band.
+    void setSecondLevel(double level);
+
+    /// \brief Enables the overlay of all trigger events of a block.
+    void setFastAcquisition(bool enabled);
+
   protected:
     void closeEvent(QCloseEvent *event);
 
+    /// \brief Fill the condition combobox with the conditions of the type and enable the controls it uses.
+    void updateTypeControls();
+
     QGridLayout *dockLayout;   ///< The main layout for the dock window
     QWidget *dockWidget;       ///< The main widget for the dock window
     QLabel *modeLabel;         ///< The label for the trigger mode combobox
@@ -52,6 +69,17 @@ class TriggerDock : public QDockWidget {
     QComboBox *modeComboBox;   ///< Select the triggering mode
     QComboBox *sourceComboBox; ///< Select the source for triggering
     QComboBox *slopeComboBox;  ///< Select the slope that causes triggering
+    QLabel *typeLabel;         ///< The label for the trigger type combobox
+    QComboBox *typeComboBox;   ///< Select the event that causes triggering
+    QLabel *conditionLabel;    ///< The label for the condition combobox
+    QComboBox *conditionComboBox; ///< Select the pulse width or window condition
+    QLabel *timeLabel;         ///< The label for the time spinbox
+    SiSpinBox *timeSiSpinBox;  ///< The pulse width limit or the timeout
+    QLabel *timeUpperLabel;    ///< The label for the upper time spinbox
+    SiSpinBox *timeUpperSiSpinBox; ///< The upper pulse width limit
+    QLabel *secondLevelLabel;  ///< The label for the second level spinbox
+    SiSpinBox *secondLevelSiSpinBox; ///< The other level of the runt and window band
+    QCheckBox *fastAcquisitionCheckBox; ///< Overlay all trigger events of a block
 
     DsoSettingsScope *scope; ///< The settings provided by the parent class
     const Dso::ControlSpecification* mSpec;
@@ -62,4 +90,8 @@ signals:
     void modeChanged(Dso::TriggerMode);     ///< The trigger mode has been changed
     void sourceChanged(unsigned int id, bool smooth);    ///< The trigger source has been changed
     void slopeChanged(Dso::Slope);          ///< The trigger slope has been changed
+    void typeChanged(Dso::TriggerType);     ///< The trigger type has been changed
+    void conditionChanged(Dso::TriggerCondition condition, double time, double timeUpper); ///< Condition or times changed
+    void secondLevelChanged(double level);  ///< The second level of the band has been changed
+    void fastAcquisitionChanged(bool enabled); ///< The fast acquisition has been switched on or off
 };
@@ -506,6 +506,12 @@ void DsoWidget::updateTriggerDetails() {
     else if ( scope->trigger.slope == Dso::Slope::Negative )
         post = Dso::slopeString( Dso::Slope:: Positive );
     QString pulseWidthString = pulseWidth ? pre + valueToString( pulseWidth, UNIT_SECONDS, 3) + post : "";
+    if ( triggerEvents > 1 ) { // fast acquisition or segment overlay
+        if ( pulseWidthMax > pulseWidthMin )
+            pulseWidthString += tr( " (%1 .. %2)" ).arg( valueToString( pulseWidthMin, UNIT_SECONDS, 3 ),
+                                                         valueToString( pulseWidthMax, UNIT_SECONDS, 3 ) );
+        pulseWidthString += tr( "  %1 events" ).arg( triggerEvents );
+    }
     settingsTriggerLabel->setText( tr( "%1  %2  %3  %4  %5" )
                                       .arg( scope->voltage[scope->trigger.source].name,
                                             Dso::slopeString(scope->trigger.slope),
@@ -679,7 +685,16 @@ void DsoWidget::showNew(std::shared_ptr<PPresult> data) {
     swTriggerStatus->setPalette(triggerLabelPalette);
     swTriggerStatus->setVisible(true);
     updateRecordLength(dotsOnScreen);
+    if ( data->etsCoverage > 0 ) // the grid is complete at 100%
+        settingsSamplesOnScreen->setText( settingsSamplesOnScreen->text() +
+                                          tr( ", ETS %1%" ).arg( int( data->etsCoverage * 100 ) ) );
+    if ( data->averagedFrames )
+        settingsSamplesOnScreen->setText( settingsSamplesOnScreen->text() +
+                                          tr( ", avg %1" ).arg( data->averagedFrames ) );
     pulseWidth = data.get()->data( 0 )->pulseWidth;
+    triggerEvents = data->triggerEvents;
+    pulseWidthMin = data->pulseWidthMin;
+    pulseWidthMax = data->pulseWidthMax;
     updateTriggerDetails();
     for (ChannelID channel = 0; channel < scope->voltage.size(); ++channel) {
         if (scope->voltage[channel].used && data.get()->data(channel)) {
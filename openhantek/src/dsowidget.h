@@ -39,6 +39,8 @@ class DsoWidget : public QWidget {
 
     // Data arrived
     void showNew(std::shared_ptr<PPresult> data);
+    /// \brief Count the painted frames in the counters of the device that paces.
+    void setFrameCounters(Dso::FrameCounters *counters) { mainScope->setFrameCounters(counters); }
 
   protected:
     virtual void showEvent(QShowEvent *event);
@@ -101,6 +103,9 @@ class DsoWidget : public QWidget {
     double timebase;
     unsigned int dotsOnScreen;
     double pulseWidth = 0.0;
+    unsigned triggerEvents = 0;  ///< Trigger events of the shown envelope
+    double pulseWidthMin = 0.0;  ///< Pulse width range of these events
+    double pulseWidthMax = 0.0;
 
   public slots:
     // Horizontal axis
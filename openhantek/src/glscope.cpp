@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0+
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -17,6 +18,8 @@
 
 #include "glscope.h"
 
+#include "hantekdso/framestatistics.h"
+
 #include "post/graphgenerator.h"
 #include "post/ppresult.h"
 #include "scopesettings.h"
@@ -328,6 +331,12 @@ void GlScope::showData(std::shared_ptr<PPresult> data) {
     m_GraphHistory.front().writeData(data.get(), m_program.get(), vertexLocation);
     // doneCurrent();
 
+    if (!zoomed && data->timing.sequence != lastFrame) {
+        lastFrame = data->timing.sequence;
+        lastReceived = data->timing.received;
+        ++unpaintedFrames;
+    }
+
     update();
 }
 
@@ -429,6 +438,15 @@ void GlScope::paintGL() {
 
     drawGrid();
     m_program->release();
+
+    if (unpaintedFrames && frameCounters) { // frames that fell out of the phosphor history were never visible
+        const unsigned painted = std::min(unpaintedFrames, unsigned(m_GraphHistory.size()));
+        frameCounters->rendered.fetchAndAddRelaxed(painted);
+        frameCounters->notRendered.fetchAndAddRelaxed(unpaintedFrames - painted);
+        if (lastReceived)
+            frameCounters->renderAge.store(Dso::monotonicTime() - lastReceived);
+        unpaintedFrames = 0;
+    }
 }
 
 void GlScope::resizeGL(int width, int height) {
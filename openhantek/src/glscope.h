@@ -14,6 +14,7 @@
 
 #include "glscopegraph.h"
 #include "hantekdso/enums.h"
+#include "hantekdso/framestatistics.h"
 #include "hantekprotocol/types.h"
 
 struct DsoSettingsView;
@@ -42,6 +43,8 @@ class GlScope : public QOpenGLWidget {
      */
     void showData(std::shared_ptr<PPresult> data);
     void updateCursor(unsigned index = 0);
+    /// \brief Count the painted frames, only done by the main scope.
+    void setFrameCounters(Dso::FrameCounters *counters) { frameCounters = counters; }
     void cursorSelected(unsigned index) { selectedCursor = index; updateCursor(index); }
 
   protected:
@@ -87,6 +90,12 @@ class GlScope : public QOpenGLWidget {
     DsoSettingsView *view;
     bool zoomed = false;
 
+    // Frame accounting, only done by the main scope
+    Dso::FrameCounters *frameCounters = nullptr; ///< The counters of the device that paces
+    unsigned long long lastFrame = 0; ///< Sequence number of the last shown frame
+    unsigned unpaintedFrames = 0;     ///< Frames shown since the last paint
+    qint64 lastReceived = 0;          ///< Acquisition time of the last shown frame
+
     // Marker
     const unsigned NO_MARKER = UINT_MAX;
     #pragma pack(push, 1)
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "acquisitionhistory.h"
+#include "bufferpool.h"
+
+namespace Dso {
+
+void AcquisitionHistory::configure(size_t bytes, unsigned frames) {
+    std::vector<unsigned char> newRing(bytes);
+    ring.swap(newRing);
+    std::vector<Slot> newFrames(bytes ? frames : 0);
+    this->frames.swap(newFrames);
+    reserved.store(0);
+    recorded.store(0);
+}
+
+
+bool AcquisitionHistory::record(const RawBuffer &rawData, const HistoryFrame &frame) {
+    const size_t size = rawData.size();
+    if (ring.empty() || size > ring.size())
+        return false;
+    const quint64 number = recorded.load() + 1;
+    const quint64 start = reserved.load();
+    Slot &slot = frames[(number - 1) % frames.size()];
+    // invalidate the slot and the bytes before they are overwritten, a reader that copied them fails its check
+    slot.number.store(0);
+    reserved.store(start + size);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t position = size_t(start % ring.size());
+    for (size_t chunk = 0; chunk < rawData.chunkCount(); ++chunk) {
+        const unsigned char *data = rawData.chunk(chunk);
+        size_t count = rawData.chunkSize(chunk);
+        while (count) { // wrap around at the end of the ring
+            const size_t part = std::min(count, ring.size() - position);
+            memcpy(ring.data() + position, data, part);
+            position = (position + part) % ring.size();
+            data += part;
+            count -= part;
+        }
+    }
+    slot.frame = frame;
+    slot.frame.number = number;
+    slot.frame.start = start;
+    slot.frame.size = size;
+    slot.number.storeRelease(number);
+    recorded.storeRelease(number);
+    return true;
+}
+
+
+bool AcquisitionHistory::frame(unsigned age, HistoryFrame &frame) const {
+    const quint64 last = recorded.loadAcquire();
+    if (frames.empty() || age >= last || age >= frames.size())
+        return false;
+    const quint64 number = last - age;
+    const Slot &slot = frames[(number - 1) % frames.size()];
+    if (slot.number.loadAcquire() != number)
+        return false;
+    frame = slot.frame;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.number.load() == number && isIntact(frame.start);
+}
+
+
+bool AcquisitionHistory::copy(const HistoryFrame &frame, RawBuffer &rawData) const {
+    if (ring.empty() || frame.size > rawData.capacity() || !isIntact(frame.start))
+        return false;
+    rawData.resize(frame.size);
+    size_t position = size_t(frame.start % ring.size());
+    for (size_t chunk = 0; chunk < rawData.chunkCount(); ++chunk) {
+        unsigned char *data = rawData.chunk(chunk);
+        size_t count = rawData.chunkSize(chunk);
+        while (count) {
+            const size_t part = std::min(count, ring.size() - position);
+            memcpy(data, ring.data() + position, part);
+            position = (position + part) % ring.size();
+            data += part;
+            count -= part;
+        }
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return isIntact(frame.start);
+}
+
+} // namespace Dso
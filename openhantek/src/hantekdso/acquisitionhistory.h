@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <vector>
+
+#include "framestatistics.h"
+#include "rawconverter.h"
+
+namespace Dso {
+
+class RawBuffer;
+
+/// \brief A stored acquisition: where its raw data is and how it was converted.
+struct HistoryFrame {
+    ConversionParameters conversion; ///< Parameters to convert the raw data again
+    int triggerPosition = 0;         ///< The trigger position found in the live data, 0 = not triggered
+    double triggerFraction = 0.0;    ///< The sub-sample position of the trigger crossing
+    double pulseWidth = 0.0;         ///< The width of the triggered pulse
+    bool corrupted = false;          ///< The acquisition had a gap
+    FrameTiming timing;              ///< Sequence number and timestamps of the live frame
+    // set by AcquisitionHistory::record()
+    quint64 number = 0; ///< Consecutive number in the history, starts with 1
+    quint64 start = 0;  ///< Logical byte position in the ring
+    size_t size = 0;    ///< Raw bytes of the acquisition
+};
+
+/// \brief Bounded history of the last acquisitions, stored as raw 8 bit data.
+/// The raw bytes are kept in one ring of a fixed memory budget, the oldest acquisitions are
+/// overwritten. The single writer never waits: it invalidates the space it is going to overwrite
+/// before writing it. A reader copies a frame and checks afterwards that the writer did not touch
+/// it in the meantime (sequence lock), an overwritten frame is reported as not available.
+class AcquisitionHistory {
+  public:
+    /// \brief Allocate the memory of the history, the stored frames are discarded.
+    /// Neither the writer nor a reader may be active.
+    /// \param bytes The memory budget for the raw data, 0 switches the history off.
+    /// \param frames The most acquisitions that are kept, independent of their size.
+    void configure(size_t bytes, unsigned frames);
+
+    inline size_t capacity() const { return ring.size(); }
+
+    /// \brief Store the raw bytes of an acquisition with its conversion parameters.
+    /// Lock-free, only one thread may record.
+    /// \return false, if the history is off or the acquisition is larger than the memory.
+    bool record(const RawBuffer &rawData, const HistoryFrame &frame);
+
+    /// \brief Get the parameters of a stored acquisition.
+    /// \param age 0 is the last recorded acquisition, 1 the one before, ...
+    /// \return false, if the acquisition is not or no longer available.
+    bool frame(unsigned age, HistoryFrame &frame) const;
+
+    /// \brief Copy the raw data of a frame returned by frame().
+    /// \param rawData Receives the data, its capacity must be at least frame.size.
+    /// \return false, if the writer has overwritten the data in the meantime.
+    bool copy(const HistoryFrame &frame, RawBuffer &rawData) const;
+
+  private:
+    struct Slot {
+        QAtomicInteger<quint64> number; ///< The frame number of the stored frame, 0 while it is written
+        HistoryFrame frame;
+    };
+
+    /// \return true, if the bytes [start, start + size) were not overwritten yet.
+    inline bool isIntact(quint64 start) const { return reserved.loadAcquire() <= start + ring.size(); }
+
+    std::vector<unsigned char> ring;     ///< The raw bytes of the frames
+    std::vector<Slot> frames;            ///< The frames, indexed by (number - 1) % frames.size()
+    QAtomicInteger<quint64> reserved;    ///< End of the bytes the writer has claimed, only increases
+    QAtomicInteger<quint64> recorded;    ///< Number of the last completely recorded frame
+};
+
+} // namespace Dso
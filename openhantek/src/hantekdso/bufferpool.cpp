@@ -0,0 +1,98 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QtGlobal>
+
+#include "bufferpool.h"
+
+namespace Dso {
+
+static const size_t PAGE_SIZE_BYTES = 4096;
+
+static QAtomicInteger<unsigned long long> allocationCounter(0);
+
+unsigned long long poolAllocations() { return allocationCounter.load(); }
+
+
+RawBufferPool::~RawBufferPool() {
+    for (RawBuffer *buffer : buffers) {
+        for (unsigned char *chunk : buffer->chunks)
+            qFreeAligned(chunk);
+        delete buffer;
+    }
+}
+
+
+RawBuffer *RawBufferPool::lease(size_t size) {
+    QMutexLocker locker(&lock);
+    RawBuffer *buffer = nullptr;
+    // prefer a free buffer that is already large enough, otherwise grow the largest one
+    auto found = freeList.end();
+    for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+        if (found == freeList.end() || (*it)->capacity() > (*found)->capacity())
+            found = it;
+        if ((*it)->capacity() >= size) {
+            found = it;
+            break;
+        }
+    }
+    if (found != freeList.end()) {
+        buffer = *found;
+        freeList.erase(found);
+    } else {
+        buffer = new RawBuffer();
+        buffers.push_back(buffer);
+        freeList.reserve(buffers.size());
+    }
+    while (buffer->capacity() < size) {
+        unsigned char *chunk = static_cast<unsigned char *>(qMallocAligned(RAW_CHUNK_SIZE, PAGE_SIZE_BYTES));
+        Q_CHECK_PTR(chunk);
+        buffer->chunks.push_back(chunk);
+        allocationCounter.fetchAndAddRelaxed(1);
+    }
+    buffer->used = size;
+    buffer->gap = false;
+    return buffer;
+}
+
+
+void RawBufferPool::giveBack(RawBuffer *buffer) {
+    if (!buffer)
+        return;
+    QMutexLocker locker(&lock);
+    freeList.push_back(buffer);
+}
+
+
+std::vector<float> SampleBufferPool::lease(size_t size) {
+    QMutexLocker locker(&lock);
+    std::vector<float> buffer;
+    auto found = freeList.end();
+    for (auto it = freeList.begin(); it != freeList.end(); ++it) {
+        if (it->capacity() >= size) {
+            found = it;
+            break;
+        }
+    }
+    if (found == freeList.end() && !freeList.empty())
+        found = freeList.end() - 1;
+    if (found != freeList.end()) {
+        buffer.swap(*found);
+        freeList.erase(found);
+    }
+    if (buffer.capacity() < size)
+        allocationCounter.fetchAndAddRelaxed(1);
+    buffer.resize(size);
+    return buffer;
+}
+
+
+void SampleBufferPool::giveBack(std::vector<float> &&buffer) {
+    if (buffer.capacity() == 0)
+        return;
+    QMutexLocker locker(&lock);
+    if (freeList.size() == freeList.capacity())
+        allocationCounter.fetchAndAddRelaxed(1);
+    freeList.push_back(std::move(buffer));
+}
+
+} // namespace Dso
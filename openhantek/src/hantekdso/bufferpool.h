@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QMutex>
+#include <vector>
+
+namespace Dso {
+
+/// \brief Number of heap allocations done by all buffer pools since program start.
+/// Stays constant while the acquisition runs with unchanged settings.
+unsigned long long poolAllocations();
+
+#define RAW_CHUNK_SHIFT 20                      ///< Raw buffers consist of chunks of 1 MiB
+#define RAW_CHUNK_SIZE (size_t(1) << RAW_CHUNK_SHIFT)
+
+/// \brief Memory that receives the raw samples from the device.
+/// The data is stored in page aligned chunks of RAW_CHUNK_SIZE bytes, so a long record
+/// grows by adding chunks instead of reallocating and copying one contiguous block.
+/// Records up to RAW_CHUNK_SIZE are contiguous in chunk(0).
+class RawBuffer {
+    friend class RawBufferPool;
+
+  public:
+    inline unsigned char *chunk(size_t index) { return chunks[index]; }
+    inline const unsigned char *chunk(size_t index) const { return chunks[index]; }
+    /// \return The number of chunks that hold valid bytes.
+    inline size_t chunkCount() const { return (used + RAW_CHUNK_SIZE - 1) >> RAW_CHUNK_SHIFT; }
+    /// \return The number of valid bytes in the chunk.
+    inline size_t chunkSize(size_t index) const {
+        return index + 1 < chunkCount() ? RAW_CHUNK_SIZE : used - (index << RAW_CHUNK_SHIFT);
+    }
+    inline size_t size() const { return used; }
+    inline size_t capacity() const { return chunks.size() << RAW_CHUNK_SHIFT; }
+    inline bool empty() const { return used == 0; }
+    inline unsigned char operator[](size_t index) const {
+        return chunks[index >> RAW_CHUNK_SHIFT][index & (RAW_CHUNK_SIZE - 1)];
+    }
+    /// \brief Set the number of valid bytes, must not exceed the capacity.
+    inline void resize(size_t size) { used = size < capacity() ? size : capacity(); }
+
+    bool gap = false;                ///< Samples are missing inside this block
+    unsigned long long sequence = 0; ///< Consecutive number of the acquisition
+    qint64 received = 0;             ///< monotonicTime() when the transfer completed
+
+  private:
+    RawBuffer() = default;
+    RawBuffer(const RawBuffer &) = delete;
+    std::vector<unsigned char *> chunks;
+    size_t used = 0;
+};
+
+/// \brief Pool of reusable raw sample buffers.
+/// A buffer is leased for one acquisition and given back after its conversion.
+/// New memory is only allocated if no free buffer is large enough, then the missing chunks are added.
+class RawBufferPool {
+  public:
+    RawBufferPool() = default;
+    RawBufferPool(const RawBufferPool &) = delete;
+    ~RawBufferPool();
+
+    /// \brief Get a buffer with at least size bytes, its size() is set to size.
+    RawBuffer *lease(size_t size);
+    /// \brief Return a leased buffer to the pool, nullptr is ignored.
+    void giveBack(RawBuffer *buffer);
+
+  private:
+    QMutex lock;
+    std::vector<RawBuffer *> buffers;  ///< All buffers owned by the pool
+    std::vector<RawBuffer *> freeList; ///< Buffers that are not leased
+};
+
+/// \brief Pool of converted sample vectors.
+/// The vectors keep their capacity when they are given back, so swapping them with the
+/// vectors of a DSOsamples result does not touch the heap after the first cycles.
+class SampleBufferPool {
+  public:
+    SampleBufferPool() = default;
+    SampleBufferPool(const SampleBufferPool &) = delete;
+
+    /// \brief Get a vector with size elements.
+    std::vector<float> lease(size_t size);
+    /// \brief Return a vector to the pool, it keeps its capacity.
+    void giveBack(std::vector<float> &&buffer);
+
+  private:
+    QMutex lock;
+    std::vector<std::vector<float>> freeList;
+};
+
+} // namespace Dso
@@ -36,6 +36,12 @@ struct ControlSettingsTrigger {
     Dso::Slope slope = Dso::Slope::Positive;                     ///< The trigger slope
     unsigned int source = 0;                                     ///< The trigger source
     bool smooth = false;                                         ///< Don't trigger on glitches
+    Dso::TriggerType type = Dso::TriggerType::Edge;              ///< The event that triggers
+    Dso::TriggerCondition condition = Dso::TriggerCondition::Less; ///< Condition of pulse width and window
+    double time = 0.0;                                           ///< Pulse width limit or timeout in s
+    double timeUpper = 0.0;                                      ///< Upper pulse width limit in s
+    double secondLevel = 0.0;                                    ///< Other level of the runt/window band in V
+    bool fastAcquisition = false;                                ///< Overlay all trigger events of a block
 };
 
 /// \brief Stores the current amplification settings of the device.
@@ -58,6 +64,13 @@ struct ControlSettings {
     std::vector<ControlSettingsVoltage> voltage; ///< The amplification settings
     ControlSettingsTrigger trigger;              ///< The trigger settings
     RecordLengthID recordLengthId = 1;           ///< The id in the record length array
+    unsigned recordLength = 0;                   ///< Selected samples per channel of one acquisition
+    bool peakDetect = false;                     ///< Keep the min/max of each downsampling bucket
+    unsigned segmentCount = 0;                   ///< Segments of a segmented acquisition, 0 = off
+    unsigned segmentLength = 0;                  ///< Samples per channel of one segment
+    unsigned etsFactor = 1;                      ///< Equivalent-time sampling bins per sample, 1 = off
+    Dso::AveragingMode averaging = Dso::AveragingMode::Off; ///< Averaging of the triggered frames
+    unsigned averageCount = 1;                   ///< Frames of the average
     unsigned channelCount = 0;                   ///< Number of activated channels
     unsigned swSampleMargin = 2000;              ///< Software trigger, sample margin
     Hantek::CalibrationValues *calibrationValues;///< Calibration data for the channel offsets & gains
@@ -65,4 +78,26 @@ struct ControlSettings {
     Hantek::ControlBeginCommand beginCommandControl;
     Hantek::ControlGetLimits cmdGetLimits;
 };
+
+/// \brief Stores the settings the conversion of one block uses.
+/// The acquisition loop takes them before the block is handed to the conversion worker, the setters
+/// that run in the loop meanwhile change only the ControlSettings.
+struct ConversionSettings {
+    double samplerate = 0.0;                    ///< The samplerate of the block
+    double duration = 0.0;                      ///< The record time of the screen
+    unsigned samplesize = 0;                    ///< Samples per channel of the block, see getSamplesize()
+    bool fastRate = false;                      ///< One channel uses all buffers
+    bool peakDetect = false;                    ///< Keep the min/max of each downsampling bucket
+    bool setupChanged = false;                  ///< The channel setup changed, the block is skipped
+    std::vector<ControlSettingsVoltage> voltage; ///< The amplification settings
+    ControlSettingsTrigger trigger;             ///< The trigger settings
+    unsigned segmentCount = 0;                  ///< Segments of a segmented acquisition, 0 = off
+    unsigned segmentLength = 0;                 ///< Samples per channel of one segment
+    unsigned etsFactor = 1;                     ///< Equivalent-time sampling bins per sample, 1 = off
+    Dso::AveragingMode averaging = Dso::AveragingMode::Off; ///< Averaging of the triggered frames
+    unsigned averageCount = 1;                  ///< Frames of the average
+    int segmentView = -1;                       ///< The shown segment, < 0 = overlay of all segments
+
+    bool isSegmented() const { return segmentCount > 0; }
+};
 }
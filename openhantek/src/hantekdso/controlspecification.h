@@ -17,12 +17,13 @@ struct ControlSamplerateLimits {
     double max;                          ///< The maximum sample rate
     unsigned int maxDownsampler;         ///< The maximum downsampling ratio
     std::vector<unsigned> recordLengths; ///< Available record lengths, UINT_MAX means rolling
+    double maxStreaming;                 ///< The maximum sample rate with asynchronous streaming, 0 = max
 };
 
 /// \brief Stores the samplerate limits.
 struct ControlSpecificationSamplerate {
-    ControlSamplerateLimits single = {50e6, 50e6, 0, std::vector<unsigned>()};  ///< The limits for single channel mode
-    ControlSamplerateLimits multi = {100e6, 100e6, 0, std::vector<unsigned>()}; ///< The limits for multi channel mode
+    ControlSamplerateLimits single = {50e6, 50e6, 0, std::vector<unsigned>(), 0};  ///< The limits for single channel mode
+    ControlSamplerateLimits multi = {100e6, 100e6, 0, std::vector<unsigned>(), 0}; ///< The limits for multi channel mode
 };
 
 struct ControlSpecificationGainLevel {
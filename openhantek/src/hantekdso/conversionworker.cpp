@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "conversionworker.h"
+
+namespace Dso {
+
+ConversionWorker::ConversionWorker() { setObjectName("conversionWorker"); }
+
+
+ConversionWorker::~ConversionWorker() {
+    {
+        QMutexLocker locker(&lock);
+        quit = true;
+        jobAvailable.wakeOne();
+    }
+    wait();
+}
+
+
+void ConversionWorker::submit(std::function<void()> job) {
+    if (!isRunning())
+        start();
+    QMutexLocker locker(&lock);
+    this->job = std::move(job);
+    busy = true;
+    finished = false;
+    jobAvailable.wakeOne();
+}
+
+
+void ConversionWorker::join() {
+    QMutexLocker locker(&lock);
+    while (busy && !finished)
+        jobDone.wait(&lock);
+    busy = false;
+}
+
+
+void ConversionWorker::run() {
+    QMutexLocker locker(&lock);
+    for (;;) {
+        while (!quit && !(busy && !finished))
+            jobAvailable.wait(&lock);
+        if (quit)
+            return;
+        std::function<void()> currentJob;
+        std::swap(currentJob, job);
+        locker.unlock();
+        currentJob();
+        locker.relock();
+        finished = true;
+        jobDone.wakeAll();
+    }
+}
+
+} // namespace Dso
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <functional>
+
+namespace Dso {
+
+/// \brief Runs one job at a time on its own thread.
+/// HantekDsoControl uses it to convert and trigger a block of samples while the next block
+/// is already read from the device. Only one job may be outstanding, submit() and join()
+/// have to be called from the same thread.
+class ConversionWorker : public QThread {
+  public:
+    ConversionWorker();
+    ~ConversionWorker() override;
+
+    /// \brief Start the job on the worker thread, a previous job must have been joined.
+    void submit(std::function<void()> job);
+
+    /// \brief Wait until the submitted job has finished.
+    void join();
+
+    /// \return true, if a job was submitted and not yet joined.
+    inline bool isBusy() const { return busy; }
+
+  protected:
+    void run() override;
+
+  private:
+    QMutex lock;
+    QWaitCondition jobAvailable;
+    QWaitCondition jobDone;
+    std::function<void()> job;
+    bool busy = false;      ///< Set by submit(), cleared by join()
+    bool finished = false;  ///< The current job has been executed
+    bool quit = false;
+};
+
+} // namespace Dso
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bufferpool.h"
+#include "decimation.h"
+
+namespace Dso {
+
+void accumulateBucket(RawBucket &bucket, const unsigned char *data, unsigned count, unsigned stride) {
+    unsigned index = 0;
+    unsigned sum = bucket.sum;
+    unsigned char min = bucket.min;
+    unsigned char max = bucket.max;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    if (stride == 1 && count >= 16) { // CH1 only, 16 samples per step
+        __m128i vMin = _mm_set1_epi8(char(0xFF));
+        __m128i vMax = zero;
+        __m128i vSum = zero;
+        for (; index + 16 <= count; index += 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+            vMin = _mm_min_epu8(vMin, v);
+            vMax = _mm_max_epu8(vMax, v);
+            vSum = _mm_add_epi64(vSum, _mm_sad_epu8(v, zero));
+        }
+        alignas(16) unsigned char lanesMin[16], lanesMax[16];
+        alignas(16) unsigned long long lanesSum[2];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMin), vMin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMax), vMax);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesSum), vSum);
+        for (unsigned lane = 0; lane < 16; ++lane) {
+            min = std::min(min, lanesMin[lane]);
+            max = std::max(max, lanesMax[lane]);
+        }
+        sum += unsigned(lanesSum[0] + lanesSum[1]);
+    } else if (stride == 2 && count >= 9) { // interleaved CH1/CH2, 16 samples of this channel per step
+        // the two 16 byte loads end with a byte of the other channel, stay inside the bucket
+        const __m128i mask = _mm_set1_epi16(0x00FF);
+        __m128i vMin = _mm_set1_epi8(char(0xFF));
+        __m128i vMax = zero;
+        __m128i vSum = zero;
+        for (; index + 17 <= count; index += 16) {
+            const __m128i *block = reinterpret_cast<const __m128i *>(data + 2 * index);
+            const __m128i v = _mm_packus_epi16(_mm_and_si128(_mm_loadu_si128(block), mask),
+                                               _mm_and_si128(_mm_loadu_si128(block + 1), mask));
+            vMin = _mm_min_epu8(vMin, v);
+            vMax = _mm_max_epu8(vMax, v);
+            vSum = _mm_add_epi64(vSum, _mm_sad_epu8(v, zero));
+        }
+        if (index + 9 <= count) { // 8 samples more, the upper half of the pack repeats them for min and max
+            const __m128i half =
+                _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * index)), mask);
+            const __m128i v = _mm_packus_epi16(half, half);
+            vMin = _mm_min_epu8(vMin, v);
+            vMax = _mm_max_epu8(vMax, v);
+            vSum = _mm_add_epi64(vSum, _mm_sad_epu8(half, zero));
+            index += 8;
+        }
+        alignas(16) unsigned char lanesMin[16], lanesMax[16];
+        alignas(16) unsigned long long lanesSum[2];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMin), vMin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMax), vMax);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesSum), vSum);
+        for (unsigned lane = 0; lane < 16; ++lane) {
+            min = std::min(min, lanesMin[lane]);
+            max = std::max(max, lanesMax[lane]);
+        }
+        sum += unsigned(lanesSum[0] + lanesSum[1]);
+    }
+#endif
+    for (; index < count; ++index) {
+        const unsigned char value = data[size_t(index) * stride];
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+    bucket.sum = sum;
+    bucket.min = min;
+    bucket.max = max;
+}
+
+
+void accumulateBucket(RawBucket &bucket, const RawBuffer &rawData, size_t position, unsigned count,
+                      unsigned stride) {
+    while (count) { // split the bucket at the chunk boundaries
+        const size_t offset = position & (RAW_CHUNK_SIZE - 1);
+        const size_t available = (RAW_CHUNK_SIZE - offset + stride - 1) / stride;
+        const unsigned part = unsigned(std::min(size_t(count), available));
+        accumulateBucket(bucket, rawData.chunk(position >> RAW_CHUNK_SHIFT) + offset, part, stride);
+        position += size_t(part) * stride;
+        count -= part;
+    }
+}
+
+} // namespace Dso
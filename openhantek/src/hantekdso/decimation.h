@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <stddef.h>
+
+namespace Dso {
+
+class RawBuffer;
+
+/// \brief Sum, minimum and maximum of the raw samples of one downsampling bucket.
+/// The minimum and maximum give the peak detect envelope and the clipping state,
+/// the sum gives the averaged sample.
+struct RawBucket {
+    unsigned sum = 0;
+    unsigned char min = 0xFF;
+    unsigned char max = 0x00;
+};
+
+/// \brief Accumulate count samples of one channel that are stored every stride bytes.
+/// The interleaved data of one or two channels (stride 1 or 2) is processed with SSE2
+/// if available, other strides and architectures use the scalar loop.
+void accumulateBucket(RawBucket &bucket, const unsigned char *data, unsigned count, unsigned stride);
+
+/// \brief Accumulate count samples starting at the byte position of a chunked raw buffer.
+void accumulateBucket(RawBucket &bucket, const RawBuffer &rawData, size_t position, unsigned count,
+                      unsigned stride);
+
+} // namespace Dso
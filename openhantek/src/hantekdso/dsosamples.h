@@ -7,12 +7,24 @@
 #include <QWriteLocker>
 #include <vector>
 
+#include "framestatistics.h"
+
 struct DSOsamples {
-    std::vector<std::vector<double>> data; ///< Pointer to input data from device
+    std::vector<std::vector<float>> data;    ///< Pointer to input data from device
+    std::vector<std::vector<float>> peakMin; ///< Peak detect envelope, empty if peak detect is off
+    std::vector<std::vector<float>> peakMax;
     double samplerate = 0.0;               ///< The samplerate of the input data
     unsigned char clipped = 0;             ///< Bitmask of clipped channels
     bool liveTrigger = false;              ///< live samples are triggered
     int triggerPosition = -1;              ///< position for a triggered trace, < 0 = not triggered
+    double triggerFraction = 0.0;          ///< the trigger crossing is this fraction of a sample after it
     double pulseWidth = 0.0;               ///< width from trigger point to next opposite slope
+    unsigned triggerEvents = 0;            ///< trigger events in the envelope of the fast acquisition
+    double pulseWidthMin = 0.0;            ///< shortest and longest pulse width of these events
+    double pulseWidthMax = 0.0;
+    double etsCoverage = 0.0;              ///< part of the equivalent-time grid with samples, 0 = off
+    unsigned averagedFrames = 0;           ///< frames in the shown average, 0 = off
+    bool corrupted = false;                ///< the samples have a gap, e.g. due to lost USB data
+    Dso::FrameTiming timing;               ///< Sequence number and timestamps of the frame
     mutable QReadWriteLock lock;
 };
@@ -4,6 +4,9 @@
 namespace Dso {
     Enum<Dso::TriggerMode, Dso::TriggerMode::AUTO, Dso::TriggerMode::SINGLE> TriggerModeEnum;
     Enum<Dso::Slope, Dso::Slope::Positive, Dso::Slope::Both> SlopeEnum;
+    Enum<Dso::TriggerType, Dso::TriggerType::Edge, Dso::TriggerType::Timeout> TriggerTypeEnum;
+    Enum<Dso::TriggerCondition, Dso::TriggerCondition::Less, Dso::TriggerCondition::Outside> TriggerConditionEnum;
+    Enum<Dso::AveragingMode, Dso::AveragingMode::Off, Dso::AveragingMode::Exponential> AveragingModeEnum;
     Enum<Dso::GraphFormat, Dso::GraphFormat::TY, Dso::GraphFormat::XY> GraphFormatEnum;
 
     /// \brief Return string representation of the given channel mode.
@@ -86,6 +89,57 @@ namespace Dso {
         }
     }
 
+    /// \brief Return string representation of the given trigger type.
+    /// \param type The ::TriggerType that should be returned as string.
+    /// \return The string that should be used in labels etc.
+    QString triggerTypeString(TriggerType type) {
+        switch (type) {
+        case TriggerType::Edge:
+            return QCoreApplication::tr("Edge");
+        case TriggerType::PulseWidth:
+            return QCoreApplication::tr("Pulse width");
+        case TriggerType::Runt:
+            return QCoreApplication::tr("Runt");
+        case TriggerType::Window:
+            return QCoreApplication::tr("Window");
+        case TriggerType::Timeout:
+            return QCoreApplication::tr("Timeout");
+        }
+        return QString();
+    }
+
+    /// \brief Return string representation of the given trigger condition.
+    /// \param condition The ::TriggerCondition that should be returned as string.
+    /// \return The string that should be used in labels etc.
+    QString triggerConditionString(TriggerCondition condition) {
+        switch (condition) {
+        case TriggerCondition::Less:
+            return QString::fromUtf8("<");
+        case TriggerCondition::Greater:
+            return QString::fromUtf8(">");
+        case TriggerCondition::Inside:
+            return QCoreApplication::tr("Inside");
+        case TriggerCondition::Outside:
+            return QCoreApplication::tr("Outside");
+        }
+        return QString();
+    }
+
+    /// \brief Return string representation of the given averaging mode.
+    /// \param mode The ::AveragingMode that should be returned as string.
+    /// \return The string that should be used in labels etc.
+    QString averagingModeString(AveragingMode mode) {
+        switch (mode) {
+        case AveragingMode::Off:
+            return QCoreApplication::tr("Off");
+        case AveragingMode::Linear:
+            return QCoreApplication::tr("Linear");
+        case AveragingMode::Exponential:
+            return QCoreApplication::tr("Exponential");
+        }
+        return QString();
+    }
+
     /// \brief Return string representation of the given graph interpolation mode.
     /// \param interpolation The ::InterpolationMode that should be returned as
     /// string.
@@ -46,6 +46,37 @@ enum class Slope : uint8_t {
 };
 extern Enum<Dso::Slope, Dso::Slope::Positive, Dso::Slope::Both> SlopeEnum;
 
+/// \enum TriggerType
+/// \brief The event that causes a software trigger.
+enum class TriggerType : uint8_t {
+    Edge,       ///< The signal crosses the trigger level
+    PulseWidth, ///< A pulse of the slope polarity ends, its width fulfils the condition
+    Runt,       ///< The signal leaves the band between both levels and returns without crossing it
+    Window,     ///< The signal enters (Inside) or leaves (Outside) the band between both levels
+    Timeout     ///< The signal stays on the side of the slope polarity for longer than the time
+};
+extern Enum<Dso::TriggerType, Dso::TriggerType::Edge, Dso::TriggerType::Timeout> TriggerTypeEnum;
+
+/// \enum TriggerCondition
+/// \brief The condition of the pulse width and window triggers.
+enum class TriggerCondition : uint8_t {
+    Less,    ///< Shorter than the time
+    Greater, ///< Longer than the time
+    Inside,  ///< Between both times, entering the band
+    Outside  ///< Not between both times, leaving the band
+};
+extern Enum<Dso::TriggerCondition, Dso::TriggerCondition::Less, Dso::TriggerCondition::Outside>
+    TriggerConditionEnum;
+
+/// \enum AveragingMode
+/// \brief The averaging of the triggered frames.
+enum class AveragingMode : uint8_t {
+    Off,        ///< Show each frame
+    Linear,     ///< Mean of the last N frames
+    Exponential ///< Each frame contributes 1/N to the average
+};
+extern Enum<Dso::AveragingMode, Dso::AveragingMode::Off, Dso::AveragingMode::Exponential> AveragingModeEnum;
+
 /// \enum InterpolationMode
 /// \brief The different interpolation modes for the graphs.
 enum InterpolationMode {
@@ -60,11 +91,17 @@ QString graphFormatString(GraphFormat format);
 QString couplingString(Coupling coupling);
 QString triggerModeString(TriggerMode mode);
 QString slopeString(Slope slope);
+QString triggerTypeString(TriggerType type);
+QString triggerConditionString(TriggerCondition condition);
+QString averagingModeString(AveragingMode mode);
 QString interpolationModeString(InterpolationMode interpolation);
 }
 
 Q_DECLARE_METATYPE(Dso::TriggerMode)
 Q_DECLARE_METATYPE(Dso::Slope)
+Q_DECLARE_METATYPE(Dso::TriggerType)
+Q_DECLARE_METATYPE(Dso::TriggerCondition)
+Q_DECLARE_METATYPE(Dso::AveragingMode)
 Q_DECLARE_METATYPE(Dso::Coupling)
 Q_DECLARE_METATYPE(Dso::GraphFormat)
 Q_DECLARE_METATYPE(Dso::ChannelMode)
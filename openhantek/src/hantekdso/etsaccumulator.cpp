@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+
+#include "dsosamples.h"
+#include "etsaccumulator.h"
+
+namespace Dso {
+
+#define ETS_LIFETIME 4 ///< A bin expires after this many times factor acquisitions without a hit
+
+void EtsAccumulator::configure(unsigned factor, unsigned length, unsigned channels, double samplerate) {
+    const unsigned bins = (length + 1) * factor;
+    if (factor == this->factor && bins == this->bins && channels == this->channels &&
+        samplerate == this->samplerate)
+        return;
+    this->factor = factor;
+    this->bins = bins;
+    this->channels = channels;
+    this->samplerate = samplerate;
+    lifetime = ETS_LIFETIME * factor;
+    values.assign(size_t(channels) * bins, 0.0f);
+    hits.assign(bins, 0);
+    clear();
+}
+
+
+void EtsAccumulator::clear() {
+    std::fill(hits.begin(), hits.end(), 0);
+    acquisitions = 0;
+    usedChannels = 0;
+}
+
+
+void EtsAccumulator::add(const std::vector<std::vector<float>> &data, size_t start, double fraction) {
+    if (!bins || !start)
+        return;
+    if (++acquisitions == 0) { // the counter wrapped, forget the old hits
+        clear();
+        acquisitions = 1;
+    }
+    unsigned char used = 0;
+    for (unsigned channel = 0; channel < channels && channel < data.size(); ++channel) {
+        if (data[channel].size() > start)
+            used |= 0x01 << channel;
+    }
+    if (used != usedChannels) { // a channel was switched on or off
+        std::fill(hits.begin(), hits.end(), 0);
+        usedChannels = used;
+    }
+    // sample start - 1 + k is (k - 1 - fraction) sample intervals after the trigger aligned screen start,
+    // bin b is b / factor - 1 sample intervals after it
+    const size_t length = bins / factor;
+    for (size_t k = 0; k <= length; ++k) {
+        const long bin = std::lround((double(k) - fraction) * factor);
+        if (bin < 0 || bin >= long(bins))
+            continue;
+        bool hit = false;
+        for (unsigned channel = 0; channel < channels; ++channel) {
+            if (!(used & (0x01 << channel)) || start - 1 + k >= data[channel].size())
+                continue;
+            values[size_t(channel) * bins + size_t(bin)] = data[channel][start - 1 + k];
+            hit = true;
+        }
+        if (hit)
+            hits[size_t(bin)] = acquisitions;
+    }
+}
+
+
+void EtsAccumulator::view(DSOsamples &target) const {
+    target.data.resize(channels);
+    target.peakMin.resize(channels);
+    target.peakMax.resize(channels);
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        std::vector<float> &samples = target.data[channel];
+        target.peakMin[channel].clear();
+        target.peakMax[channel].clear();
+        if (!(usedChannels & (0x01 << channel))) {
+            samples.clear();
+            continue;
+        }
+        samples.resize(bins);
+        const float *grid = values.data() + size_t(channel) * bins;
+        // the empty bins are interpolated linearly between their valid neighbours
+        long previous = -1;
+        for (unsigned bin = 0; bin < bins; ++bin) {
+            if (!isValid(bin))
+                continue;
+            samples[bin] = grid[bin];
+            if (previous < 0) { // the start holds the first value
+                std::fill(samples.begin(), samples.begin() + bin, grid[bin]);
+            } else {
+                const float step = (grid[bin] - grid[previous]) / float(long(bin) - previous);
+                for (long gap = previous + 1; gap < long(bin); ++gap)
+                    samples[size_t(gap)] = grid[previous] + step * float(gap - previous);
+            }
+            previous = long(bin);
+        }
+        if (previous < 0) // no valid bin
+            samples.clear();
+        else
+            std::fill(samples.begin() + previous + 1, samples.end(), grid[previous]);
+    }
+    target.samplerate = samplerate * factor;
+    target.triggerPosition = int(factor);
+    target.triggerFraction = 0.0;
+}
+
+
+double EtsAccumulator::coverage() const {
+    if (!bins)
+        return 0.0;
+    unsigned valid = 0;
+    for (unsigned bin = 0; bin < bins; ++bin) {
+        if (isValid(bin))
+            ++valid;
+    }
+    return double(valid) / bins;
+}
+
+} // namespace Dso
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+struct DSOsamples;
+
+namespace Dso {
+
+/// \brief Equivalent-time sampling of repetitive signals.
+/// The screens of many triggered acquisitions are combined on a time grid that is factor times finer than
+/// the sample interval. The sub-sample position of the trigger crossing of each acquisition decides into
+/// which bins its samples fall. A bin keeps the last sample it received and expires if it was not hit
+/// within the last acquisitions, so the picture follows changes of the signal. The grid is allocated by
+/// configure(), adding an acquisition does not allocate memory.
+class EtsAccumulator {
+  public:
+    /// \brief Set up the grid, the collected samples are discarded on a change.
+    /// \param factor The bins per sample interval.
+    /// \param length The samples per channel of the screen.
+    void configure(unsigned factor, unsigned length, unsigned channels, double samplerate);
+
+    /// \brief Discard the collected samples.
+    void clear();
+
+    /// \brief Sort the samples of the screen of all channels into the grid.
+    /// \param data The converted samples of the triggered acquisition.
+    /// \param start The first sample of the screen in data.
+    /// \param fraction The trigger crossing is this fraction of a sample interval after start.
+    void add(const std::vector<std::vector<float>> &data, size_t start, double fraction);
+
+    /// \brief Replace the samples of target with the grid, bins without samples are interpolated.
+    /// The grid starts one sample interval before the screen, target.triggerPosition points to the screen.
+    void view(DSOsamples &target) const;
+
+    /// \return The part of the bins that hold a valid sample, 0 ... 1.
+    double coverage() const;
+
+  private:
+    /// \return true, if the bin was hit within the lifetime.
+    inline bool isValid(unsigned bin) const { return hits[bin] && acquisitions - hits[bin] < lifetime; }
+
+    unsigned factor = 0;
+    unsigned bins = 0;       ///< (length + 1) * factor, one sample interval before the screen
+    unsigned channels = 0;
+    double samplerate = 0.0; ///< Samplerate of the acquisitions
+    unsigned acquisitions = 0; ///< Number of the last added acquisition
+    unsigned lifetime = 0;   ///< Acquisitions after which a bin expires
+    std::vector<float> values;          ///< The last sample of each bin, ordered by channel, bin
+    std::vector<unsigned> hits;         ///< The acquisition that hit each bin, 0 = never
+    unsigned char usedChannels = 0;     ///< The channels of the last acquisition
+};
+
+} // namespace Dso
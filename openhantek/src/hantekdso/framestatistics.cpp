@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <chrono>
+
+#include "framestatistics.h"
+
+namespace Dso {
+
+qint64 monotonicTime() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+
+QString FrameCounters::toString() const {
+    return QString("acquired %1 (corrupted %2, skipped %3), converted %4 (untriggered %5), waveforms %6, "
+                   "overwritten %7, published %8, processed %9, rendered %10, not rendered %11, frame age %12 ms")
+        .arg(acquired.load())
+        .arg(corrupted.load())
+        .arg(skipped.load())
+        .arg(converted.load())
+        .arg(untriggered.load())
+        .arg(waveforms.load())
+        .arg(overwritten.load())
+        .arg(published.load())
+        .arg(processed.load())
+        .arg(rendered.load())
+        .arg(notRendered.load())
+        .arg(renderAge.load() / 1e6, 0, 'f', 1);
+}
+
+} // namespace Dso
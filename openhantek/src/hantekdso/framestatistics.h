@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QString>
+
+namespace Dso {
+
+/// \brief Monotonic time in ns, comparable between all threads.
+qint64 monotonicTime();
+
+/// \brief Identification and timestamps of one acquired frame.
+/// The timestamps are monotonicTime() values, 0 if the frame did not reach the stage.
+struct FrameTiming {
+    unsigned long long sequence = 0; ///< Consecutive number of the acquisition, starts with 1
+    qint64 received = 0;             ///< The USB transfer of the raw data completed
+    qint64 captured = 0;             ///< Estimated sampling time of the first sample of the frame
+    qint64 converted = 0;            ///< The raw data was converted to voltages
+    qint64 triggered = 0;            ///< The trigger search finished
+};
+
+/// \brief Number of frames that passed or were dropped at the boundaries of the acquisition pipeline.
+/// device -> acquired -> converted -> published -> processed -> rendered
+/// The counters are updated by the acquisition, conversion, post processing and GUI threads.
+/// Every device has its own counters, see HantekDsoControl::frameCounters().
+/// Republished frames, e.g. while the acquisition is stopped, are not counted again.
+struct FrameCounters {
+    QAtomicInteger<quint64> acquired;    ///< Raw blocks read from the device
+    QAtomicInteger<quint64> corrupted;   ///< Acquired blocks with a gap, i.e. samples lost on USB
+    QAtomicInteger<quint64> skipped;     ///< Acquired blocks dropped before the conversion (settings change)
+    QAtomicInteger<quint64> converted;   ///< Blocks converted to voltages
+    QAtomicInteger<quint64> untriggered; ///< Blocks not converted, they did not trigger in NORMAL mode
+    QAtomicInteger<quint64> waveforms;   ///< Triggered windows shown, all trigger events of a block in fast acquisition
+    QAtomicInteger<quint64> overwritten; ///< Converted frames replaced before the post processing was free
+    QAtomicInteger<quint64> published;   ///< Frames handed to the post processing
+    QAtomicInteger<quint64> processed;   ///< Frames that finished the post processing
+    QAtomicInteger<quint64> rendered;    ///< Frames painted on the screen
+    QAtomicInteger<quint64> notRendered; ///< Processed frames replaced before they were painted
+    QAtomicInteger<qint64> renderAge;    ///< Time from USB complete until the last frame was painted in ns
+
+    /// \brief One line summary of the counters for the log and the status bar.
+    QString toString() const;
+};
+
+} // namespace Dso
@@ -2,12 +2,14 @@
 
 // #define DEBUG
 
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 #include <limits>
 #include <stdexcept>
 #include <vector>
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QEventLoop>
 #include <QList>
@@ -19,16 +21,29 @@
 #include "viewconstants.h"
 #include "scopesettings.h"
 #include "hantekdsocontrol.h"
+#include "framestatistics.h"
+#include "rawconverter.h"
 #include "hantekprotocol/controlStructs.h"
 #include "models/modelDSO6022.h"
+#include "usb/uploadFirmware.h"
 #include "usb/usbdevice.h"
+#include "usb/usbstream.h"
 
 using namespace Hantek;
 using namespace Dso;
 
+#define ROLL_CHUNKS_PER_SECOND 50 ///< Trace updates per second in roll mode
+#define ROLL_SKIP_SAMPLES 2048    ///< Unstable samples after the start of the roll mode
+#define DISPLAY_MARGIN 16         ///< Samples converted left and right of the screen for the interpolation
+#define FAST_ACQUISITION_EVENTS_MAX 1000 ///< Trigger windows of one block overlaid in the fast acquisition
+
 /// \brief Start sampling process.
 void HantekDsoControl::enableSampling(bool enabled) {
     sampling = enabled;
+    if (!enabled && isSegmented()) { // show the last complete sequence instead of the partial one
+        finishConversion();
+        showSegments(segmentView);
+    }
 
     // Emit signals for initial settings
     //    emit availableRecordLengthsChanged(controlsettings.samplerate.limits->recordLengths);
@@ -51,6 +66,10 @@ HantekDsoControl::HantekDsoControl(USBDevice *device)
     if (device == nullptr) throw new std::runtime_error("No usb device for HantekDsoControl");
 
     qRegisterMetaType<DSOsamples *>();
+    clock.start();
+    controlsettings.recordLength = RECORDLENGTH_DEFAULT;
+    Q_ASSERT(specification->channels <= CONVERSION_CHANNELS_MAX);
+    rollConverters.resize(specification->channels);
 
     if (specification->fixedUSBinLength) device->overwriteInPacketLength(specification->fixedUSBinLength);
 
@@ -100,19 +119,12 @@ double HantekDsoControl::getMaxSamplerate() const {
 bool HantekDsoControl::isSampling() const { return sampling; }
 
 
-/// \brief Updates the interval of the periodic thread timer.
-void HantekDsoControl::updateInterval() {
-    // Check the current oscilloscope state everytime 25% of the time
-    //  the buffer should be refilled (-> cycleTime in ms)
-    cycleTime = (int)( (double)SAMPLESIZE_USED * 250.0 / controlsettings.samplerate.current );
-    // Slower update reduces CPU load but it worsens the triggering of rare events
-#ifdef __arm__
-    // RPi: Not more often than every 50 ms but at least once every 500 ms
-    cycleTime = qBound(50, cycleTime, 500);
-#else
-    // Not more often than every 10 ms but at least once every 100 ms
-    cycleTime = qBound(10, cycleTime, 100);
-#endif
+bool HantekDsoControl::isRollMode() const {
+    // UINT_MAX in the record lengths marks a device that can roll
+    const std::vector<unsigned> &recordLengths = controlsettings.samplerate.limits->recordLengths;
+    return rollModeAvailable && !isSegmented() && controlsettings.trigger.mode == Dso::TriggerMode::AUTO &&
+           std::find(recordLengths.begin(), recordLengths.end(), UINT_MAX) != recordLengths.end() &&
+           controlsettings.samplerate.target.duration >= ROLL_TIMEBASE_MIN * DIVS_TIME * 0.999;
 }
 
 
@@ -121,8 +133,16 @@ bool HantekDsoControl::isFastRate() const {
 }
 
 
+unsigned HantekDsoControl::recordLengthFor(unsigned downsampling) const {
+    // keep the raw data of the highly downsampled slow samplerates in reasonable limits
+    const unsigned channels = isFastRate() ? 1 : specification->channels;
+    const unsigned limit = RECORDLENGTH_RAW_MAX / (downsampling * channels) / 1000 * 1000;
+    return qMax(unsigned(RECORDLENGTH_DEFAULT), qMin(controlsettings.recordLength, limit));
+}
+
+
 unsigned HantekDsoControl::getRecordLength() const {
-    unsigned rawsize = SAMPLESIZE_USED;
+    unsigned rawsize = getSamplesize();
     rawsize *= this->downsampling; // take more samples
     rawsize = ( (rawsize + 1024) / 1024 + 2 ) * 1024; // adjust for skipping of minimal 2018 leading samples
     //printf( "getRecordLength: %d\n", rawsize );
@@ -150,16 +170,43 @@ Dso::ErrorCode HantekDsoControl::retrieveChannelLevelData() {
 }
 
 
-std::vector<unsigned char> HantekDsoControl::getSamples(unsigned &previousSampleCount) const {
+RawBuffer *HantekDsoControl::getSamples(unsigned &previousSampleCount) {
     int errorCode;
-    errorCode = device->controlWrite(getCommand(ControlCode::CONTROL_ACQUIIRE_HARD_DATA));
-    if (errorCode < 0) {
-        qWarning() << "controlWrite: Getting sample data failed: " << libUsbErrorString(errorCode);
-        emit communicationError();
-        return std::vector<unsigned char>();
+    // the highest samplerates need a deeper transfer ring, restart the stream if this changes
+    const bool fastStreaming = controlsettings.samplerate.current > specification->samplerate.single.max;
+    if (streaming && device->isStreaming() && fastStreaming != streamingFast)
+        device->stopStreaming();
+    // in streaming mode the acquisition is started only once, the device keeps filling its FIFO
+    if (!streaming || !device->isStreaming()) {
+        errorCode = device->controlWrite(getCommand(ControlCode::CONTROL_ACQUIIRE_HARD_DATA));
+        if (errorCode < 0) {
+            qWarning() << "controlWrite: Getting sample data failed: " << libUsbErrorString(errorCode);
+            emit communicationError();
+            return nullptr;
+        }
     }
-
+    const double byteRate =
+        controlsettings.samplerate.current * downsampling * (isFastRate() ? 1 : specification->channels);
     unsigned rawSampleCount = this->getSampleCount();
+    if (streaming && !device->isStreaming()) {
+        streamingFast = fastStreaming;
+        if (fastStreaming) {
+            const TransferConfig transfers = getFastTransfers();
+            fastStreamRate = byteRate;
+            tuningSeconds = 0;
+            errorCode = device->startStreaming(transfers.size, transfers.count);
+        } else {
+            errorCode = device->startStreaming();
+        }
+        if (errorCode < 0)
+            qWarning() << "startStreaming failed, using single reads: " << libUsbErrorString(errorCode);
+    }
+    if (device->isStreaming()) { // enables the gap detection
+        device->getStream()->setExpectedRate(byteRate);
+        // the data skipped since the last capture is no gap, only the one inside this capture
+        device->getStream()->startBlock();
+    }
+
     //printf( "getSamples, rawSampleCount %d\n", rawSampleCount );
     // To make sure no samples will remain in the scope buffer, also check the
     // sample count before the last sampling started
@@ -168,116 +215,301 @@ std::vector<unsigned char> HantekDsoControl::getSamples(unsigned &previousSample
     } else {
         previousSampleCount = rawSampleCount;
     }
-    // Save raw data to temporary buffer
-    std::vector<unsigned char> data(rawSampleCount);
-    int retval = device->bulkReadMulti( data.data(), rawSampleCount );
-    if ( retval < 0 ) {
-        qWarning() << "bulkReadMulti: Getting sample data failed: " << libUsbErrorString( retval );
-        return std::vector<unsigned char>();
+    // Save raw data to a buffer of the pool, long records are read chunk by chunk
+    RawBuffer *data = rawBufferPool.lease(rawSampleCount);
+    size_t received = 0;
+    for ( size_t index = 0; index < data->chunkCount(); ++index ) {
+        const unsigned length = unsigned( data->chunkSize( index ) );
+        // without streaming the samplerates above the normal limit lose data
+        bool gap = fastStreaming;
+        int retval = device->isStreaming() ? device->bulkReadStream( data->chunk( index ), length, &gap )
+                                           : device->bulkReadMulti( data->chunk( index ), length );
+        if ( retval < 0 ) {
+            qWarning() << "bulkReadMulti: Getting sample data failed: " << libUsbErrorString( retval );
+            rawBufferPool.giveBack(data);
+            return nullptr;
+        }
+        data->gap |= gap;
+        received += (size_t)retval;
+        // a short read would misalign the following chunks, stop also if the program quits
+        if ( unsigned( retval ) < length || QThread::currentThread()->isInterruptionRequested() )
+            break;
     }
-    data.resize( (size_t)retval );
-    //printf( "bulkReadMulti( %d ) -> %d\n", rawSampleCount, retval );
+    data->resize( received );
+    //printf( "bulkReadMulti( %d ) -> %lu\n", rawSampleCount, received );
+    data->received = monotonicTime();
+    data->sequence = ++acquisitionSequence;
+    frameCounters().acquired.fetchAndAddRelaxed( 1 );
+    if ( data->gap )
+        frameCounters().corrupted.fetchAndAddRelaxed( 1 );
 
-    static unsigned id = 0;
-    ++id;
-    timestampDebug(QString("Received packet %1").arg(id));
+    timestampDebug(QString("Received packet %1").arg(data->sequence));
 
     return data;
 }
 
 
-void HantekDsoControl::convertRawDataToSamples(const std::vector<unsigned char> &rawData) {
-    if ( channelSetupChanged ) { // skip the next conversion to avoid artefacts due to channel switch
-        channelSetupChanged = false;
+TransferConfig HantekDsoControl::getFastTransfers() {
+    if (fastTransfers.size)
+        return fastTransfers;
+    fastTransfers.size = HANTEK_STREAM_TRANSFER_SIZE_FAST;
+    fastTransfers.count = HANTEK_STREAM_TRANSFERS_FAST;
+    tuningMinRing = 0;
+    transferHost = TransferTuner::hostKey(device->getRawDevice());
+    const QString model = QString::fromStdString(device->getModel()->name);
+    // without a stable key a stored result could belong to another controller
+    transfersTuned = transferHost.isEmpty() || TransferTuner::load(model, transferHost, fastTransfers);
+    return fastTransfers;
+}
+
+
+void HantekDsoControl::tuneFastTransfers() {
+    if (transfersTuned || !streamingFast || !device->isStreaming() || ++tuningSeconds < TUNER_ONLINE_TIME)
         return;
+    USBStream *stream = device->getStream();
+    // both count since the start of the stream with fastTransfers
+    const bool lost = stream->getGaps() || stream->getErrors();
+    const double latency = stream->getMaxCompletionInterval() * 1e-9;
+    const unsigned long long ring = (unsigned long long)fastTransfers.size * fastTransfers.count;
+    if (lost)
+        tuningMinRing = ring + 1;
+    const TransferConfig next = TransferTuner::forLatency(fastStreamRate, latency, tuningMinRing);
+    timestampDebug(QString("Transfers %1 x %2: latency %3 ms, %4")
+                       .arg(fastTransfers.count)
+                       .arg(fastTransfers.size)
+                       .arg(latency * 1e3, 0, 'f', 2)
+                       .arg(lost ? "lost data" : "lossless"));
+    if (!next.size || (!lost && (unsigned long long)next.size * next.count >= ring)) {
+        // lossless with the smallest ring the latency allows, or no larger one to try
+        transfersTuned = true;
+        if (!lost)
+            TransferTuner::save(QString::fromStdString(device->getModel()->name), transferHost, fastTransfers);
+        emit statusMessage(
+            tr("USB transfers: %1 x %2 bytes").arg(fastTransfers.count).arg(fastTransfers.size), 3000);
+        return;
+    }
+    // the next getSamples() starts the stream again with the new transfers
+    fastTransfers = next;
+    device->stopStreaming();
+}
+
+
+void HantekDsoControl::takeConversionSettings() {
+    converting.samplerate = controlsettings.samplerate.current;
+    converting.duration = controlsettings.samplerate.target.duration;
+    converting.samplesize = getSamplesize();
+    converting.fastRate = isFastRate();
+    converting.peakDetect = controlsettings.peakDetect;
+    converting.setupChanged = channelSetupChanged;
+    channelSetupChanged = false;
+    converting.voltage = controlsettings.voltage;
+    converting.trigger = controlsettings.trigger;
+    converting.segmentCount = controlsettings.segmentCount;
+    converting.segmentLength = controlsettings.segmentLength;
+    converting.etsFactor = controlsettings.etsFactor;
+    converting.averaging = controlsettings.averaging;
+    converting.averageCount = controlsettings.averageCount;
+    converting.segmentView = segmentView;
+}
+
+
+bool HantekDsoControl::prepareConversion(const RawBuffer *rawBuffer) {
+    if ( !rawBuffer )
+        return false;
+    if ( converting.setupChanged ) { // skip the next conversion to avoid artefacts due to channel switch
+        averager.clear(); // the frames of the old setup do not fit
+        frameCounters().skipped.fetchAndAddRelaxed( 1 );
+        return false;
     }
+    const RawBuffer &rawData = *rawBuffer;
 
-    const size_t rawSampleCount = isFastRate() ? rawData.size() : (rawData.size() / 2);
+    const size_t rawSampleCount = converting.fastRate ? rawBuffer->size() : (rawBuffer->size() / 2);
     //printf("cRDTS, rawSampleCount %lu\n", rawSampleCount);
-    if ( 0 == rawSampleCount) // nothing to convert
-        return;
+    if ( 0 == rawSampleCount) { // nothing to convert
+        frameCounters().skipped.fetchAndAddRelaxed( 1 );
+        return false;
+    }
 
     QWriteLocker locker(&result.lock);
-    result.samplerate = controlsettings.samplerate.current;
-    // Prepare result buffers
-    result.data.resize(specification->channels);
-    for (ChannelID channelCounter = 0; channelCounter < specification->channels; ++channelCounter)
-        result.data[channelCounter].clear();
+    result.samplerate = converting.samplerate;
+    result.corrupted = rawBuffer->gap;
+    result.timing = FrameTiming();
+    result.timing.sequence = rawBuffer->sequence;
+    result.timing.received = rawBuffer->received;
 
     // The 1st two or three frames (512 byte) of the raw sample stream are unreliable
     // (Maybe because the common mode input voltage of ADC is handled far out of spec and has to settle)
     // Solution: sample at least 2048 more values -> rawSampleSize (must be multiple of 1024)
     //           rawSampleSize = ( ( n*20000 + 1024 ) / 1024 + 2) * 1024;
-    // and skip over these samples to get 20000 samples (or n*20000)
+    // and skip over these samples to get the record length (or n * record length)
 
     unsigned sampleCount = (rawSampleCount > 1024) ? ((rawSampleCount - 1024)/1000 - 1)*1000 : rawSampleCount;
     unsigned skipSamples = rawSampleCount - sampleCount;
-    unsigned downsampling = sampleCount / SAMPLESIZE_USED;
+    unsigned downsampling = qMax( 1u, sampleCount / converting.samplesize );
     //printf("sampleCount %u, downsampling %u\n", sampleCount, downsampling );
 
-    // Convert channel data
-    unsigned short activeChannels = specification->channels;
+    // one channel mode only with CH1
+    const unsigned activeChannels = converting.fastRate ? 1 : specification->channels;
+    conversion.position = skipSamples * activeChannels; // skip first unstable samples
+    conversion.stride = activeChannels;
+    conversion.downsampling = downsampling;
+    conversion.count = sampleCount / downsampling;
+    conversion.channels = 0;
+    conversion.peakDetect = converting.peakDetect && downsampling > 1;
+    conversion.samplerate = result.samplerate;
+    for (ChannelID channel = 0; channel < activeChannels; ++channel) {
+        // the lookup table of the converter is only rebuilt if gain, offset or calibration changed
+        updateConverter( conversion.converters[ channel ], channel, converting.voltage[ channel ], result.samplerate );
+        conversion.channels |= 0x01 << channel;
+    }
+    // the trigger is searched in the raw data, the level is mapped into raw values with the calibration
+    const ChannelID triggerSource = converting.trigger.source;
+    if ( triggerSource < activeChannels && converting.voltage[ triggerSource ].used ) {
+        rawTrigger.prepare( rawData, conversion, triggerSource );
+        const double level = converting.trigger.level[ triggerSource ];
+        rawTrigger.setLevel( conversion.converters[ triggerSource ], downsampling, level );
+        if ( converting.trigger.type == Dso::TriggerType::Runt ||
+             converting.trigger.type == Dso::TriggerType::Window ) {
+            const double secondLevel = converting.trigger.secondLevel;
+            rawTrigger.setBand( conversion.converters[ triggerSource ], downsampling, qMin( level, secondLevel ),
+                                qMax( level, secondLevel ) );
+        }
+    } else {
+        rawTrigger.clear();
+    }
+    return true;
+}
+
+
+void HantekDsoControl::convertRawDataToSamples(const RawBuffer &rawData, unsigned first, unsigned count) {
+    QWriteLocker locker(&result.lock);
+    conversion.position += size_t( first ) * conversion.downsampling * conversion.stride;
+    conversion.count = count;
+    convertChannels( rawData, conversion );
+    result.timing.converted = monotonicTime();
+    frameCounters().converted.fetchAndAddRelaxed( 1 );
+}
+
+
+void HantekDsoControl::convertDisplayed(const RawBuffer &rawData) {
+    // the screen shows samplesDisplay samples from the trigger position, or from the start if untriggered
+    const unsigned samplesDisplay =
+        unsigned( std::ceil( converting.duration * converting.samplerate ) );
+    const unsigned screenStart = result.triggerPosition > 0 ? unsigned( result.triggerPosition ) : 0;
+    const unsigned first = screenStart > DISPLAY_MARGIN ? screenStart - DISPLAY_MARGIN : 0;
+    const unsigned count = qMin( samplesDisplay + screenStart - first + DISPLAY_MARGIN, conversion.count - first );
+    displayFirst = first;
+    // the block ends with the completion of the transfer, this places the frames of several devices in time
+    result.timing.captured =
+        result.timing.received - qint64( double( conversion.count - first ) * 1e9 / result.samplerate );
+    if ( result.triggerPosition > 0 )
+        result.triggerPosition -= int( first ); // relative to the converted window
+    if ( result.triggerPosition <= 0 && converting.trigger.mode == Dso::TriggerMode::NORMAL ) {
+        // the last triggered trace is shown, keep the parameters for the history only
+        conversion.position += size_t( first ) * conversion.downsampling * conversion.stride;
+        conversion.count = count;
+        frameCounters().untriggered.fetchAndAddRelaxed( 1 );
+        return;
+    }
+    convertRawDataToSamples( rawData, first, count );
+}
+
+
+void HantekDsoControl::convertChannels( const RawBuffer &rawData, const ConversionParameters &parameters ) {
+    // Prepare result buffers, the channel vectors are exchanged with vectors from the pool below
+    result.data.resize(specification->channels);
+    result.peakMin.resize(specification->channels);
+    result.peakMax.resize(specification->channels);
     // Channels are using their separate buffers
     for (ChannelID channel = 0; channel < specification->channels; ++channel) {
-        if ( isFastRate() ) { // one channel mode only with CH1 (channel == 0)
-            activeChannels = 1;
-            if ( channel > 0 ) { // skip unused channel
-                result.data[channel].clear();
-                continue;
-            }
+        std::vector<float> &peakMin = result.peakMin[ channel ];
+        std::vector<float> &peakMax = result.peakMax[ channel ];
+        if ( !( parameters.channels & ( 0x01 << channel ) ) ) { // skip unused channel
+            result.data[channel].clear();
+            peakMin.clear();
+            peakMax.clear();
+            continue;
         }
-        //result.data[channel].resize(rawSampleCount);
-        const unsigned gainID = controlsettings.voltage[channel].gain;
-        const unsigned short limit = specification->voltageLimit[channel][gainID];
-        const double offset = controlsettings.voltage[channel].offsetReal;
-        const double gainStep = specification->gain[gainID].gainSteps;
-        const double probeAttn = controlsettings.voltage[channel].probeAttn;
-        const double sign = controlsettings.voltage[channel].inverted ? -1.0 : 1.0;
-        double offsetError = 0.0;
-        double gainCalibration = 1.0;
-
-        // shift + individual offset for each channel and gain
-        offsetError = specification->voltageOffset[ channel ][ gainID ];
-        gainCalibration = 1.0;
-        if ( !offsetError ) { // no config file value
-            // get offset value from eeprom[ 8 .. 39 and (if available) 56 .. 87]
-            int offsetFine = 0;
-            if ( result.samplerate < 30e6 ) {
-                offsetError = controlsettings.calibrationValues->off.ls.step[ gainID ][ channel ];
-                offsetFine = controlsettings.calibrationValues->fine.ls.step[ gainID ][ channel ];
-            } else {
-                offsetError = controlsettings.calibrationValues->off.hs.step[ gainID ][ channel ];
-                offsetFine = controlsettings.calibrationValues->fine.hs.step[ gainID ][ channel ];
-            }
-            if ( offsetFine && offsetFine != 255 ) {
-                offsetError += (offsetFine - 0x80) / 250.0;
-            }
-            int gain = controlsettings.calibrationValues->gain.step[ gainID ][ channel ];
-            if ( gain && gain != 255 ) {
-                gainCalibration = 1.0 + (gain - 0x80) / 500.0;
-            }
-            //printf( "sDB %d, gC %f, ch %d, gID %d\n", shiftDataBuf, gainCalibration, channel, gainID );
+        // Convert data from the oscilloscope and write it into the sample buffer
+        std::vector<float> channelData = sampleBufferPool.lease( parameters.count );
+        result.data[channel].swap( channelData );
+        sampleBufferPool.giveBack( std::move( channelData ) );
+        if ( parameters.peakDetect ) {
+            std::vector<float> minData = sampleBufferPool.lease( parameters.count );
+            std::vector<float> maxData = sampleBufferPool.lease( parameters.count );
+            peakMin.swap( minData );
+            peakMax.swap( maxData );
+            sampleBufferPool.giveBack( std::move( minData ) );
+            sampleBufferPool.giveBack( std::move( maxData ) );
+        } else {
+            peakMin.clear();
+            peakMax.clear();
         }
+        result.clipped &= ~(0x01 << channel); // clear clipping flag
+        // the samples of the channels are interleaved, average groups of downsampling samples
+        if ( parameters.converters[ channel ].convert( rawData, parameters.position + channel, parameters.stride,
+                                                       parameters.downsampling, parameters.count,
+                                                       result.data[ channel ].data(),
+                                                       parameters.peakDetect ? peakMin.data() : nullptr,
+                                                       parameters.peakDetect ? peakMax.data() : nullptr ) )
+            result.clipped |= 0x01 << channel; // min or max -> clipped
+    }
+}
 
-        // Convert data from the oscilloscope and write it into the sample buffer
-        unsigned rawBufferPosition = 0;
 
-        result.data[channel].resize( sampleCount / downsampling );
-        rawBufferPosition += skipSamples * activeChannels; // skip first unstable samples
-        rawBufferPosition += channel;
-        result.clipped &= ~(0x01 << channel); // clear clipping flag
-        for ( unsigned index = 0; index < result.data[ channel ].size();
-            ++index, rawBufferPosition += activeChannels * downsampling ) { // advance either by one or two blocks
-            double sample = 0.0;
-            for ( unsigned iii = 0; iii < downsampling * activeChannels; iii += activeChannels ) {
-                int rawSample = rawData[ rawBufferPosition + iii ]; // range 0...255
-                if ( rawSample == 0x00 || rawSample == 0xFF ) // min or max -> clipped
-                    result.clipped |= 0x01 << channel;
-                sample += (double)rawSample - offsetError;
-            }
-            sample /= downsampling;
-            result.data[ channel ][ index ] = sign * (sample / limit - offset) * gainCalibration * gainStep * probeAttn;
+void HantekDsoControl::recordHistory(const RawBuffer &rawData) {
+    if (!history.capacity() || result.timing.sequence != rawData.sequence) // off or the block was skipped
+        return;
+    HistoryFrame frame;
+    frame.conversion = conversion;
+    frame.triggerPosition = converting.isSegmented() ? 0 : result.triggerPosition;
+    frame.triggerFraction = converting.isSegmented() ? 0.0 : result.triggerFraction;
+    frame.pulseWidth = result.pulseWidth;
+    frame.corrupted = result.corrupted;
+    frame.timing = result.timing;
+    history.record(rawData, frame);
+}
+
+
+void HantekDsoControl::updateConverter(RawConverter &converter, ChannelID channel, const ControlSettingsVoltage &voltage,
+                                       double samplerate) const {
+    const unsigned gainID = voltage.gain;
+    const unsigned short limit = specification->voltageLimit[channel][gainID];
+    const double offset = voltage.offsetReal;
+    const double gainStep = specification->gain[gainID].gainSteps;
+    const double probeAttn = voltage.probeAttn;
+    const double sign = voltage.inverted ? -1.0 : 1.0;
+    double offsetError = 0.0;
+    double gainCalibration = 1.0;
+    getCalibration(channel, gainID, samplerate, offsetError, gainCalibration);
+    converter.setCalibration(offsetError, limit, offset, sign * gainCalibration * gainStep * probeAttn);
+}
+
+
+void HantekDsoControl::getCalibration(ChannelID channel, unsigned gainID, double samplerate, double &offsetError,
+                                      double &gainCalibration) const {
+    // the calibration values are read from the device before the acquisition starts
+    // shift + individual offset for each channel and gain
+    offsetError = specification->voltageOffset[ channel ][ gainID ];
+    gainCalibration = 1.0;
+    if ( !offsetError ) { // no config file value
+        // get offset value from eeprom[ 8 .. 39 and (if available) 56 .. 87]
+        int offsetFine = 0;
+        if ( samplerate < 30e6 ) {
+            offsetError = controlsettings.calibrationValues->off.ls.step[ gainID ][ channel ];
+            offsetFine = controlsettings.calibrationValues->fine.ls.step[ gainID ][ channel ];
+        } else {
+            offsetError = controlsettings.calibrationValues->off.hs.step[ gainID ][ channel ];
+            offsetFine = controlsettings.calibrationValues->fine.hs.step[ gainID ][ channel ];
         }
+        if ( offsetFine && offsetFine != 255 ) {
+            offsetError += (offsetFine - 0x80) / 250.0;
+        }
+        int gain = controlsettings.calibrationValues->gain.step[ gainID ][ channel ];
+        if ( gain && gain != 255 ) {
+            gainCalibration = 1.0 + (gain - 0x80) / 500.0;
+        }
+        //printf( "sDB %d, gC %f, ch %d, gID %d\n", shiftDataBuf, gainCalibration, channel, gainID );
     }
 }
 
@@ -322,10 +554,18 @@ void HantekDsoControl::restoreTargets() {
 }
 
 
+double HantekDsoControl::getSamplerateLimit() const {
+    const ControlSamplerateLimits &limits = isFastRate() ? specification->samplerate.single
+                                                         : specification->samplerate.multi;
+    if (streaming && limits.maxStreaming > limits.max)
+        return limits.maxStreaming;
+    return limits.max;
+}
+
+
 void HantekDsoControl::updateSamplerateLimits() {
     QList<double> sampleSteps;
-    double limit = ( isFastRate() ) ?
-        specification->samplerate.single.max : specification->samplerate.multi.max;
+    double limit = getSamplerateLimit();
 
     if ( controlsettings.samplerate.current > limit ) {
         setSamplerate( limit );
@@ -371,7 +611,122 @@ double HantekDsoControl::getSamplerate() const {
 
 
 unsigned HantekDsoControl::getSamplesize() const {
-    return SAMPLESIZE_USED;
+    return recordLengthFor(downsampling);
+}
+
+
+Dso::ErrorCode HantekDsoControl::setRecordLength(unsigned recordLength) {
+    //printf( "setRecordLength( %u )\n", recordLength );
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    controlsettings.recordLength = qBound(unsigned(RECORDLENGTH_DEFAULT), recordLength / 1000 * 1000,
+                                          unsigned(RECORDLENGTH_MAX));
+    channelSetupChanged = true; // skip next raw samples block, it has the old length
+    // a longer record allows a higher samplerate for the same timebase
+    this->restoreTargets();
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setPeakDetect(bool enabled) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    if (controlsettings.peakDetect != enabled) {
+        controlsettings.peakDetect = enabled;
+        channelSetupChanged = true; // restart a rolling trace with the new mode
+    }
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setSegmentedCapture(unsigned count, unsigned length) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    length = qBound(unsigned(SEGMENT_LENGTH_MIN), length, unsigned(RECORDLENGTH_MAX));
+    count = qMin(count, qMin(unsigned(SEGMENT_COUNT_MAX), unsigned(SEGMENT_ARENA_MAX) / length));
+    if (count != controlsettings.segmentCount || length != controlsettings.segmentLength) {
+        controlsettings.segmentCount = count;
+        controlsettings.segmentLength = length;
+        channelSetupChanged = true; // start the sequence with the new setup
+    }
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setEtsFactor(unsigned factor) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    controlsettings.etsFactor = qBound(1u, factor, unsigned(ETS_FACTOR_MAX));
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setAveraging(Dso::AveragingMode mode, unsigned count) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    controlsettings.averaging = mode;
+    controlsettings.averageCount = qBound(1u, count, unsigned(AVERAGE_COUNT_MAX));
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setHistoryMemory(unsigned megabytes) {
+    finishConversion(); // the worker must not record while the memory is exchanged
+    history.configure(size_t(megabytes) << 20, HISTORY_FRAMES_MAX);
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::replayHistory(unsigned age) {
+    if (!age) { // back to the live acquisition
+        enableSampling(true);
+        return Dso::ErrorCode::NONE;
+    }
+    if (sampling)
+        enableSampling(false);
+    finishConversion();
+    HistoryFrame frame;
+    if (!history.frame(age - 1, frame))
+        return Dso::ErrorCode::PARAMETER;
+    RawBuffer *rawData = rawBufferPool.lease(frame.size);
+    if (!history.copy(frame, *rawData)) { // overwritten while it was copied
+        rawBufferPool.giveBack(rawData);
+        return Dso::ErrorCode::PARAMETER;
+    }
+    {
+        QWriteLocker locker(&result.lock);
+        convertChannels(*rawData, frame.conversion);
+        result.samplerate = frame.conversion.samplerate;
+        result.triggerPosition = frame.triggerPosition;
+        result.triggerFraction = frame.triggerFraction;
+        result.etsCoverage = 0.0;
+        result.averagedFrames = 0;
+        result.liveTrigger = frame.triggerPosition > 0;
+        result.pulseWidth = frame.pulseWidth;
+        result.triggerEvents = frame.triggerPosition > 0 ? 1 : 0; // the replay shows the first event only
+        result.pulseWidthMin = result.pulseWidthMax = frame.pulseWidth;
+        result.corrupted = frame.corrupted;
+        result.timing = frame.timing;
+    }
+    rawBufferPool.giveBack(rawData);
+    emit statusMessage(tr("Acquisition %1 from %2 ago")
+                           .arg(frame.timing.sequence)
+                           .arg(valueToString((monotonicTime() - frame.timing.received) / 1e9, UNIT_SECONDS, 3)),
+                       0);
+    // the stopped acquisition loop republishes it as long as it is selected
+    if (samplesInFlight.load() == 0)
+        publishSamples();
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setSegmentView(int segment) {
+    segmentView = segment;
+    if (!sampling) { // a running acquisition shows it with the next sequence
+        finishConversion();
+        showSegments(segmentView);
+    }
+    return Dso::ErrorCode::NONE;
 }
 
 
@@ -388,20 +743,16 @@ Dso::ErrorCode HantekDsoControl::setRecordTime(double duration) {
     }
     //printf( "duration = %g\n", duration );
 
-    double srLimit;
-    if ( isFastRate() )
-        srLimit = (specification->samplerate.single).max;
-    else
-        srLimit = (specification->samplerate.multi).max;
-    // For now - we go for the SAMPLESIZE_USED (= 20000) size sampling, defined in model6022.h
-    // Find highest samplerate using less equal half of these samples to obtain our duration.
+    double srLimit = getSamplerateLimit();
+    // Find highest samplerate using less equal half of the record length to obtain our duration.
     unsigned sampleId = 0;
     for (unsigned id = 0; id < specification->fixedSampleRates.size(); ++id) {
         double sRate = specification->fixedSampleRates[id].samplerate;
         //qDebug() << "id:" << id << "sRate:" << sRate << "sRate*duration:" << sRate * duration;
         // Ensure that at least 1/2 of remaining samples are available for SW trigger algorithm
         // for stability reason avoid the highest sample rate as default
-        if ( sRate < srLimit && sRate * duration <= SAMPLESIZE_USED / 2 ) {
+        if ( sRate < srLimit &&
+             sRate * duration <= recordLengthFor( specification->fixedSampleRates[id].downsampling ) / 2 ) {
             sampleId = id;
         }
     }
@@ -558,6 +909,45 @@ Dso::ErrorCode HantekDsoControl::setTriggerSlope(Dso::Slope slope) {
 }
 
 
+Dso::ErrorCode HantekDsoControl::setFastAcquisition(bool enabled) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    controlsettings.trigger.fastAcquisition = enabled;
+    return Dso::ErrorCode::NONE;
+}
+
+
+Dso::ErrorCode HantekDsoControl::setTriggerType(Dso::TriggerType type) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    controlsettings.trigger.type = type;
+    return Dso::ErrorCode::NONE;
+}
+
+
+// pulse width limits or timeout in s
+Dso::ErrorCode HantekDsoControl::setTriggerCondition(Dso::TriggerCondition condition, double time,
+                                                     double timeUpper) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    if (time < 0 || timeUpper < 0)
+        return Dso::ErrorCode::PARAMETER;
+    controlsettings.trigger.condition = condition;
+    controlsettings.trigger.time = time;
+    controlsettings.trigger.timeUpper = timeUpper;
+    return Dso::ErrorCode::NONE;
+}
+
+
+// other level of the runt and window band in Volt
+Dso::ErrorCode HantekDsoControl::setTriggerSecondLevel(double level) {
+    if (!device->isConnected())
+        return Dso::ErrorCode::CONNECTION;
+    controlsettings.trigger.secondLevel = level;
+    return Dso::ErrorCode::NONE;
+}
+
+
 // set trigger position (0.0 - 1.0)
 Dso::ErrorCode HantekDsoControl::setTriggerPosition(double position) {
     if (!device->isConnected())
@@ -577,18 +967,15 @@ unsigned HantekDsoControl::searchTriggerPoint( Dso::Slope dsoSlope, unsigned int
         slope = -1;
     else return 0;
 
-    ChannelID channel = controlsettings.trigger.source;
-    const std::vector<double> &samples = result.data[channel];
-    size_t sampleCount = samples.size();    ///< number of available samples
+    size_t sampleCount = rawTrigger.size();    ///< number of available samples
     // printf("searchTriggerPoint( %d, %d )\n", (int)dsoSlope, startPos );
     if ( startPos >= sampleCount )
         return 0;
-    double level = controlsettings.trigger.level[channel];
-    double timeDisplay = controlsettings.samplerate.target.duration; // time for full screen width
-    double sampleRate = controlsettings.samplerate.current;
+    double timeDisplay = converting.duration; // time for full screen width
+    double sampleRate = converting.samplerate;
     double samplesDisplay = timeDisplay * sampleRate;
 
-    unsigned preTrigSamples = startPos ? startPos : (unsigned)(controlsettings.trigger.position * samplesDisplay); // samples left of trigger
+    unsigned preTrigSamples = startPos ? startPos : (unsigned)(converting.trigger.position * samplesDisplay); // samples left of trigger
     unsigned postTrigSamples = (unsigned)sampleCount - ((unsigned)samplesDisplay - preTrigSamples); // samples right of trigger
     // |-----------samples-----------| // available sample
     // |--disp--|                      // display size
@@ -597,67 +984,77 @@ unsigned HantekDsoControl::searchTriggerPoint( Dso::Slope dsoSlope, unsigned int
     // |--(samp-(disp-pre))-------|>>|
     // |<<<<<|????????????????????|>>| // ?? = search for trigger in this range [left,right]
 
-    const unsigned swTriggerSampleSet = controlsettings.trigger.smooth ? 10 : 1; // check this number of samples before/after trigger point ...
-    const unsigned swTriggerThreshold = controlsettings.trigger.smooth ? 5 : 0; // ... and get at least this number below or above trigger
+    const unsigned swTriggerSampleSet = converting.trigger.smooth ? 10 : 1; // check this number of samples before/after trigger point ...
+    const unsigned swTriggerThreshold = converting.trigger.smooth ? 5 : 0; // ... and get at least this number below or above trigger
     if ( postTrigSamples > sampleCount - 2 * ( swTriggerSampleSet + 1 ) )
         postTrigSamples = sampleCount - 2 * ( swTriggerSampleSet + 1 );
     // printf( "pre: %d, post %d\n", preTrigSamples, postTrigSamples );
 
-    double prev = INT_MAX * slope;
-    unsigned swTriggerStart = 0;
-    for (unsigned int i = preTrigSamples; i < postTrigSamples; i++) {
-        if ( slope * samples[i] >= slope * level && slope * prev < slope * level ) { // trigger condition met
-            // check for the next few SampleSet samples, if they are also above/below the trigger value
-            unsigned int before = 0;
-            for (unsigned int k = i - 1; k >= i - swTriggerSampleSet && k > 0; k--) {
-                if ( slope * samples[k] < slope * level )
-                    before++;
-            }
-            unsigned int after = 0;
-            for (unsigned int k = i + 1; k <= i + swTriggerSampleSet && k < sampleCount; k++) {
-                if ( slope * samples[k] >= slope * level )
-                    after++;
-            }
-            // if at least >Threshold (=5) samples before and after trig meet the condition, set trigger
-            if ( before > swTriggerThreshold && after > swTriggerThreshold ) {
-                swTriggerStart = i-1;
-                break;
-            }
-        }
-        prev = samples[i];
-    }
-    return swTriggerStart;
+    // the samples are compared with the trigger level in the raw domain, before their conversion
+    return rawTrigger.search( slope, preTrigSamples, postTrigSamples, swTriggerSampleSet, swTriggerThreshold );
+}
+
+
+// search for the next event of the pulse width, runt, window or timeout trigger
+unsigned HantekDsoControl::searchTriggerCondition( Dso::RawTrigger::ConditionState &state, unsigned startPos,
+                                                   unsigned &width ) {
+    width = 0;
+    const size_t sampleCount = rawTrigger.size();
+    if ( startPos >= sampleCount )
+        return 0;
+    const double sampleRate = converting.samplerate;
+    const double samplesDisplay = converting.duration * sampleRate;
+    // same search range as searchTriggerPoint(), the whole screen has to be available around the event
+    unsigned preTrigSamples = startPos ? startPos : (unsigned)(converting.trigger.position * samplesDisplay);
+    unsigned postTrigSamples = (unsigned)sampleCount - ((unsigned)samplesDisplay - preTrigSamples);
+    if ( postTrigSamples > sampleCount - 1 )
+        postTrigSamples = unsigned( sampleCount - 1 );
+
+    Dso::RawTrigger::Condition condition;
+    condition.type = converting.trigger.type;
+    condition.slope = converting.trigger.slope;
+    condition.condition = converting.trigger.condition;
+    condition.time = unsigned( converting.trigger.time * sampleRate + 0.5 );
+    condition.timeUpper = unsigned( converting.trigger.timeUpper * sampleRate + 0.5 );
+    return rawTrigger.findCondition( condition, state, preTrigSamples, postTrigSamples, width );
 }
 
 
 unsigned HantekDsoControl::softwareTrigger() {
-    static Dso::Slope nextSlope = Dso::Slope::Positive; // for alternating slope mode X
-    ChannelID channel = controlsettings.trigger.source;
-    // Trigger channel not in use
-    if (!controlsettings.voltage[channel].used || result.data.empty()) {
-        return result.triggerPosition = 0;
-    }
     //printf( "HDC::softwareTrigger()\n" );
+    // not triggered until found, nothing of the last frame must survive an early return
     triggerPositionRaw = 0;
     result.triggerPosition = 0;
+    result.triggerFraction = 0.0;
     result.pulseWidth = 0.0;
+    ChannelID channel = converting.trigger.source;
+    // Trigger channel not in use
+    if (!converting.voltage[channel].used || !rawTrigger.size()) {
+        return 0;
+    }
 
-    size_t sampleCount = result.data[channel].size(); // number of available samples
-    double timeDisplay = controlsettings.samplerate.target.duration; // time for full screen width
-    double sampleRate = controlsettings.samplerate.current;
+    size_t sampleCount = rawTrigger.size(); // number of available samples
+    double timeDisplay = converting.duration; // time for full screen width
+    double sampleRate = converting.samplerate;
     double samplesDisplay = timeDisplay * sampleRate;
-    unsigned preTrigSamples = (unsigned)(controlsettings.trigger.position * samplesDisplay);
+    unsigned preTrigSamples = (unsigned)(converting.trigger.position * samplesDisplay);
     //printf( "sC %lu, tD %g, sR %g, sD %g\n", sampleCount, timeDisplay, sampleRate, samplesDisplay );
     if (samplesDisplay >= sampleCount) {
         // For sure not enough samples to adjust for jitter.
         timestampDebug(QString("Too few samples to make a steady picture. Decrease sample rate"));
-        return result.triggerPosition = 0;
+        return 0;
     }
 
     // search for trigger point in a range that leaves enough samples left and right of trigger for display
     // find also the alternate slope after trigger point -> calculate pulse width.
-    if ( controlsettings.trigger.slope != Dso::Slope::Both  ) {
-        triggerPositionRaw = searchTriggerPoint( nextSlope = controlsettings.trigger.slope );
+    if ( converting.trigger.type != Dso::TriggerType::Edge ) { // one scan of the trigger state machine
+        Dso::RawTrigger::ConditionState state;
+        unsigned width;
+        triggerPositionRaw = searchTriggerCondition( state, 0, width );
+        if ( triggerPositionRaw && width )
+            result.pulseWidth = width / sampleRate;
+    } else if ( converting.trigger.slope != Dso::Slope::Both  ) {
+        triggerPositionRaw = searchTriggerPoint( nextSlope = converting.trigger.slope );
         if ( triggerPositionRaw ) { // triggered -> search also following other slope (calculate pulse width)
             if ( unsigned int slopePos2 = searchTriggerPoint( mirrorSlope( nextSlope ), triggerPositionRaw ) )
                 result.pulseWidth = (slopePos2 - triggerPositionRaw) / sampleRate;
@@ -673,38 +1070,272 @@ unsigned HantekDsoControl::softwareTrigger() {
 
     if ( triggerPositionRaw ) { // triggered
         result.triggerPosition = triggerPositionRaw - preTrigSamples;  // shift to screen position
+        result.triggerFraction = triggerFraction( triggerPositionRaw );   // and the sub-sample crossing
     }
     // printf( "nextSlope %c, triggerPositionRaw %d\n", "/\\"[(int)nextSlope], triggerPositionRaw );
     return result.triggerPosition;
 }
 
 
+// the crossing of the trigger level between the trigger sample and the next one
+double HantekDsoControl::triggerFraction( unsigned position ) const {
+    const Dso::TriggerType type = converting.trigger.type;
+    if ( type == Dso::TriggerType::Timeout ) // the event is the elapsed time, not a crossing
+        return 0.0;
+    const ChannelID channel = converting.trigger.source;
+    const Dso::RawConverter &converter = conversion.converters[ channel ];
+    double fraction =
+        rawTrigger.crossing( converter, conversion.downsampling, position, converting.trigger.level[ channel ] );
+    if ( fraction < 0 && ( type == Dso::TriggerType::Runt || type == Dso::TriggerType::Window ) )
+        fraction = rawTrigger.crossing( converter, conversion.downsampling, position,
+                                        converting.trigger.secondLevel );
+    return fraction < 0 ? 0.0 : fraction;
+}
+
+
+// the next trigger event from startPos on, of either slope in the alternating slope mode
+unsigned HantekDsoControl::searchNextTrigger( Dso::RawTrigger::ConditionState &state, unsigned startPos,
+                                              unsigned *width ) {
+    unsigned conditionWidth = 0;
+    if ( converting.trigger.type != Dso::TriggerType::Edge ) {
+        const unsigned trigger = searchTriggerCondition( state, startPos, conditionWidth );
+        if ( width )
+            *width = conditionWidth;
+        return trigger;
+    }
+    Dso::Slope slope = converting.trigger.slope;
+    unsigned trigger;
+    if ( slope == Dso::Slope::Both ) { // the first edge of either slope
+        const unsigned rising = searchTriggerPoint( Dso::Slope::Positive, startPos );
+        const unsigned falling = searchTriggerPoint( Dso::Slope::Negative, startPos );
+        trigger = rising && falling ? qMin( rising, falling ) : rising + falling;
+        slope = trigger == rising ? Dso::Slope::Positive : Dso::Slope::Negative;
+    } else {
+        trigger = searchTriggerPoint( slope, startPos );
+    }
+    if ( width ) { // up to the next edge of the other slope, like softwareTrigger()
+        const unsigned other = trigger ? searchTriggerPoint( mirrorSlope( slope ), trigger ) : 0;
+        *width = other ? other - trigger : 0;
+    }
+    return trigger;
+}
+
+
+void HantekDsoControl::overlayTriggerEvents(const RawBuffer &rawData) {
+    QWriteLocker locker(&result.lock);
+    result.triggerEvents = result.triggerPosition > 0 ? 1 : 0;
+    result.pulseWidthMin = result.pulseWidthMax = result.pulseWidth;
+    if ( !result.triggerEvents )
+        return;
+    frameCounters().waveforms.fetchAndAddRelaxed( 1 );
+    if ( !converting.trigger.fastAcquisition )
+        return;
+
+    const double sampleRate = converting.samplerate;
+    const size_t sampleCount = rawTrigger.size();
+    const unsigned count = conversion.count;
+    // the shown trace is the first trigger event, the envelope collects the windows of all events
+    for (ChannelID channel = 0; channel < specification->channels; ++channel) {
+        if ( !( conversion.channels & ( 0x01 << channel ) ) )
+            continue;
+        if ( result.peakMin[ channel ].size() != count ) { // no peak detect, start with the samples
+            result.peakMin[ channel ].assign( result.data[ channel ].begin(), result.data[ channel ].end() );
+            result.peakMax[ channel ].assign( result.data[ channel ].begin(), result.data[ channel ].end() );
+        }
+    }
+    overlaySamples.resize( count );
+    if ( conversion.peakDetect ) {
+        overlayMin.resize( count );
+        overlayMax.resize( count );
+    }
+
+    Dso::RawTrigger::ConditionState state; // continues after the first event
+    unsigned trigger = triggerPositionRaw;
+    unsigned events = 1;
+    while ( events < FAST_ACQUISITION_EVENTS_MAX ) {
+        unsigned width = 0;
+        const unsigned next = searchNextTrigger( state, trigger + 1, &width );
+        if ( !next )
+            break;
+        const size_t offset = next - triggerPositionRaw; // same position on the screen as the first event
+        if ( displayFirst + offset + count > sampleCount )
+            break;
+        trigger = next;
+        const size_t position = conversion.position + offset * conversion.downsampling * conversion.stride;
+        for (ChannelID channel = 0; channel < specification->channels; ++channel) {
+            if ( !( conversion.channels & ( 0x01 << channel ) ) )
+                continue;
+            if ( conversion.converters[ channel ].convert( rawData, position + channel, conversion.stride,
+                                                           conversion.downsampling, count, overlaySamples.data(),
+                                                           conversion.peakDetect ? overlayMin.data() : nullptr,
+                                                           conversion.peakDetect ? overlayMax.data() : nullptr ) )
+                result.clipped |= 0x01 << channel;
+            const float *lower = conversion.peakDetect ? overlayMin.data() : overlaySamples.data();
+            const float *upper = conversion.peakDetect ? overlayMax.data() : overlaySamples.data();
+            float *peakMin = result.peakMin[ channel ].data();
+            float *peakMax = result.peakMax[ channel ].data();
+            for ( unsigned index = 0; index < count; ++index ) {
+                peakMin[ index ] = qMin( peakMin[ index ], lower[ index ] );
+                peakMax[ index ] = qMax( peakMax[ index ], upper[ index ] );
+            }
+        }
+        if ( width ) {
+            const double pulseWidth = width / sampleRate;
+            if ( result.pulseWidthMin == 0.0 || pulseWidth < result.pulseWidthMin )
+                result.pulseWidthMin = pulseWidth;
+            result.pulseWidthMax = qMax( result.pulseWidthMax, pulseWidth );
+        }
+        ++events;
+    }
+    result.triggerEvents = events;
+    frameCounters().waveforms.fetchAndAddRelaxed( events - 1 );
+}
+
+
+void HantekDsoControl::accumulateAverage() {
+    QWriteLocker locker(&result.lock);
+    result.averagedFrames = 0;
+    // only triggered frames are aligned, the equivalent-time sampling needs the single frames
+    if ( converting.averaging == Dso::AveragingMode::Off || converting.etsFactor > 1 ||
+         result.triggerPosition <= 0 )
+        return;
+    const unsigned samplesDisplay =
+        unsigned( std::ceil( converting.duration * converting.samplerate ) );
+    averager.configure( converting.averaging, converting.averageCount, samplesDisplay,
+                        specification->channels, result.samplerate, converting.peakDetect );
+    averager.add( result );
+    averager.view( result );
+    result.averagedFrames = averager.size();
+}
+
+
+void HantekDsoControl::accumulateEts() {
+    QWriteLocker locker(&result.lock);
+    result.etsCoverage = 0.0;
+    // only triggered screens are aligned, triggering() keeps the last grid in NORMAL mode
+    if ( converting.etsFactor < 2 || result.triggerPosition <= 0 )
+        return;
+    const unsigned samplesDisplay =
+        unsigned( std::ceil( converting.duration * converting.samplerate ) );
+    ets.configure( converting.etsFactor, samplesDisplay, specification->channels, result.samplerate );
+    ets.add( result.data, unsigned( result.triggerPosition ), result.triggerFraction );
+    ets.view( result );
+    result.etsCoverage = ets.coverage();
+}
+
+
 void HantekDsoControl::triggering() {
     //printf( "HDC::triggering()\n" );
-    static DSOsamples triggeredResult; // storage for last triggered trace samples
     if ( result.triggerPosition > 0 ) { // live trace has triggered
         // Use this trace and save it also
         triggeredResult.data = result.data;
+        triggeredResult.peakMin = result.peakMin;
+        triggeredResult.peakMax = result.peakMax;
         triggeredResult.samplerate = result.samplerate;
         triggeredResult.clipped = result.clipped;
+        triggeredResult.corrupted = result.corrupted;
         triggeredResult.triggerPosition = result.triggerPosition;
+        triggeredResult.triggerFraction = result.triggerFraction;
+        triggeredResult.etsCoverage = result.etsCoverage;
+        triggeredResult.averagedFrames = result.averagedFrames;
+        triggeredResult.triggerEvents = result.triggerEvents;
+        triggeredResult.pulseWidthMin = result.pulseWidthMin;
+        triggeredResult.pulseWidthMax = result.pulseWidthMax;
+        result.timing.triggered = monotonicTime();
+        triggeredResult.timing = result.timing;
         result.liveTrigger = true; // show green "TR" top left
-    } else if ( controlsettings.trigger.mode == Dso::TriggerMode::NORMAL ) { // Not triggered in NORMAL mode
+    } else if ( converting.trigger.mode == Dso::TriggerMode::NORMAL ) { // Not triggered in NORMAL mode
         // Use saved trace (even if it is empty)
         result.data = triggeredResult.data; 
+        result.peakMin = triggeredResult.peakMin;
+        result.peakMax = triggeredResult.peakMax;
         result.samplerate = triggeredResult.samplerate;
         result.clipped = triggeredResult.clipped;
+        result.corrupted = triggeredResult.corrupted;
         result.triggerPosition = triggeredResult.triggerPosition;
+        result.triggerFraction = triggeredResult.triggerFraction;
+        result.etsCoverage = triggeredResult.etsCoverage;
+        result.averagedFrames = triggeredResult.averagedFrames;
+        result.triggerEvents = triggeredResult.triggerEvents;
+        result.pulseWidthMin = triggeredResult.pulseWidthMin;
+        result.pulseWidthMax = triggeredResult.pulseWidthMax;
+        result.timing = triggeredResult.timing; // the frame of the saved trace
         result.liveTrigger = false; // show red "TR" top left
     } else { // Not triggered and not NORMAL mode
         // Use the free running trace, discard history
-        triggeredResult.data.clear(); // discard trace
+        for ( auto &channelData : triggeredResult.data )
+            channelData.clear(); // discard trace, but keep the capacity
         triggeredResult.triggerPosition = 0; // not triggered
         result.liveTrigger = false; // show red "TR" top left
+        result.timing.triggered = monotonicTime();
     }
 }
 
 
+void HantekDsoControl::captureSegments(const RawBuffer &rawData) {
+    if (!rawTrigger.size()) // the trigger channel is not used
+        return;
+    segments.configure(converting.segmentCount, converting.segmentLength, specification->channels);
+    capturedSegments.configure(converting.segmentCount, converting.segmentLength, specification->channels);
+
+    const size_t sampleCount = rawTrigger.size();
+    const unsigned length = segments.length();
+    const double samplesDisplay = converting.duration * result.samplerate;
+    // the trigger point is at the pretrigger position of the screen, one more sample precedes the screen,
+    // searchTriggerPoint() returns the sample before the edge
+    const unsigned preTrigSamples = qMin(unsigned(converting.trigger.position * samplesDisplay), length - 2);
+    SegmentInfo info;
+    info.sequence = result.timing.sequence;
+    bool converted = false;
+
+    // search the whole block, the segments of one block do not overlap
+    unsigned searchFrom = preTrigSamples + 2;
+    Dso::RawTrigger::ConditionState conditionState; // the advanced triggers scan the block only once
+    while (!segments.isFull()) {
+        const unsigned trigger = searchNextTrigger(conditionState, searchFrom);
+        if (!trigger)
+            break;
+        const size_t start = trigger - preTrigSamples - 1;
+        if (start + length > sampleCount) // the window is not complete, the next block may have it
+            break;
+        if (!converted) { // blocks without a trigger are not converted at all
+            convertRawDataToSamples(rawData, 0, conversion.count);
+            info.clipped = result.clipped;
+            info.corrupted = result.corrupted;
+            converted = true;
+        }
+        info.time = result.timing.received - qint64((sampleCount - trigger) * 1e9 / result.samplerate);
+        segments.append(result.data, start, result.samplerate, info);
+        searchFrom = trigger + length - preTrigSamples;
+    }
+    if (!segments.isFull())
+        return;
+
+    // sequence complete, keep it for the display and the review, capture the next one
+    std::swap(segments, capturedSegments);
+    segments.clear();
+    const unsigned captured = capturedSegments.size();
+    const double duration = (capturedSegments.info(captured - 1).time - capturedSegments.info(0).time) / 1e9;
+    emit statusMessage(tr("%1 segments in %2").arg(captured).arg(valueToString(duration, UNIT_SECONDS, 3)), 0);
+    showSegments(converting.segmentView);
+    segmentsCompleted = true;
+}
+
+
+void HantekDsoControl::showSegments(int view) {
+    if (!capturedSegments.size())
+        return;
+    QWriteLocker locker(&result.lock);
+    const unsigned last = capturedSegments.size() - 1;
+    const unsigned shown = view < 0 ? last : qMin(unsigned(view), last);
+    capturedSegments.view(result, view);
+    result.timing = FrameTiming(); // the acquisition of the shown segment
+    result.timing.sequence = capturedSegments.info(shown).sequence;
+    result.timing.received = result.timing.converted = result.timing.triggered = capturedSegments.info(shown).time;
+    result.timing.captured = result.timing.received - qint64(result.triggerPosition * 1e9 / result.samplerate);
+}
+
+
 Dso::ErrorCode HantekDsoControl::setCalFreq( double calfreq ) {
     unsigned int cf = (int)calfreq / 1000; // 1000, ..., 100000 -> 1, ..., 100
     if ( cf == 0 ) // 50, 100, 200, 500 -> 105, 110, 120, 150
@@ -764,11 +1395,121 @@ const ControlCommand *HantekDsoControl::getCommand(ControlCode code) const { ret
 
 
 void HantekDsoControl::run() {
+    if (!scheduling.isDefault()) {
+        QString message;
+        if (scheduling.apply(message))
+            qDebug() << "Acquisition thread:" << message;
+        else
+            emit statusMessage(tr("Acquisition thread: %1").arg(message), 0);
+    }
+    if (latencyWatchdog) {
+        watchdog.reset(new LatencyWatchdog(scheduling));
+        watchdog->start();
+    }
+    QElapsedTimer rateTimer;
+    rateTimer.start();
+    unsigned acquisitions = 0;
+    quint64 waveforms = frameCounters().waveforms.load();
+    quint64 transferred = device->getStatistics().bytes.load();
+    while (!QThread::currentThread()->isInterruptionRequested() && device->isConnected()) {
+        if (watchdog)
+            watchdog->beat();
+        // Handle the setting changes that were queued during the last acquisition
+        QCoreApplication::processEvents();
+        if (!sendPendingCommands())
+            break;
+
+        if (this->sampling && isRollMode()) {
+            acquireRoll();
+            ++acquisitions;
+        } else if (this->sampling || this->_samplingStarted) {
+            acquire();
+            ++acquisitions;
+        } else { // not sampling, republish the last samples to allow user interaction
+            finishConversion();
+            if (samplesInFlight.load() == 0)
+                publishSamples();
+            QThread::msleep((unsigned long)qBound(10.0, processingTime, 100.0));
+        }
+        if (!pipelined) // leave the CPU to the post processing
+            waitForDownstream();
+        processingTime = 0.9 * processingTime + 0.1 * lastProcessingTime.load() / 1000.0;
+
+        if (rateTimer.elapsed() >= 1000) {
+            const qint64 elapsed = rateTimer.restart();
+            tuneFastTransfers();
+            const double rate = acquisitions * 1000.0 / elapsed;
+            acquisitions = 0;
+            timestampDebug(QString("Acquisitions/s %1, turnaround %2 ms, processing %3 ms")
+                               .arg(rate)
+                               .arg(turnaroundTime)
+                               .arg(processingTime));
+            timestampDebug(QString("Frames of %1: %2") // the thread is named after the device of the group
+                               .arg(QThread::currentThread()->objectName())
+                               .arg(frameCounters().toString()));
+            emit acquisitionRateChanged(rate);
+            const quint64 shown = frameCounters().waveforms.load();
+            emit waveformRateChanged((shown - waveforms) * 1000.0 / elapsed);
+            waveforms = shown;
+            const quint64 received = device->getStatistics().bytes.load();
+            emit transferRateChanged((received - transferred) * 1000.0 / elapsed);
+            transferred = received;
+            if (watchdog) {
+                const QString report = watchdog->report();
+                timestampDebug(report);
+                emit schedulingLatencyChanged(report);
+            }
+        }
+    }
+    watchdog.reset();
+    finishConversion();
+    if (!device->isConnected())
+        emit statusMessage(tr("The oscilloscope was disconnected, waiting for it to return ..."), 0);
+}
+
+
+void HantekDsoControl::reconnectDevice(libusb_device *rawDevice) {
+    // queued slots are also handled by the running acquisition loop, the device is still fine then
+    const bool reattached = !device->isConnected() && device->reattach(rawDevice);
+    libusb_unref_device(rawDevice);
+    if (!reattached)
+        return;
+    if (device->needsFirmware()) { // it lost the firmware, the renumerated device arrives again
+        UploadFirmware uploadFirmware;
+        if (!uploadFirmware.startUpload(device))
+            emit statusMessage(uploadFirmware.getErrorMessage(), 0);
+        return;
+    }
+    QString errorMessage;
+    if (!device->connectDevice(errorMessage)) {
+        emit statusMessage(tr("Reconnecting failed: %1").arg(errorMessage), 0);
+        return;
+    }
+    timestampDebug("Device reconnected");
+    if (specification->fixedUSBinLength)
+        device->overwriteInPacketLength(specification->fixedUSBinLength);
+    // the device restarts with its defaults, send the complete setup again
+    for (ControlCommand *controlCommand = firstControlCommand; controlCommand; controlCommand = controlCommand->next)
+        controlCommand->pending = true;
+    if (retrieveChannelLevelData() != Dso::ErrorCode::NONE)
+        return;
+    streamingRoll = false;
+    fastTransfers = TransferConfig(); // it may be connected to another host controller now
+    _samplingStarted = false;
+    channelSetupChanged = true;
+    emit statusMessage(tr("The oscilloscope is connected again"), 3000);
+    emit deviceReconnected();
+}
+
+
+bool HantekDsoControl::sendPendingCommands() {
     int errorCode = 0;
     // Send all pending control commands
     ControlCommand *controlCommand = firstControlCommand;
     while (controlCommand) {
         if (controlCommand->pending) {
+            // data streamed before the change was acquired with the old settings
+            device->flushStream();
             timestampDebug(QString("Sending control command %1:%2")
                                .arg(QString::number(controlCommand->code, 16),
                                     hexDump(controlCommand->data(), controlCommand->size())));
@@ -780,28 +1521,61 @@ void HantekDsoControl::run() {
 
                 if (errorCode == LIBUSB_ERROR_NO_DEVICE) {
                     emit communicationError();
-                    return;
+                    return false;
                 }
             } else
                 controlCommand->pending = false;
         }
         controlCommand = controlCommand->next;
     }
+    return true;
+}
 
-    // State machine for the device communication
-    {
-        std::vector<unsigned char> rawData = this->getSamples(expectedSampleCount);
-        if (this->_samplingStarted) { // feed new samples to postprocess and display
-            convertRawDataToSamples(rawData);
-            softwareTrigger(); // detect trigger point of latest samples
-            triggering();      // present either free running or last triggered trace
-        } // else don't update, reuse old values
-        emit samplesAvailable(&result); // let display run always to allow user interaction
-    }
 
-    // Stop sampling if we're in single trigger mode and have a triggered trace (txh No13)
-    if ( controlsettings.trigger.mode == Dso::TriggerMode::SINGLE && this->_samplingStarted && triggerPositionRaw > 0 ) {
-        this->enableSampling(false);
+void HantekDsoControl::acquire() {
+    // the stream of the roll mode uses small transfers, block mode restarts it if streaming is enabled
+    if (streamingRoll) {
+        device->stopStreaming();
+        streamingRoll = false;
+    }
+    // State machine for the device communication
+    QElapsedTimer transferTimer;
+    transferTimer.start();
+    RawBuffer *rawData = this->getSamples(expectedSampleCount);
+    turnaroundTime = 0.9 * turnaroundTime + 0.1 * transferTimer.nsecsElapsed() / 1e6;
+
+    // the previous block was converted on the worker while this block was read
+    finishConversion();
+    if (this->_samplingStarted && this->sampling) { // feed new samples to postprocess and display
+        convertingRawData = rawData;
+        // the worker uses only this copy, the settings may change while it converts
+        takeConversionSettings();
+        auto convert = [this]() {
+            const bool prepared = prepareConversion(convertingRawData); // false if the block is skipped
+            if (converting.isSegmented()) {
+                segmentsCompleted = false;
+                if (prepared) {
+                    recordHistory(*convertingRawData);
+                    captureSegments(*convertingRawData); // store the windows around all trigger points
+                }
+            } else if (prepared) {
+                softwareTrigger();                     // detect trigger point in the raw samples
+                convertDisplayed(*convertingRawData);  // convert only what is shown
+                overlayTriggerEvents(*convertingRawData); // fast acquisition: the envelope of all trigger events
+                accumulateAverage();                   // average the aligned triggered frames
+                accumulateEts();                       // equivalent-time sampling of repetitive signals
+                recordHistory(*convertingRawData);
+                triggering();                          // present either free running or last triggered trace
+            }
+        };
+        if (pipelined) {
+            conversionWorker.submit(convert);
+        } else {
+            convert();
+            finishConversion();
+        }
+    } else { // don't update, reuse old values
+        rawBufferPool.giveBack(rawData);
     }
 
     // Sampling completed, restart it when necessary
@@ -813,12 +1587,238 @@ void HantekDsoControl::run() {
         timestampDebug("Starting to capture");
         this->_samplingStarted = true;
     }
-    this->updateInterval();
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 4, 0))
-    QTimer::singleShot(cycleTime, this, &HantekDsoControl::run);
-#else
-    QTimer::singleShot(cycleTime, this, SLOT(run()));
-#endif
+}
+
+
+void HantekDsoControl::acquireRoll() {
+    // a block may still be converted on the worker after switching to roll mode
+    finishConversion();
+    const unsigned channels = isFastRate() ? 1 : specification->channels;
+    const unsigned groupSize = downsampling * channels; // raw bytes of one sample per channel
+    const double samplerate = controlsettings.samplerate.current;
+    // read small chunks that contain whole downsampling groups for a smoothly scrolling trace
+    unsigned chunkSize = unsigned(samplerate * groupSize / ROLL_CHUNKS_PER_SECOND) / groupSize * groupSize;
+    chunkSize = qBound(groupSize, chunkSize, unsigned(RAW_CHUNK_SIZE) / groupSize * groupSize);
+
+    // the device streams continuously, it is started only once
+    if (!device->isStreaming() || !streamingRoll) {
+        device->stopStreaming();
+        int errorCode = device->controlWrite(getCommand(ControlCode::CONTROL_ACQUIIRE_HARD_DATA));
+        // transfers of about one chunk deliver the data of the slow samplerates without delay
+        const unsigned transferSize = qBound(512u, chunkSize / 512 * 512, unsigned(HANTEK_STREAM_TRANSFER_SIZE));
+        if (errorCode >= 0)
+            errorCode = device->startStreaming(transferSize);
+        if (errorCode < 0) {
+            qWarning() << "Roll mode needs streaming, using block mode: " << libUsbErrorString(errorCode);
+            rollModeAvailable = false;
+            return;
+        }
+        streamingRoll = true;
+        channelSetupChanged = true;
+    }
+    device->getStream()->setExpectedRate(samplerate * groupSize);
+
+    const unsigned screenSamples = unsigned(controlsettings.samplerate.target.duration * samplerate + 0.5) + 1;
+    if (channelSetupChanged || screenSamples != rollScreenSamples) { // restart the trace
+        channelSetupChanged = false;
+        rollScreenSamples = screenSamples;
+        rollSkip = ROLL_SKIP_SAMPLES * channels; // the first samples after a change are unstable
+        for (auto &channelData : rollData)
+            channelData.clear(); // keep the capacity
+        for (auto &channelData : rollMin)
+            channelData.clear();
+        for (auto &channelData : rollMax)
+            channelData.clear();
+        rollClippedAt.assign(specification->channels, 0);
+        rollGapAt = 0;
+    }
+
+    RawBuffer *rawData = rawBufferPool.lease(qMax(chunkSize, rollSkip));
+    if (rollSkip) {
+        bool gap = false;
+        int retval = device->bulkReadStream(rawData->chunk(0), rollSkip, &gap);
+        rollSkip = 0;
+        if (retval < 0) {
+            rawBufferPool.giveBack(rawData);
+            return;
+        }
+    }
+    bool gap = false;
+    int retval = device->bulkReadStream(rawData->chunk(0), chunkSize, &gap);
+    if (retval < 0) {
+        qWarning() << "bulkReadStream: Getting sample data failed: " << libUsbErrorString(retval);
+        rawBufferPool.giveBack(rawData);
+        return;
+    }
+    rawData->resize(size_t(retval) / groupSize * groupSize);
+    rawData->received = monotonicTime();
+    rawData->sequence = ++acquisitionSequence;
+    frameCounters().acquired.fetchAndAddRelaxed(1);
+    if (gap)
+        frameCounters().corrupted.fetchAndAddRelaxed(1);
+
+    appendRollSamples(*rawData, gap);
+
+    // Back-pressure: the samples are only appended if the last ones are still processed
+    if (samplesInFlight.load() == 0) {
+        copyRollScreen(*rawData);
+        publishSamples();
+    } else {
+        frameCounters().overwritten.fetchAndAddRelaxed(1); // the chunk is shown with the next one
+    }
+    rawBufferPool.giveBack(rawData);
+}
+
+
+void HantekDsoControl::appendRollSamples(const RawBuffer &rawData, bool gap) {
+    const unsigned channels = isFastRate() ? 1 : specification->channels;
+    const unsigned groupSize = downsampling * channels;
+    const unsigned count = qMin(unsigned(rawData.size() / groupSize), rollScreenSamples);
+    if (!count)
+        return;
+
+    const double samplerate = controlsettings.samplerate.current;
+    rollData.resize(specification->channels);
+    rollMin.resize(specification->channels);
+    rollMax.resize(specification->channels);
+    const bool peakDetect = controlsettings.peakDetect && downsampling > 1;
+    for (ChannelID channel = 0; channel < specification->channels; ++channel) {
+        std::vector<float> &samples = rollData[channel];
+        std::vector<float> &peakMin = rollMin[channel];
+        std::vector<float> &peakMax = rollMax[channel];
+        if (channel >= channels) { // one channel mode only with CH1
+            samples.clear();
+            peakMin.clear();
+            peakMax.clear();
+            continue;
+        }
+        if (!peakDetect) {
+            peakMin.clear();
+            peakMax.clear();
+        }
+        // The trace is the tail of this buffer, copyRollScreen() publishes only the tail.
+        // Dropping the oldest screen when the buffer is full keeps the cost per sample constant.
+        for (std::vector<float> *buffer : {&samples, &peakMin, &peakMax}) {
+            if (buffer != &samples && !peakDetect)
+                continue;
+            if (buffer->size() + count > 2 * rollScreenSamples)
+                buffer->erase(buffer->begin(),
+                              buffer->end() - std::min(buffer->size(), size_t(rollScreenSamples - count)));
+            if (buffer->capacity() < 2 * rollScreenSamples)
+                buffer->reserve(2 * rollScreenSamples);
+        }
+
+        updateConverter(rollConverters[channel], channel, controlsettings.voltage[channel], samplerate);
+        const size_t start = samples.size();
+        samples.resize(start + count);
+        if (peakDetect) {
+            peakMin.resize(start + count);
+            peakMax.resize(start + count);
+        }
+        if (rollConverters[channel].convert(rawData, channel, channels, downsampling, count, samples.data() + start,
+                                            peakDetect ? peakMin.data() + start : nullptr,
+                                            peakDetect ? peakMax.data() + start : nullptr))
+            rollClippedAt[channel] = rollSamples + count; // min or max -> clipped
+    }
+    rollSamples += count;
+    if (gap)
+        rollGapAt = rollSamples;
+    frameCounters().converted.fetchAndAddRelaxed(1);
+}
+
+
+void HantekDsoControl::copyRollScreen(const RawBuffer &rawData) {
+    const unsigned channels = isFastRate() ? 1 : specification->channels;
+    QWriteLocker locker(&result.lock);
+    result.samplerate = controlsettings.samplerate.current;
+    result.data.resize(specification->channels);
+    result.peakMin.resize(specification->channels);
+    result.peakMax.resize(specification->channels);
+    result.liveTrigger = false;
+    result.pulseWidth = 0.0;
+    result.triggerEvents = 0;
+    result.clipped = 0;
+    size_t size = 0;
+    for (ChannelID channel = 0; channel < specification->channels; ++channel) {
+        const std::vector<float> *sources[] = {&rollData[channel], &rollMin[channel], &rollMax[channel]};
+        std::vector<float> *targets[] = {&result.data[channel], &result.peakMin[channel], &result.peakMax[channel]};
+        for (unsigned index = 0; index < 3; ++index) {
+            const std::vector<float> &source = *sources[index];
+            const size_t count = std::min(source.size(), size_t(rollScreenSamples));
+            targets[index]->assign(source.end() - count, source.end()); // keeps the capacity
+        }
+        size = std::max(size, result.data[channel].size());
+    }
+
+    // flag the channels as long as a clipped sample or a gap is on screen
+    for (ChannelID channel = 0; channel < channels; ++channel) {
+        if (rollClippedAt[channel] && rollClippedAt[channel] + rollScreenSamples > rollSamples)
+            result.clipped |= 0x01 << channel;
+    }
+    result.corrupted = rollGapAt && rollGapAt + rollScreenSamples > rollSamples;
+    result.triggerPosition = 0; // the screen, the post processing needs no older samples
+    result.triggerFraction = 0.0;
+    result.etsCoverage = 0.0;
+    result.averagedFrames = 0;
+    result.timing.sequence = rawData.sequence;
+    result.timing.received = rawData.received;
+    result.timing.captured = rawData.received - qint64(size * 1e9 / result.samplerate);
+    result.timing.converted = result.timing.triggered = monotonicTime(); // no trigger search
+}
+
+
+void HantekDsoControl::finishConversion() {
+    if (!convertingRawData)
+        return;
+    if (conversionWorker.isBusy())
+        conversionWorker.join();
+    rawBufferPool.giveBack(convertingRawData);
+    convertingRawData = nullptr;
+    timestampDebug(QString("Buffer pool allocations %1").arg(poolAllocations()));
+
+    // Stop sampling if we're in single trigger mode and have a triggered trace (txh No13)
+    // or, in segmented mode, a complete sequence
+    const bool triggered = converting.isSegmented() ? segmentsCompleted : triggerPositionRaw > 0;
+    const bool singleTriggered = converting.trigger.mode == Dso::TriggerMode::SINGLE && triggered;
+    // the segmented mode shows only complete sequences
+    const bool publishable = !converting.isSegmented() || segmentsCompleted;
+    // Back-pressure: skip the display of this block if the last one is still processed
+    if (publishable && (singleTriggered || samplesInFlight.load() == 0))
+        publishSamples();
+    else if (publishable && result.timing.sequence != publishedSequence)
+        frameCounters().overwritten.fetchAndAddRelaxed(1);
+    if (singleTriggered)
+        this->enableSampling(false);
+}
+
+
+void HantekDsoControl::publishSamples() {
+    samplesInFlight.store(1);
+    publishTime.store(clock.nsecsElapsed());
+    if (result.timing.sequence != publishedSequence) { // a republished frame is not counted again
+        publishedSequence = result.timing.sequence;
+        frameCounters().published.fetchAndAddRelaxed(1);
+    }
+    emit samplesAvailable(&result);
+}
+
+
+void HantekDsoControl::samplesProcessed() {
+    lastProcessingTime.store(int((clock.nsecsElapsed() - publishTime.load()) / 1000));
+    samplesInFlight.store(0);
+}
+
+
+void HantekDsoControl::waitForDownstream() {
+    // wait until the post processing took the last samples, but not much longer than usual
+    const qint64 limit = qint64(qBound(1.0, 2 * processingTime, 500.0));
+    QElapsedTimer waited;
+    waited.start();
+    while (samplesInFlight.load() && waited.elapsed() < limit &&
+           !QThread::currentThread()->isInterruptionRequested()) {
+        QCoreApplication::processEvents();
+        QThread::msleep(1);
+    }
 }
 
 
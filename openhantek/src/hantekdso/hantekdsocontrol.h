@@ -5,11 +5,21 @@
 #define NOMINMAX // disable windows.h min/max global methods
 #include <limits>
 
+#include "acquisitionhistory.h"
+#include "bufferpool.h"
+#include "conversionworker.h"
 #include "controlsettings.h"
 #include "controlspecification.h"
 #include "dsosamples.h"
 #include "errorcodes.h"
+#include "etsaccumulator.h"
+#include "latencywatchdog.h"
+#include "rawconverter.h"
+#include "rawtrigger.h"
+#include "segmentstore.h"
 #include "states.h"
+#include "waveformaverager.h"
+#include "usb/transfertuner.h"
 #include "utils/printutils.h"
 
 #include "hantekprotocol/controlStructs.h"
@@ -17,12 +27,15 @@
 
 #include <vector>
 
+#include <QAtomicInteger>
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QStringList>
 #include <QThread>
 #include <QTimer>
 
 class USBDevice;
+struct libusb_device;
 
 /// \brief The DsoControl abstraction layer for %Hantek USB DSOs.
 /// TODO Please anyone, refactor this class into smaller pieces (Separation of Concerns!).
@@ -31,11 +44,9 @@ class HantekDsoControl : public QObject {
 
   public:
     /**
-     * Creates a dsoControl object. The actual event loop / timer is not started.
+     * Creates a dsoControl object. The acquisition loop is not started.
      * You can optionally create a thread and move the created object to the
-     * thread.
-     * You need to call updateInterval() to start the timer. This is done implicitly
-     * if run() is called.
+     * thread and call run() from there.
      * @param device The usb device. This object does not take ownership.
      */
     HantekDsoControl(USBDevice *device);
@@ -43,11 +54,10 @@ class HantekDsoControl : public QObject {
     /// \brief Cleans up
     ~HantekDsoControl();
 
-    /// Call this to start the processing. This method will call itself
-    /// periodically from there on.
-    /// It is wise to move this class object to an own thread and call run from
-    /// there.
-    void run();
+    /// \brief Acknowledge that the samples of the last samplesAvailable() signal were processed.
+    /// Thread safe, connect it directly to the end of the post processing. Until then
+    /// new samples are not published (back-pressure).
+    void samplesProcessed();
 
     /// \brief Gets the physical channel count for this oscilloscope.
     /// \return The number of physical channels.
@@ -71,13 +81,45 @@ class HantekDsoControl : public QObject {
 
     double getSamplerate() const;
 
+    /// \brief Get the record length that is acquired with the current samplerate.
+    /// \return The number of samples per channel of one acquisition.
     unsigned getSamplesize() const;
 
     bool isSampling() const;
 
+    /// \brief Roll mode: the trace scrolls continuously instead of being acquired in blocks.
+    /// It is used in AUTO trigger mode for timebases of ROLL_TIMEBASE_MIN and slower.
+    bool isRollMode() const;
+
+    /// \brief Segmented mode: the windows around the trigger points are collected and shown
+    /// together when the set number of segments is captured.
+    bool isSegmented() const { return controlsettings.segmentCount > 0; }
+
+    /// \brief Read the sample data with a ring of asynchronous bulk transfers.
+    /// The scope is started only once and its FIFO is drained continuously instead of
+    /// requesting and reading one block per cycle. Call before run() is started.
+    void setStreaming(bool enabled) { streaming = enabled; }
+    bool isStreaming() const { return streaming; }
+
+    /// \brief Convert and trigger a block on a worker thread while the next block is read.
+    /// The device is read back to back while sampling, the display is still updated
+    /// only once per cycle time. Call before run() is started.
+    void setPipelined(bool enabled) { pipelined = enabled; }
+    bool isPipelined() const { return pipelined; }
+
+    /// \brief Priority and CPU affinity of the acquisition thread, applied when run() starts.
+    void setScheduling(const ThreadScheduling &threadScheduling) { scheduling = threadScheduling; }
+    /// \brief Measure the scheduling latency and the loop jitter while run() is active,
+    /// see LatencyWatchdog. Call before run() is started.
+    void setLatencyWatchdog(bool enabled) { latencyWatchdog = enabled; }
+
     /// Return the associated usb device.
     const USBDevice *getDevice() const;
 
+    /// \brief The frames of this device that passed or were dropped in the acquisition pipeline.
+    /// Thread safe, the stages after the merge of a group count into the counters of its first device.
+    Dso::FrameCounters &frameCounters() { return counters; }
+
     /// \brief Gets the speed of the connection.
     /// \return The ::ConnectionSpeed of the USB connection.
     int getConnectionSpeed() const;
@@ -111,6 +153,10 @@ class HantekDsoControl : public QObject {
   private:
     bool isFastRate() const;
     unsigned getRecordLength() const;
+    /// \return The selected record length, limited for the given downsampling factor.
+    unsigned recordLengthFor(unsigned downsampling) const;
+    /// \return The highest samplerate for the current channel and streaming setup.
+    double getSamplerateLimit() const;
     void setDownsampling( unsigned downsampling ) { this->downsampling = downsampling; }
 
     Dso::ErrorCode retrieveChannelLevelData();
@@ -119,18 +165,52 @@ class HantekDsoControl : public QObject {
     /// \return The total number of samples the scope should return.
     unsigned getSampleCount() const;
 
-    void updateInterval();
-
     /// \brief Calculates the trigger point from the CommandGetCaptureState data.
     /// \param value The data value that contains the trigger point.
     /// \return The calculated trigger point for the given data.
     static unsigned calculateTriggerPoint(unsigned value);
 
     /// \brief Gets sample data from the oscilloscope
-    std::vector<unsigned char> getSamples(unsigned &expectedSampleCount) const;
+    /// \return A buffer leased from rawBufferPool that has to be given back, nullptr on error.
+    Dso::RawBuffer *getSamples(unsigned &expectedSampleCount);
+
+    /// \brief Get the transfers of the fast stream for this host controller, see TransferTuner.
+    /// The stored ones if the settings have some, the defaults otherwise, they are tuned by tuneFastTransfers().
+    TransferConfig getFastTransfers();
+    /// \brief Judge the transfers of the running fast stream, called once per second by run().
+    /// After TUNER_ONLINE_TIME s the stream is restarted with the configuration its latency calls for,
+    /// a larger one if data was lost. The configuration that stays is stored for this host controller.
+    void tuneFastTransfers();
+
+    /// \brief Set up the conversion of a raw block and prepare the trigger search in its raw data.
+    /// \return false, if the block is skipped.
+    bool prepareConversion(const Dso::RawBuffer *rawData);
+
+    /// \brief Converts the samples [first, first + count) of the prepared raw block into result.
+    void convertRawDataToSamples(const Dso::RawBuffer &rawData, unsigned first, unsigned count);
+
+    /// \brief Convert the window of the prepared block that is shown, relative to the trigger position.
+    /// Nothing is converted if the block did not trigger in NORMAL mode, the last triggered trace is kept.
+    void convertDisplayed(const Dso::RawBuffer &rawData);
+
+    /// \brief Convert the channels of a raw block into result, the caller holds the result lock.
+    void convertChannels(const Dso::RawBuffer &rawData, const Dso::ConversionParameters &parameters);
+
+    /// \brief Store the converted raw block with the conversion parameters in the history.
+    void recordHistory(const Dso::RawBuffer &rawData);
 
-    /// \brief Converts raw oscilloscope data to sample data
-    void convertRawDataToSamples(const std::vector<unsigned char> &rawData);
+    /// \brief Take the settings of the next conversion, see Dso::ConversionSettings.
+    /// Consumes channelSetupChanged, a block that is read meanwhile is converted with the new setup.
+    void takeConversionSettings();
+
+    /// \brief Get the offset and gain correction of a channel from the config file or the eeprom.
+    void getCalibration(ChannelID channel, unsigned gainID, double samplerate, double &offsetError,
+                        double &gainCalibration) const;
+
+    /// \brief Pass the gain, offset and calibration of a channel to its converter.
+    /// \param voltage The amplification settings of the channel, of the conversion or the current ones.
+    void updateConverter(Dso::RawConverter &converter, ChannelID channel, const Dso::ControlSettingsVoltage &voltage,
+                         double samplerate) const;
 
     /// \brief Sets the samplerate based on the parameters calculated by
     /// Control::getBestSamplerate.
@@ -147,14 +227,74 @@ class HantekDsoControl : public QObject {
 
     unsigned searchTriggerPoint( Dso::Slope dsoSlope, unsigned int startPos = 0 );
 
+    /// \brief Search the next event of the advanced trigger types in the prepared block.
+    /// \param state The scan continues where the last search with this state stopped.
+    /// \param width Receives the width of the triggering pulse in samples, 0 if not applicable.
+    /// \return The sample before the event, 0 if there is none.
+    unsigned searchTriggerCondition( Dso::RawTrigger::ConditionState &state, unsigned startPos, unsigned &width );
+
+    /// \brief The sub-sample position of the trigger crossing after the sample before the trigger event.
+    /// \return The fraction of a sample interval in [0, 1], 0 if unknown.
+    double triggerFraction( unsigned position ) const;
+
+    /// \brief Search the next event of the selected trigger type and slope from startPos on.
+    /// \param width Receives the pulse width in samples if not nullptr, 0 if unknown.
+    /// \return The sample before the event, 0 if there is none.
+    unsigned searchNextTrigger( Dso::RawTrigger::ConditionState &state, unsigned startPos,
+                                unsigned *width = nullptr );
+
     Dso::Slope mirrorSlope( Dso::Slope slope ) {
         return ( slope == Dso::Slope::Positive ? Dso::Slope::Negative : Dso::Slope::Positive );
     }
 
     unsigned softwareTrigger();
 
+    /// \brief Fast acquisition: overlay the windows of all further trigger events of the block as envelope.
+    /// The windows have the same screen position as the shown first event.
+    void overlayTriggerEvents(const Dso::RawBuffer &rawData);
+
+    /// \brief Add the triggered screen to the average and show the average.
+    void accumulateAverage();
+
+    /// \brief Equivalent-time sampling: add the triggered screen to the fine grid and show the grid.
+    void accumulateEts();
+
     void triggering();
 
+    /// \brief Store the windows around all trigger points of the prepared block as segments.
+    /// When the sequence is complete the segments are shown and the next sequence is started.
+    void captureSegments(const Dso::RawBuffer &rawData);
+
+    /// \brief Show the captured segments.
+    /// \param view The shown segment, < 0 = overlay of all segments.
+    void showSegments(int view);
+
+    /// \brief Send all pending control commands.
+    /// \return false, if the device is gone.
+    bool sendPendingCommands();
+
+    /// \brief Read one block from the device and start its conversion.
+    void acquire();
+
+    /// \brief Read the next small chunk of the stream and append it to the rolling trace.
+    void acquireRoll();
+
+    /// \brief Convert the chunk and append it to the rolling trace in rollData.
+    void appendRollSamples(const Dso::RawBuffer &rawData, bool gap);
+    /// \brief Copy the visible tail of the rolling trace to result for publishSamples().
+    /// Only the screen is post processed, the measurements and the spectrum do not see older samples.
+    /// \param rawData The last appended chunk, for the timing of the frame.
+    void copyRollScreen(const Dso::RawBuffer &rawData);
+
+    /// \brief Wait for the conversion running on the worker and publish its result.
+    void finishConversion();
+
+    /// \brief Emit samplesAvailable() and track it until samplesProcessed().
+    void publishSamples();
+
+    /// \brief Wait until the post processing is done with the published samples.
+    void waitForDownstream();
+
   private:
     /// Pointers to control commands
     ControlCommand *control[255] = {0};
@@ -167,18 +307,93 @@ class HantekDsoControl : public QObject {
     // Device setup
     const Dso::ControlSpecification *specification; ///< The specifications of the device
     Dso::ControlSettings controlsettings;           ///< The current settings of the device
+    Dso::ConversionSettings converting;             ///< The settings of the block that is converted
 
     // Results
     unsigned downsampling = 1;        ///< Number of downsamples to reduce sample rate
     DSOsamples result;
+    Dso::RawBufferPool rawBufferPool;       ///< Reused buffers for the raw device data
+    Dso::SampleBufferPool sampleBufferPool; ///< Reused buffers for the converted channel data
+    Dso::ConversionParameters conversion;          ///< Conversion of the last block, one converter per channel
+    Dso::AcquisitionHistory history;               ///< The last blocks for a later replay
+    Dso::RawTrigger rawTrigger;                    ///< Trigger search in the raw data of the last block
+    std::vector<Dso::RawConverter> rollConverters; ///< Conversion of the roll mode chunks, one per channel
     unsigned expectedSampleCount = 0; ///< The expected total number of samples at
                                       /// the last check before sampling started
     bool _samplingStarted = false;
-    int cycleTime = 0;
     bool channelSetupChanged = false;
     unsigned triggerPositionRaw = 0;
+    unsigned displayFirst = 0; ///< The first sample of the block converted by convertDisplayed()
+    Dso::Slope nextSlope = Dso::Slope::Positive; ///< For the alternating slope mode
+    DSOsamples triggeredResult; ///< The last triggered trace, shown in NORMAL mode until the next trigger
+    std::vector<float> overlaySamples; ///< Conversion of one trigger window of the fast acquisition
+    std::vector<float> overlayMin;
+    std::vector<float> overlayMax;
+    bool streaming = false; ///< Use asynchronous streaming transfers instead of single bulk reads
+    bool streamingFast = false; ///< The stream runs with the deep transfer ring for the highest samplerates
+    TransferConfig fastTransfers; ///< Transfers of the fast stream, size 0 = not yet chosen
+    QString transferHost;         ///< TransferTuner::hostKey() of the device, empty = keep the defaults
+    bool transfersTuned = false;  ///< fastTransfers are stored or final
+    unsigned tuningSeconds = 0;   ///< Time the fast stream runs with fastTransfers
+    unsigned long long tuningMinRing = 0; ///< Smaller rings of transfers lost data
+    double fastStreamRate = 0.0;  ///< Data rate of the fast stream in bytes per second
+    bool streamingRoll = false; ///< The stream runs with the small transfers of the roll mode
+#ifdef __arm__
+    bool pipelined = false; ///< Convert on conversionWorker while the next block is read
+#else
+    bool pipelined = true; ///< Convert on conversionWorker while the next block is read
+#endif
+    Dso::RawBuffer *convertingRawData = nullptr; ///< Block that is converted by conversionWorker
+    // Roll mode
+    bool rollModeAvailable = true;       ///< false, if the stream for the roll mode could not be started
+    unsigned rollScreenSamples = 0;      ///< Samples per channel of the visible trace
+    unsigned rollSkip = 0;               ///< Raw bytes to drop before the next chunk
+    unsigned long long rollSamples = 0;  ///< Samples per channel appended since the start
+    std::vector<std::vector<float>> rollData; ///< Rolling trace per channel, the screen is its tail
+    std::vector<std::vector<float>> rollMin;  ///< Its peak detect envelope, empty if off
+    std::vector<std::vector<float>> rollMax;
+    std::vector<unsigned long long> rollClippedAt; ///< rollSamples after the last clipped sample, 0 = none
+    unsigned long long rollGapAt = 0;    ///< rollSamples after the last chunk with a gap, 0 = none
+    // Segmented mode
+    Dso::SegmentStore segments;          ///< The segments of the running sequence
+    Dso::SegmentStore capturedSegments;  ///< The segments of the last complete sequence
+    int segmentView = -1;                ///< The shown segment, < 0 = overlay of all segments
+    bool segmentsCompleted = false;      ///< The last conversion completed a sequence
+    // Equivalent-time sampling
+    Dso::EtsAccumulator ets;             ///< The fine time grid of the triggered screens
+    Dso::WaveformAverager averager;      ///< The average of the triggered screens
+    // Frame accounting
+    Dso::FrameCounters counters;                ///< The frames of this device, see frameCounters()
+    unsigned long long acquisitionSequence = 0; ///< Sequence number of the last acquired block
+    unsigned long long publishedSequence = 0;   ///< Sequence number of the last published frame
+    // Pacing of the acquisition loop
+    QElapsedTimer clock;                 ///< Time base for the timing measurements
+    QAtomicInt samplesInFlight;          ///< 1, if published samples were not yet processed
+    QAtomicInteger<qint64> publishTime;  ///< clock time of the last samplesAvailable() in ns
+    QAtomicInt lastProcessingTime;       ///< Post processing time of the last samples in µs
+    double turnaroundTime = 0.0;         ///< Average duration of one device read in ms
+    double processingTime = 0.0;         ///< Average post processing time in ms
+    Dso::ConversionWorker conversionWorker;
+    // Scheduling
+    ThreadScheduling scheduling;         ///< Applied to the acquisition thread by run()
+    bool latencyWatchdog = false;        ///< Run a LatencyWatchdog with the acquisition loop
+    std::unique_ptr<LatencyWatchdog> watchdog;
 
   public slots:
+    /// Call this to start the processing. This method runs the acquisition loop
+    /// until the interruption of the current thread is requested or the device is lost.
+    /// The loop is paced by the USB transfers and by the post processing, see samplesProcessed().
+    /// Queued slot calls are handled between the acquisitions.
+    /// It is wise to move this class object to an own thread and call run from
+    /// there.
+    void run();
+
+    /// \brief Take over the oscilloscope again after it was lost, e.g. by a USB glitch.
+    /// A device without firmware gets it uploaded and arrives again after the renumeration.
+    /// deviceReconnected() is emitted if the device is usable, the acquisition is restarted with run().
+    /// \param rawDevice A plugged in device, the reference of the caller is released.
+    void reconnectDevice(libusb_device *rawDevice);
+
     /// \brief If sampling is disabled, no samplesAvailable() signals are send anymore, no samples
     /// are fetched from the device and no processing takes place.
     /// \param enabled Enables/Disables sampling
@@ -196,6 +411,53 @@ class HantekDsoControl : public QObject {
     /// \return The record time duration that has been set, 0.0 on error.
     Dso::ErrorCode setRecordTime(double duration = 0.0);
 
+    /// \brief Sets the number of samples per channel of one acquisition.
+    /// The samplerate is adapted, long records allow higher samplerates for the same timebase.
+    /// \param recordLength The record length, limited to RECORDLENGTH_DEFAULT .. RECORDLENGTH_MAX.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setRecordLength(unsigned recordLength);
+
+    /// \brief Enables/disables the peak detect mode.
+    /// In peak detect mode the minimum and maximum of each downsampling bucket are kept as envelope,
+    /// so glitches shorter than the sample interval remain visible.
+    /// \param enabled true if the envelope should be acquired.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setPeakDetect(bool enabled);
+
+    /// \brief Sets up the segmented acquisition.
+    /// Only the windows around the trigger points are stored, the display is updated when all
+    /// segments are captured.
+    /// \param count The number of segments of one sequence, 0 switches the segmented mode off.
+    /// \param length The samples per channel of one segment.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setSegmentedCapture(unsigned count, unsigned length);
+
+    /// \brief Selects the segment of the last sequence that is shown.
+    /// \param segment The segment index, < 0 shows the last segment with the envelope of all segments.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setSegmentView(int segment);
+
+    /// \brief Sets up the equivalent-time sampling of repetitive signals.
+    /// \param factor The bins of the time grid per sample interval, 1 switches it off.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setEtsFactor(unsigned factor);
+
+    /// \brief Sets up the averaging of the triggered frames.
+    /// \param count The number of averaged frames.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setAveraging(Dso::AveragingMode mode, unsigned count);
+
+    /// \brief Sets the memory of the acquisition history, the stored acquisitions are discarded.
+    /// \param megabytes The memory for the raw data in MiB, 0 switches the history off.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setHistoryMemory(unsigned megabytes);
+
+    /// \brief Shows an acquisition of the history, the sampling is stopped.
+    /// The stored raw data is converted again and published like a live acquisition.
+    /// \param age 1 is the last acquisition, 2 the one before, ... 0 restarts the sampling.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode replayHistory(unsigned age);
+
     /// \brief Enables/disables filtering of the given channel.
     /// \param channel The channel that should be set.
     /// \param used true if the channel should be sampled.
@@ -248,6 +510,25 @@ class HantekDsoControl : public QObject {
     /// \return See ::Dso::ErrorCode.
     Dso::ErrorCode setTriggerSlope(Dso::Slope slope);
 
+    /// \brief Set the event that triggers: an edge, a pulse width, a runt, a window or a timeout.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setTriggerType(Dso::TriggerType type);
+
+    /// \brief Overlay the windows of all trigger events of a block instead of showing only the first one.
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setFastAcquisition(bool enabled);
+
+    /// \brief Set the condition of the pulse width and window triggers.
+    /// \param time The pulse width limit or the timeout (in s).
+    /// \param timeUpper The upper pulse width limit for Inside and Outside (in s).
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setTriggerCondition(Dso::TriggerCondition condition, double time, double timeUpper);
+
+    /// \brief Set the level that forms the band of the runt and window triggers with the trigger level.
+    /// \param level The second level (V).
+    /// \return See ::Dso::ErrorCode.
+    Dso::ErrorCode setTriggerSecondLevel(double level);
+
     /// \brief Set the trigger position.
     /// \param position The new trigger position (in s).
     /// \return The trigger position that has been set.
@@ -272,6 +553,11 @@ class HantekDsoControl : public QObject {
     void samplerateChanged(double samplerate);        ///< The samplerate has changed
 
     void communicationError() const;
+    void deviceReconnected(); ///< The lost device is connected again, the settings can be restored
+    void acquisitionRateChanged(double rate); ///< Achieved number of acquisitions per second
+    void waveformRateChanged(double rate);    ///< Shown trigger windows per second, > rate in the fast acquisition
+    void transferRateChanged(double rate);    ///< Bytes per second received from the device
+    void schedulingLatencyChanged(const QString &report); ///< Summary of the LatencyWatchdog, once per second
 };
 
 Q_DECLARE_METATYPE(DSOsamples *)
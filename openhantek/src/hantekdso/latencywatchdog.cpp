@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+#include "framestatistics.h"
+#include "latencywatchdog.h"
+
+LatencyWatchdog::LatencyWatchdog(const ThreadScheduling &scheduling) : scheduling(scheduling) {
+    setObjectName("latencyWatchdog");
+}
+
+
+LatencyWatchdog::~LatencyWatchdog() {
+    requestInterruption();
+    wait();
+}
+
+
+void LatencyWatchdog::run() {
+    QString message;
+    if (!scheduling.isDefault() && !scheduling.apply(message))
+        qWarning() << "Latency watchdog:" << message;
+    qint64 before = Dso::monotonicTime();
+    while (!isInterruptionRequested()) {
+        QThread::usleep(LATENCY_WATCHDOG_PERIOD);
+        const qint64 now = Dso::monotonicTime();
+        const qint64 latency = std::max(qint64(0), now - before - qint64(LATENCY_WATCHDOG_PERIOD) * 1000);
+        before = now;
+        wakeups.fetchAndAddRelaxed(1);
+        latencySum.fetchAndAddRelaxed(latency);
+        for (qint64 max = latencyMax.load(); latency > max && !latencyMax.testAndSetRelaxed(max, latency);)
+            max = latencyMax.load();
+    }
+}
+
+
+void LatencyWatchdog::beat() {
+    const qint64 now = Dso::monotonicTime();
+    if (lastBeat) {
+        const double interval = (now - lastBeat) * 1e-6;
+        ++beats;
+        intervalSum += interval;
+        intervalSquares += interval * interval;
+        intervalMax = std::max(intervalMax, interval);
+    }
+    lastBeat = now;
+}
+
+
+QString LatencyWatchdog::report() {
+    const qint64 count = wakeups.fetchAndStoreRelaxed(0);
+    const qint64 sum = latencySum.fetchAndStoreRelaxed(0);
+    const qint64 max = latencyMax.fetchAndStoreRelaxed(0);
+    const double mean = beats ? intervalSum / beats : 0.0;
+    const double jitter = beats ? std::sqrt(std::max(0.0, intervalSquares / beats - mean * mean)) : 0.0;
+    const QString text = QString("scheduling latency max %1 µs, mean %2 µs; loop %3 ± %4 ms, longest %5 ms")
+                             .arg(max / 1000)
+                             .arg(count ? sum / count / 1000 : 0)
+                             .arg(mean, 0, 'f', 2)
+                             .arg(jitter, 0, 'f', 2)
+                             .arg(intervalMax, 0, 'f', 2);
+    beats = 0;
+    intervalSum = 0.0;
+    intervalSquares = 0.0;
+    intervalMax = 0.0;
+    return text;
+}
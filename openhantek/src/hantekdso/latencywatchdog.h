@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QString>
+#include <QThread>
+
+#include "utils/threadscheduling.h"
+
+#define LATENCY_WATCHDOG_PERIOD 1000 ///< Sleep time of the latency probe in µs
+
+/// \brief Measures the scheduling latency of the acquisition loop.
+/// A probe thread with the scheduling of the acquisition thread sleeps for LATENCY_WATCHDOG_PERIOD
+/// and records how late it wakes up, i.e. how long a thread of this priority on these CPUs waits
+/// for the CPU after its USB transfer completed. The acquisition loop calls beat() once per
+/// iteration, the jitter of these intervals shows how regular the captures are.
+class LatencyWatchdog : public QThread {
+  public:
+    explicit LatencyWatchdog(const ThreadScheduling &scheduling);
+    ~LatencyWatchdog() override;
+
+    /// \brief Called by the acquisition loop once per iteration.
+    void beat();
+
+    /// \brief Summary of the measurements since the last report, that starts the next interval.
+    /// Call from the thread that calls beat().
+    QString report();
+
+  protected:
+    void run() override;
+
+  private:
+    const ThreadScheduling scheduling;
+    // Probe, updated by the watchdog thread
+    QAtomicInteger<qint64> wakeups;        ///< Number of wake-ups in the interval
+    QAtomicInteger<qint64> latencySum;     ///< Sum of the wake-up delays in ns
+    QAtomicInteger<qint64> latencyMax;     ///< Longest wake-up delay in ns
+    // Acquisition loop, only used by the thread that calls beat()
+    qint64 lastBeat = 0;                   ///< Time of the last beat() in ns, 0 = none
+    unsigned long long beats = 0;          ///< Number of loop intervals
+    double intervalSum = 0.0;              ///< Sum of the loop intervals in ms
+    double intervalSquares = 0.0;          ///< Sum of the squared loop intervals in ms²
+    double intervalMax = 0.0;              ///< Longest loop interval in ms
+};
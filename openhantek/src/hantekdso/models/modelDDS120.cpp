@@ -15,7 +15,7 @@ static void initSpecifications(Dso::ControlSpecification& specification) {
     // we drop 2K + 480 sample values due to unreliable start of stream
     // 20000 samples at 100kS/s = 200 ms gives enough to fill
     // the screen two times (for pre/post trigger) at 10ms/div = 100ms/screen
-    // SAMPLESIZE defined in modelDDS120.h
+    // the record length is selected in the Horizontal dock, default RECORDLENGTH_DEFAULT
     // adapt accordingly in HantekDsoControl::convertRawDataToSamples()
     specification.samplerate.single.base = 1e6;
     specification.samplerate.single.max = 48e6;
@@ -5,8 +5,6 @@
 class HantekDsoControl;
 using namespace Hantek;
 
-#define SAMPLESIZE_USED 20000
-
 
 struct ModelDDS120 : public DSOModel {
     static const int ID = 0x0120;
@@ -22,10 +22,11 @@ static void initSpecifications(Dso::ControlSpecification& specification) {
     // we drop 2K + 480 sample values due to unreliable start of stream
     // 20000 samples at 100kS/s = 200 ms gives enough to fill
     // the screen two times (for pre/post trigger) at 10ms/div = 100ms/screen
-    // SAMPLESIZE defined in modelDSO6022.h
+    // the record length is selected in the Horizontal dock, default RECORDLENGTH_DEFAULT
     // adapt accordingly in HantekDsoControl::convertRawDataToSamples()
     specification.samplerate.single.base = 1e6;
     specification.samplerate.single.max = 30e6;
+    specification.samplerate.single.maxStreaming = 48e6; // only with gap-free asynchronous streaming
     specification.samplerate.single.maxDownsampler = 10;
     specification.samplerate.single.recordLengths = { UINT_MAX };
     specification.samplerate.multi.base = 1e6;
@@ -86,7 +87,7 @@ static void initSpecifications(Dso::ControlSpecification& specification) {
 
     // Possible sample rates with custom fw from https://github.com/Ho-Ro/Hantek6022API
     // 60k, 100k, 200k, 500k, 1M, 2M, 3M, 4M, 5M, 6M, 8M, 10M, 12M, 15M, 16M, 24M, 30M (, 48M)
-    // 48M is unstable in 1 channel mode
+    // 48M is unstable in 1 channel mode unless the data is read with asynchronous streaming
     // 24M, 30M and 48M are unstable in 2 channel mode
 // define VERY_SLOW_SAMPLES to get timebase up to 1s/div at the expense of very slow reaction time (up to 20 s)
 //#define VERY_SLOW_SAMPLES
@@ -98,7 +99,8 @@ static void initSpecifications(Dso::ControlSpecification& specification) {
         {100e3,  10, 100} , {200e3,  10,  50} , {500e3,  10,  20} , // 100x, 50x, 20x downsampling from 10 MS/s
         {  1e6,  10,  10} , {  2e6,  10,   5} , {  5e6,  10,   2} , // 10x,   5x,  2x downsampling from 10 MS/s
         { 10e6,  10,   1} , { 12e6,  12,   1} , { 15e6,  15,   1} , // no oversampling
-        { 24e6,  24,   1} , { 30e6,  30,   1}  // no oversampling
+        { 24e6,  24,   1} , { 30e6,  30,   1} , // no oversampling
+        { 48e6,  48,   1}  // CH1 only, requires streaming (samplerate.single.maxStreaming)
     };
 
     specification.sampleSize = specification.fixedSampleRates.size();
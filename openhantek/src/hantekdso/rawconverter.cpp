@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bufferpool.h"
+#include "decimation.h"
+#include "rawconverter.h"
+
+#define SMALL_BUCKET 32 ///< Smaller buckets are summed by convertBuckets(), up to four 16 byte loads each
+
+namespace Dso {
+
+void RawConverter::setCalibration(double offsetError, unsigned short limit, double offset, double scale) {
+    if (tableBuilds && offsetError == this->offsetError && limit == this->limit && offset == this->offset &&
+        scale == this->scale)
+        return;
+    this->offsetError = offsetError;
+    this->limit = limit;
+    this->offset = offset;
+    this->scale = scale;
+    for (unsigned raw = 0; raw < 256; ++raw)
+        table[raw] = float(toVoltage(raw));
+    ++tableBuilds;
+}
+
+
+bool RawConverter::convertSegment(const unsigned char *data, unsigned stride, unsigned count, float *samples,
+                                  float *peakMin, float *peakMax) const {
+    unsigned index = 0;
+    unsigned char min = 0xFF;
+    unsigned char max = 0x00;
+#ifdef __SSE2__
+    if (stride <= 2) {
+        // the last load of two interleaved channels ends with a byte of the other channel, stay inside the data
+        const unsigned end = stride == 1 ? 16 : 17;
+        const __m128i mask = _mm_set1_epi16(0x00FF);
+        __m128i vMin = _mm_set1_epi8(char(0xFF));
+        __m128i vMax = _mm_setzero_si128();
+        alignas(16) unsigned char bytes[16];
+        for (; index + end <= count; index += 16) {
+            __m128i v;
+            if (stride == 1) {
+                v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+            } else { // keep the even bytes of 32, i.e. the 16 samples of this channel
+                const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * index));
+                const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 2 * index + 16));
+                v = _mm_packus_epi16(_mm_and_si128(low, mask), _mm_and_si128(high, mask));
+            }
+            vMin = _mm_min_epu8(vMin, v);
+            vMax = _mm_max_epu8(vMax, v);
+            _mm_store_si128(reinterpret_cast<__m128i *>(bytes), v);
+            for (unsigned lane = 0; lane < 16; ++lane)
+                samples[index + lane] = table[bytes[lane]];
+        }
+        alignas(16) unsigned char lanesMin[16], lanesMax[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMin), vMin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMax), vMax);
+        for (unsigned lane = 0; lane < 16; ++lane) {
+            min = std::min(min, lanesMin[lane]);
+            max = std::max(max, lanesMax[lane]);
+        }
+    }
+#endif
+    for (; index < count; ++index) {
+        const unsigned char raw = data[size_t(index) * stride];
+        min = std::min(min, raw);
+        max = std::max(max, raw);
+        samples[index] = table[raw];
+    }
+    if (peakMin) { // without downsampling the envelope is the trace itself
+        std::copy(samples, samples + count, peakMin);
+        std::copy(samples, samples + count, peakMax);
+    }
+    return min == 0x00 || max == 0xFF;
+}
+
+
+bool RawConverter::convertBuckets(const unsigned char *data, unsigned stride, unsigned downsampling, unsigned count,
+                                  float factor, float bias, float *samples, float *peakMin, float *peakMax) const {
+    const size_t step = size_t(downsampling) * stride;
+    unsigned index = 0;
+    bool clipped = false;
+#ifdef __SSE2__
+    if (stride <= 2) {
+        // a bucket is summed from up to four 16 byte loads, the masks keep the bytes of this channel and bucket
+        const unsigned blocks = ((downsampling - 1) * stride + 16) / 16;
+        alignas(16) unsigned char maskBytes[4][16];
+        for (unsigned byte = 0; byte < 4 * 16; ++byte)
+            maskBytes[byte / 16][byte % 16] = byte % stride == 0 && byte / stride < downsampling ? 0xFF : 0x00;
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i ones = _mm_set1_epi8(char(0xFF));
+        __m128i masks[4];
+        __m128i fills[4]; // the bytes outside of the bucket must not lower the minimum
+        for (unsigned block = 0; block < blocks; ++block) {
+            masks[block] = _mm_load_si128(reinterpret_cast<const __m128i *>(maskBytes[block]));
+            fills[block] = _mm_xor_si128(masks[block], ones);
+        }
+        // without envelope only the clipping is needed, the minimum and maximum of all buckets
+        __m128i vMin = ones;
+        __m128i vMax = zero;
+        if ((downsampling - 1) * stride < 8) {
+            // four buckets per pass: a sad sums two buckets of up to 8 bytes, the second one shifted up by 8
+            const __m128i pairFill = _mm_xor_si128(_mm_or_si128(masks[0], _mm_slli_si128(masks[0], 8)), ones);
+            const __m128 vFactor = _mm_set1_ps(factor);
+            const __m128 vBias = _mm_set1_ps(bias);
+            // the envelope halves each 8 byte bucket until its minimum and maximum are in the bytes 0 and 8,
+            // they are calibrated like a bucket of one sample
+            const unsigned span = (downsampling - 1) * stride + 1;
+            const unsigned halvings = span > 4 ? 3 : span > 2 ? 2 : 1;
+            const __m128i firstBytes = _mm_set_epi32(0, 0xFF, 0, 0xFF);
+            const __m128 rawFactor = _mm_set1_ps(bucketFactor(1));
+            const __m128 rawBias = _mm_set1_ps(bucketBias());
+            float *lowOut = scale < 0 ? peakMax : peakMin; // an inverted channel swaps the envelope
+            float *highOut = scale < 0 ? peakMin : peakMax;
+            __m128i pairs[2], lows[2], highs[2];
+            for (; index + 4 <= count; index += 4) {
+                for (unsigned half = 0; half < 2; ++half) {
+                    const __m128i *first = reinterpret_cast<const __m128i *>(data);
+                    const __m128i *second = reinterpret_cast<const __m128i *>(data + step);
+                    data += 2 * step;
+                    const __m128i secondBucket = _mm_and_si128(_mm_loadu_si128(second), masks[0]);
+                    const __m128i pair =
+                        _mm_or_si128(_mm_and_si128(_mm_loadu_si128(first), masks[0]), _mm_slli_si128(secondBucket, 8));
+                    __m128i low = _mm_or_si128(pair, pairFill);
+                    __m128i high = pair;
+                    vMin = _mm_min_epu8(vMin, low);
+                    vMax = _mm_max_epu8(vMax, high);
+                    pairs[half] = pair;
+                    if (!peakMin)
+                        continue;
+                    // the bytes shifted in from above are only mixed into bytes that are not used
+                    if (halvings > 2) {
+                        low = _mm_min_epu8(low, _mm_srli_epi64(low, 32));
+                        high = _mm_max_epu8(high, _mm_srli_epi64(high, 32));
+                    }
+                    if (halvings > 1) {
+                        low = _mm_min_epu8(low, _mm_srli_epi64(low, 16));
+                        high = _mm_max_epu8(high, _mm_srli_epi64(high, 16));
+                    }
+                    low = _mm_min_epu8(low, _mm_srli_epi64(low, 8));
+                    high = _mm_max_epu8(high, _mm_srli_epi64(high, 8));
+                    lows[half] = _mm_and_si128(low, firstBytes);
+                    highs[half] = _mm_and_si128(high, firstBytes);
+                }
+                // the sums are in the 32 bit lanes 0 and 2 of each sad
+                const __m128 sums =
+                    _mm_shuffle_ps(_mm_castsi128_ps(_mm_sad_epu8(pairs[0], zero)),
+                                   _mm_castsi128_ps(_mm_sad_epu8(pairs[1], zero)), _MM_SHUFFLE(2, 0, 2, 0));
+                _mm_storeu_ps(samples + index,
+                              _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(sums)), vFactor), vBias));
+                if (!peakMin)
+                    continue;
+                const __m128 mins = _mm_shuffle_ps(_mm_castsi128_ps(lows[0]), _mm_castsi128_ps(lows[1]),
+                                                   _MM_SHUFFLE(2, 0, 2, 0));
+                const __m128 maxs = _mm_shuffle_ps(_mm_castsi128_ps(highs[0]), _mm_castsi128_ps(highs[1]),
+                                                   _MM_SHUFFLE(2, 0, 2, 0));
+                _mm_storeu_ps(lowOut + index,
+                              _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(mins)), rawFactor), rawBias));
+                _mm_storeu_ps(highOut + index,
+                              _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(maxs)), rawFactor), rawBias));
+            }
+        }
+        for (; index < count; ++index, data += step) {
+            __m128i vSum = zero;
+            __m128i bucketMin = peakMin ? ones : vMin;
+            __m128i bucketMax = peakMin ? zero : vMax;
+            for (unsigned block = 0; block < blocks; ++block) {
+                const __m128i v =
+                    _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16 * block)), masks[block]);
+                vSum = _mm_add_epi32(vSum, _mm_sad_epu8(v, zero));
+                bucketMin = _mm_min_epu8(bucketMin, _mm_or_si128(v, fills[block]));
+                bucketMax = _mm_max_epu8(bucketMax, v);
+            }
+            const unsigned sum = unsigned(_mm_cvtsi128_si32(_mm_add_epi32(vSum, _mm_unpackhi_epi64(vSum, vSum))));
+            samples[index] = float(sum) * factor + bias;
+            if (!peakMin) {
+                vMin = bucketMin;
+                vMax = bucketMax;
+                continue;
+            }
+            // reduce both to one byte: the minimum of 0xFF - value is 0xFF - maximum
+            const __m128i lows = _mm_min_epu8(bucketMin, _mm_unpackhi_epi64(bucketMin, bucketMin));
+            const __m128i highs = _mm_max_epu8(bucketMax, _mm_unpackhi_epi64(bucketMax, bucketMax));
+            __m128i both = _mm_unpacklo_epi64(lows, _mm_xor_si128(highs, ones));
+            both = _mm_min_epu8(both, _mm_srli_epi64(both, 32));
+            both = _mm_min_epu8(both, _mm_srli_epi64(both, 16));
+            both = _mm_min_epu8(both, _mm_srli_epi64(both, 8));
+            const unsigned char min = (unsigned char)_mm_cvtsi128_si32(both);
+            const unsigned char max = (unsigned char)(0xFF - (_mm_extract_epi16(both, 4) & 0xFF));
+            clipped |= (min == 0x00) | (max == 0xFF); // no branch, clipped buckets are frequent
+            peakMin[index] = table[scale < 0 ? max : min]; // an inverted channel swaps the envelope
+            peakMax[index] = table[scale < 0 ? min : max];
+        }
+        alignas(16) unsigned char lanesMin[16], lanesMax[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMin), vMin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanesMax), vMax);
+        for (unsigned lane = 0; lane < 16; ++lane)
+            clipped |= lanesMin[lane] == 0x00 || lanesMax[lane] == 0xFF;
+    }
+#endif
+    for (; index < count; ++index, data += step) {
+        unsigned sum = 0;
+        unsigned char min = 0xFF;
+        unsigned char max = 0x00;
+        for (unsigned iii = 0; iii < downsampling; ++iii) {
+            const unsigned char raw = data[size_t(iii) * stride];
+            sum += raw;
+            min = std::min(min, raw);
+            max = std::max(max, raw);
+        }
+        clipped |= (min == 0x00) | (max == 0xFF);
+        samples[index] = float(sum) * factor + bias;
+        if (peakMin) {
+            peakMin[index] = table[scale < 0 ? max : min];
+            peakMax[index] = table[scale < 0 ? min : max];
+        }
+    }
+    return clipped;
+}
+
+
+bool RawConverter::convert(const RawBuffer &rawData, size_t position, unsigned stride, unsigned downsampling,
+                           unsigned count, float *samples, float *peakMin, float *peakMax) const {
+    bool clipped = false;
+    if (downsampling == 1) {
+        for (unsigned done = 0; done < count;) { // split at the chunk boundaries
+            const size_t offset = position & (RAW_CHUNK_SIZE - 1);
+            const size_t available = (RAW_CHUNK_SIZE - offset + stride - 1) / stride;
+            const unsigned part = unsigned(std::min(size_t(count - done), available));
+            clipped |= convertSegment(rawData.chunk(position >> RAW_CHUNK_SHIFT) + offset, stride, part,
+                                      samples + done, peakMin ? peakMin + done : nullptr,
+                                      peakMax ? peakMax + done : nullptr);
+            position += size_t(part) * stride;
+            done += part;
+        }
+        return clipped;
+    }
+    // toVoltage(sum / downsampling) as one multiply and add per bucket, see sampleVoltage()
+    const float factor = bucketFactor(downsampling);
+    const float bias = bucketBias();
+    const size_t step = size_t(downsampling) * stride;
+    // bytes read from the start of a bucket, the 16 byte loads of the short buckets stay inside the chunk
+    const size_t bucketSize = size_t(downsampling - 1) * stride + 1;
+    const size_t span = downsampling < SMALL_BUCKET ? (bucketSize + 15) / 16 * 16 : bucketSize;
+    for (unsigned index = 0; index < count;) {
+        const size_t offset = position & (RAW_CHUNK_SIZE - 1);
+        if (offset + span > RAW_CHUNK_SIZE) { // rare, the bucket continues in the next chunk
+            RawBucket bucket;
+            accumulateBucket(bucket, rawData, position, downsampling, stride);
+            clipped |= bucket.min == 0x00 || bucket.max == 0xFF;
+            samples[index] = float(bucket.sum) * factor + bias;
+            if (peakMin) {
+                peakMin[index] = table[scale < 0 ? bucket.max : bucket.min];
+                peakMax[index] = table[scale < 0 ? bucket.min : bucket.max];
+            }
+            ++index;
+            position += step;
+            continue;
+        }
+        // the buckets up to the end of the chunk
+        const unsigned run = unsigned(std::min(size_t(count - index), (RAW_CHUNK_SIZE - offset - span) / step + 1));
+        const unsigned char *data = rawData.chunk(position >> RAW_CHUNK_SHIFT) + offset;
+        if (downsampling < SMALL_BUCKET) { // several buckets per pass
+            clipped |= convertBuckets(data, stride, downsampling, run, factor, bias, samples + index,
+                                      peakMin ? peakMin + index : nullptr, peakMax ? peakMax + index : nullptr);
+        } else {
+            for (unsigned bucketIndex = index; bucketIndex < index + run; ++bucketIndex, data += step) {
+                RawBucket bucket;
+                accumulateBucket(bucket, data, downsampling, stride);
+                clipped |= (bucket.min == 0x00) | (bucket.max == 0xFF);
+                samples[bucketIndex] = float(bucket.sum) * factor + bias;
+                if (peakMin) { // an inverted channel swaps the envelope
+                    peakMin[bucketIndex] = table[scale < 0 ? bucket.max : bucket.min];
+                    peakMax[bucketIndex] = table[scale < 0 ? bucket.min : bucket.max];
+                }
+            }
+        }
+        index += run;
+        position += size_t(run) * step;
+    }
+    return clipped;
+}
+
+
+bool RawConverter::convertScalar(const RawBuffer &rawData, size_t position, unsigned stride, unsigned downsampling,
+                                 unsigned count, float *samples, float *peakMin, float *peakMax) const {
+    bool clipped = false;
+    for (unsigned index = 0; index < count; ++index) {
+        unsigned sum = 0;
+        int min = 0xFF;
+        int max = 0x00;
+        for (unsigned iii = 0; iii < downsampling; ++iii, position += stride) {
+            int rawSample = rawData[position]; // range 0...255
+            if (rawSample == 0x00 || rawSample == 0xFF) // min or max -> clipped
+                clipped = true;
+            sum += rawSample;
+            min = std::min(min, rawSample);
+            max = std::max(max, rawSample);
+        }
+        samples[index] = float(toVoltage((double)sum / downsampling));
+        if (peakMin) {
+            const float low = float(toVoltage(min));
+            const float high = float(toVoltage(max));
+            peakMin[index] = scale < 0 ? high : low;
+            peakMax[index] = scale < 0 ? low : high;
+        }
+    }
+    return clipped;
+}
+
+} // namespace Dso
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <stddef.h>
+
+namespace Dso {
+
+class RawBuffer;
+
+/// \brief Calibrated conversion of the raw ADC bytes of one channel into voltages.
+/// The calibration (offset error, gain, probe attenuation, inversion) is folded into a table of
+/// the voltages of all 256 raw values, it is only rebuilt if the calibration changes. Without
+/// downsampling each sample is a table lookup, the interleaved channels are separated and the
+/// clipping is detected with SSE2 if available. Downsampled buckets are summed as integers, the short
+/// ones with SSE2 as well, and calibrated with one multiply and add.
+class RawConverter {
+  public:
+    /// \brief Set the calibration of the channel, voltage = ((raw - offsetError) / limit - offset) * scale.
+    /// \param scale Product of gain calibration, gain step, probe attenuation and the sign (-1 if inverted).
+    void setCalibration(double offsetError, unsigned short limit, double offset, double scale);
+
+    /// \brief The voltage of a raw value or the average of raw values, calculated with double precision.
+    inline double toVoltage(double raw) const { return ((raw - offsetError) / limit - offset) * scale; }
+    /// \brief The voltage convert() stores for the sum of the raw values of a bucket.
+    inline float sampleVoltage(unsigned sum, unsigned downsampling) const {
+        return downsampling == 1 ? table[sum] : float(sum) * bucketFactor(downsampling) + bucketBias();
+    }
+
+    /// \brief Convert count (downsampled) samples of one channel.
+    /// \param rawData The raw samples of one or two interleaved channels.
+    /// \param position The byte position of the first sample of this channel.
+    /// \param stride The number of interleaved channels.
+    /// \param downsampling The number of raw samples that are averaged into one sample.
+    /// \param samples Receives count voltages.
+    /// \param peakMin Receives the minimum of each bucket, nullptr if not needed.
+    /// \param peakMax Receives the maximum of each bucket, nullptr if not needed.
+    /// \return true if a raw sample is at the limit of the ADC range (0x00 or 0xFF).
+    bool convert(const RawBuffer &rawData, size_t position, unsigned stride, unsigned downsampling, unsigned count,
+                 float *samples, float *peakMin = nullptr, float *peakMax = nullptr) const;
+
+    /// \brief Same as convert() without table and SIMD, the reference for the self check.
+    bool convertScalar(const RawBuffer &rawData, size_t position, unsigned stride, unsigned downsampling,
+                       unsigned count, float *samples, float *peakMin = nullptr, float *peakMax = nullptr) const;
+
+    /// \return The number of table rebuilds, i.e. calibration changes.
+    inline unsigned long getTableBuilds() const { return tableBuilds; }
+
+  private:
+    /// toVoltage(sum / downsampling) = sum * bucketFactor(downsampling) + bucketBias()
+    inline float bucketFactor(unsigned downsampling) const { return float(scale / (double(downsampling) * limit)); }
+    inline float bucketBias() const { return float(-(offsetError / limit + offset) * scale); }
+    bool convertSegment(const unsigned char *data, unsigned stride, unsigned count, float *samples,
+                        float *peakMin, float *peakMax) const;
+    /// \brief Convert count short buckets that lie in one chunk, up to 16 bytes after a bucket may be read.
+    /// \param factor, bias The voltage of a bucket is sum * factor + bias.
+    bool convertBuckets(const unsigned char *data, unsigned stride, unsigned downsampling, unsigned count,
+                        float factor, float bias, float *samples, float *peakMin, float *peakMax) const;
+
+    double offsetError = 0.0;
+    unsigned short limit = 0;
+    double offset = 0.0;
+    double scale = 0.0;
+    float table[256]; ///< The voltage of each raw value
+    unsigned long tableBuilds = 0;
+};
+
+#define CONVERSION_CHANNELS_MAX 2 ///< Channels of the supported devices
+
+/// \brief Everything that is needed to convert a raw block into the channel samples.
+/// It is trivially copyable, so an acquisition can be stored and converted again later.
+struct ConversionParameters {
+    size_t position = 0;         ///< Byte position of the first converted sample of CH1
+    unsigned stride = 1;         ///< Number of interleaved channels in the raw data
+    unsigned downsampling = 1;   ///< Raw samples per converted sample
+    unsigned count = 0;          ///< Converted samples per channel
+    unsigned char channels = 0;  ///< Bitmask of the converted channels
+    bool peakDetect = false;     ///< Keep the min/max envelope
+    double samplerate = 0.0;     ///< Samplerate of the converted samples
+    RawConverter converters[CONVERSION_CHANNELS_MAX]; ///< The calibrated conversion of each channel
+};
+
+} // namespace Dso
@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QtAlgorithms>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "bufferpool.h"
+#include "decimation.h"
+#include "rawconverter.h"
+#include "rawtrigger.h"
+
+#define EDGE_BATCH 16 ///< Edges that search() scans ahead at least
+
+namespace Dso {
+
+namespace {
+
+/// \return The index of the lowest set bit, bits must not be 0.
+inline unsigned lowestBit(quint64 bits) {
+#ifdef __GNUC__
+    return unsigned(__builtin_ctzll(bits));
+#else
+    return qPopulationCount((bits & (~bits + 1)) - 1);
+#endif
+}
+
+/// \return The low count bits, count < 64.
+inline quint64 lowBits(quint64 bits, unsigned count) { return bits & ((1ULL << count) - 1); }
+
+} // namespace
+
+
+void RawTrigger::prepare(const RawBuffer &rawData, const ConversionParameters &parameters, unsigned channel) {
+    const unsigned stride = parameters.stride;
+    const unsigned downsampling = parameters.downsampling;
+    cached = false;
+    sums.resize(parameters.count);
+    size_t position = parameters.position + channel;
+    if (downsampling == 1) {
+        for (unsigned done = 0; done < parameters.count;) { // split at the chunk boundaries
+            const size_t offset = position & (RAW_CHUNK_SIZE - 1);
+            const size_t available = (RAW_CHUNK_SIZE - offset + stride - 1) / stride;
+            const unsigned part = unsigned(std::min(size_t(parameters.count - done), available));
+            const unsigned char *data = rawData.chunk(position >> RAW_CHUNK_SHIFT) + offset;
+            for (unsigned index = 0; index < part; ++index)
+                sums[done + index] = data[size_t(index) * stride];
+            position += size_t(part) * stride;
+            done += part;
+        }
+        return;
+    }
+    const size_t bucketSize = size_t(downsampling - 1) * stride + 1;
+    for (unsigned index = 0; index < parameters.count; ++index, position += size_t(downsampling) * stride) {
+        const size_t offset = position & (RAW_CHUNK_SIZE - 1);
+        if (offset + bucketSize > RAW_CHUNK_SIZE) { // the bucket continues in the next chunk
+            RawBucket bucket;
+            accumulateBucket(bucket, rawData, position, downsampling, stride);
+            sums[index] = bucket.sum;
+            continue;
+        }
+        const unsigned char *data = rawData.chunk(position >> RAW_CHUNK_SHIFT) + offset;
+        unsigned sum = 0;
+        for (unsigned iii = 0; iii < downsampling; ++iii, data += stride)
+            sum += *data;
+        sums[index] = sum;
+    }
+}
+
+
+RawTrigger::Threshold RawTrigger::mapLevel(const RawConverter &converter, unsigned downsampling, double level,
+                                           int slope) {
+    const qint64 maximum = qint64(0xFF) * downsampling;
+    // the sample is the voltage of the bucket exactly as convert() stores it
+    auto reaches = [&](qint64 sum) {
+        const float sample = converter.sampleVoltage(unsigned(sum), downsampling);
+        return slope * sample >= slope * level;
+    };
+    Threshold threshold;
+    const bool low = reaches(0);
+    const bool high = reaches(maximum);
+    if (low == high) { // the level is outside of the ADC range, all or none of the samples reach it
+        threshold.rising = true;
+        threshold.sum = high ? 0 : maximum + 1;
+        return threshold;
+    }
+    // the voltage is monotonic in the sum, rising if the channel is not inverted
+    threshold.rising = high;
+    qint64 first = 0;
+    qint64 last = maximum;
+    while (last - first > 1) { // reaches(first) == low, reaches(last) == high
+        const qint64 middle = (first + last) / 2;
+        (reaches(middle) == low ? first : last) = middle;
+    }
+    threshold.sum = high ? last : first;
+    return threshold;
+}
+
+
+void RawTrigger::setLevel(const RawConverter &converter, unsigned downsampling, double level) {
+    cached = false;
+    thresholds[0] = mapLevel(converter, downsampling, level, 1);
+    thresholds[1] = mapLevel(converter, downsampling, level, -1);
+}
+
+
+void RawTrigger::setBand(const RawConverter &converter, unsigned downsampling, double low, double high) {
+    band[0] = mapLevel(converter, downsampling, std::max(low, high), 1);
+    band[1] = mapLevel(converter, downsampling, std::min(low, high), -1);
+}
+
+
+void RawTrigger::reachedMasks(size_t first, quint64 masks[2]) const {
+    masks[0] = masks[1] = 0;
+    if (first >= sums.size())
+        return;
+    const unsigned count = unsigned(std::min(size_t(64), sums.size() - first));
+    const unsigned *data = sums.data() + first;
+    unsigned index = 0;
+#ifdef __SSE2__
+    // the sums are below 2^31, so the signed compare is correct:
+    // sum >= t <=> sum > t - 1, sum <= t <=> !(sum > t), the negation is a xor
+    __m128i limits[2], inverts[2];
+    for (unsigned slope = 0; slope < 2; ++slope) {
+        limits[slope] = _mm_set1_epi32(int(thresholds[slope].sum) - (thresholds[slope].rising ? 1 : 0));
+        inverts[slope] = _mm_set1_epi32(thresholds[slope].rising ? 0 : -1);
+    }
+    for (; index + 16 <= count; index += 16) { // compare 16 samples, pack the results into 16 bytes
+        const __m128i *v = reinterpret_cast<const __m128i *>(data + index);
+        const __m128i v0 = _mm_loadu_si128(v);
+        const __m128i v1 = _mm_loadu_si128(v + 1);
+        const __m128i v2 = _mm_loadu_si128(v + 2);
+        const __m128i v3 = _mm_loadu_si128(v + 3);
+        for (unsigned slope = 0; slope < 2; ++slope) {
+            const __m128i low = _mm_packs_epi32(_mm_cmpgt_epi32(v0, limits[slope]), _mm_cmpgt_epi32(v1, limits[slope]));
+            const __m128i high = _mm_packs_epi32(_mm_cmpgt_epi32(v2, limits[slope]), _mm_cmpgt_epi32(v3, limits[slope]));
+            const __m128i reached = _mm_xor_si128(_mm_packs_epi16(low, high), inverts[slope]);
+            masks[slope] |= quint64(unsigned(_mm_movemask_epi8(reached))) << index;
+        }
+    }
+#endif
+    for (; index < count; ++index) {
+        masks[0] |= quint64(reached(first + index, 1)) << index;
+        masks[1] |= quint64(reached(first + index, -1)) << index;
+    }
+}
+
+
+unsigned RawTrigger::findEdges(unsigned from, unsigned to, unsigned sampleSet, unsigned threshold, Edge *edges,
+                               unsigned maxEdges) const {
+    const size_t sampleCount = sums.size();
+    to = unsigned(std::min(size_t(to), sampleCount));
+    unsigned found = 0;
+    if (from + 1 >= to || !maxEdges)
+        return found;
+    // the masks of the words before, at and after the current word, [0] rising, [1] falling
+    quint64 previous[2], current[2], next[2];
+    size_t base = from & ~63U;
+    if (base)
+        reachedMasks(base - 64, previous);
+    else
+        previous[0] = previous[1] = 0;
+    reachedMasks(base, current);
+    for (; base < to; base += 64) {
+        reachedMasks(base + 64, next);
+        // an edge reaches the level, the sample before does not; only edges after from count
+        quint64 candidates[2];
+        for (unsigned slope = 0; slope < 2; ++slope)
+            candidates[slope] = current[slope] & ~(current[slope] << 1 | previous[slope] >> 63);
+        quint64 valid = ~0ULL;
+        if (from >= base)
+            valid &= from - base >= 63 ? 0 : ~0ULL << (from - base + 1);
+        if (to - base < 64)
+            valid &= (1ULL << (to - base)) - 1;
+        for (quint64 both = (candidates[0] | candidates[1]) & valid; both; both &= both - 1) {
+            const unsigned bit = lowestBit(both);
+            const unsigned i = unsigned(base) + bit;
+            const unsigned slope = (candidates[0] >> bit) & 1 ? 0 : 1;
+            if (i < sampleSet) // like the scalar loop: too few samples before the edge
+                continue;
+            // before: samples [max(i - sampleSet, 1), i - 1] that do not reach the level
+            // after: samples [i + 1, min(i + sampleSet, sampleCount - 1)] that reach it
+            const unsigned beforeFirst = std::max(i - sampleSet, 1U);
+            const unsigned afterLast = unsigned(std::min(size_t(i) + sampleSet, sampleCount - 1));
+            unsigned before = i - beforeFirst;
+            unsigned after = afterLast > i ? afterLast - i : 0;
+            if (sampleSet < 64) { // the windows are inside of the words before and after
+                const unsigned length = before;
+                const quint64 beforeBits = bit >= length ? current[slope] >> (bit - length)
+                                                         : current[slope] << (length - bit) |
+                                                               previous[slope] >> (64 - length + bit);
+                const quint64 afterBits = (bit == 63 ? 0 : current[slope] >> (bit + 1)) | next[slope] << (63 - bit);
+                before -= qPopulationCount(lowBits(beforeBits, length));
+                after = qPopulationCount(lowBits(afterBits, after));
+            } else {
+                for (unsigned k = beforeFirst; k < i; ++k)
+                    before -= reached(k, slope ? -1 : 1);
+                after = 0;
+                for (unsigned k = i + 1; k <= afterLast; ++k)
+                    after += reached(k, slope ? -1 : 1);
+            }
+            if (before > threshold && after > threshold) {
+                edges[found++] = {i - 1, slope ? -1 : 1};
+                if (found == maxEdges)
+                    return found;
+            }
+        }
+        for (unsigned slope = 0; slope < 2; ++slope) {
+            previous[slope] = current[slope];
+            current[slope] = next[slope];
+        }
+    }
+    return found;
+}
+
+
+unsigned RawTrigger::search(int slope, unsigned from, unsigned to, unsigned sampleSet, unsigned threshold) {
+    if (!cached || from < scanFrom || sampleSet != scanSampleSet || threshold != scanThreshold) {
+        edges.clear();
+        scanFrom = scanned = from;
+        scanSampleSet = sampleSet;
+        scanThreshold = threshold;
+        cached = true;
+    }
+    // the first cached edge after from
+    size_t index = size_t(std::lower_bound(edges.cbegin(), edges.cend(), from,
+                                           [](const Edge &edge, unsigned from) { return edge.position < from; }) -
+                          edges.cbegin());
+    for (;;) {
+        for (; index < edges.size(); ++index) {
+            const Edge &edge = edges[index];
+            if (edge.position < from || edge.slope != slope) // the edge sample must be after from
+                continue;
+            return edge.position + 1 < to ? edge.position : 0;
+        }
+        if (scanned + 1 >= sums.size() || scanned + 1 >= to) // no more edges before to
+            return 0;
+        // the batch grows with the cache, a search through all edges of the block is still one pass
+        const size_t cached = edges.size();
+        const unsigned batch = unsigned(std::max(cached, size_t(EDGE_BATCH)));
+        edges.resize(cached + batch);
+        const unsigned found =
+            findEdges(scanned, unsigned(sums.size()), sampleSet, threshold, edges.data() + cached, batch);
+        edges.resize(cached + found);
+        scanned = found == batch ? edges.back().position + 1 : unsigned(sums.size());
+    }
+}
+
+
+double RawTrigger::crossing(const RawConverter &converter, unsigned downsampling, size_t index, double level) const {
+    if (index + 1 >= sums.size())
+        return -1.0;
+    const double before = converter.toVoltage(double(sums[index]) / downsampling);
+    const double after = converter.toVoltage(double(sums[index + 1]) / downsampling);
+    if (before == after)
+        return -1.0;
+    const double fraction = (level - before) / (after - before);
+    return fraction >= 0.0 && fraction <= 1.0 ? fraction : -1.0;
+}
+
+
+unsigned RawTrigger::searchScalar(int slope, unsigned from, unsigned to, unsigned sampleSet,
+                                  unsigned threshold) const {
+    const size_t sampleCount = sums.size();
+    to = unsigned(std::min(size_t(to), sampleCount));
+    bool previous = true; // the first sample of the range is not an edge
+    for (unsigned i = from; i < to; i++) {
+        const bool current = reached(i, slope);
+        if (current && !previous) { // trigger condition met
+            // check for the next few sampleSet samples, if they are also below/above the trigger value
+            unsigned before = 0;
+            for (unsigned k = i - 1; k >= i - sampleSet && k > 0; k--) {
+                if (!reached(k, slope))
+                    before++;
+            }
+            unsigned after = 0;
+            for (unsigned k = i + 1; k <= i + sampleSet && k < sampleCount; k++) {
+                if (reached(k, slope))
+                    after++;
+            }
+            if (before > threshold && after > threshold)
+                return i - 1;
+        }
+        previous = current;
+    }
+    return 0;
+}
+
+
+
+unsigned RawTrigger::findCondition(const Condition &condition, ConditionState &state, unsigned from, unsigned to,
+                                   unsigned &width) const {
+    to = unsigned(std::min(size_t(to), sums.size()));
+    const bool banded = condition.type == TriggerType::Runt || condition.type == TriggerType::Window;
+    // the polarity of pulses, runts and timeouts, the direction of the signal for the window
+    const bool positive = condition.slope != Slope::Negative;
+    const bool negative = condition.slope != Slope::Positive;
+    const unsigned shortest = std::min(condition.time, condition.timeUpper);
+    const unsigned longest = std::max(condition.time, condition.timeUpper);
+    width = 0;
+    for (unsigned i = state.position; i < to; ++i) {
+        const unsigned sum = sums[i];
+        const int zone = banded ? (passes(band[0], sum) ? 1 : passes(band[1], sum) ? -1 : 0)
+                                : (passes(thresholds[0], sum) ? 1 : -1);
+        if (!state.known) { // the first sample of the scan
+            state.known = true;
+            state.zone = zone;
+            state.since = i;
+            if (zone)
+                state.outer = zone;
+            continue;
+        }
+        const int previous = state.zone;
+        bool event = false;
+        switch (condition.type) {
+        case TriggerType::PulseWidth:
+            if (zone != previous && state.started && (previous > 0 ? positive : negative)) {
+                const unsigned pulse = i - state.since; // the pulse ends with this crossing
+                switch (condition.condition) {
+                case TriggerCondition::Less:
+                    event = pulse < condition.time;
+                    break;
+                case TriggerCondition::Greater:
+                    event = pulse > condition.time;
+                    break;
+                case TriggerCondition::Inside:
+                    event = pulse >= shortest && pulse <= longest;
+                    break;
+                case TriggerCondition::Outside:
+                    event = pulse < shortest || pulse > longest;
+                    break;
+                }
+                if (event)
+                    width = pulse;
+            }
+            break;
+        case TriggerType::Timeout: // the zone lasts since the last crossing or at least since the scan start
+            event = zone == previous && !state.timedOut && (zone > 0 ? positive : negative) &&
+                    i - state.since >= condition.time;
+            if (event)
+                state.timedOut = true;
+            break;
+        case TriggerType::Runt:
+            if (!zone) {
+                state.excursion = state.outer != 0;
+            } else if (zone != previous) { // back outside of the band
+                // a positive runt starts and ends below the band, a negative one above
+                event = state.excursion && zone == state.outer && (zone < 0 ? positive : negative);
+                state.outer = zone;
+                state.excursion = false;
+            }
+            break;
+        case TriggerType::Window:
+            if (zone != previous) {
+                if (condition.condition == TriggerCondition::Outside) // leave upwards or downwards, also across it
+                    event = zone && (zone > 0 ? positive : negative);
+                else // enter from below or above
+                    event = !zone && (previous < 0 ? positive : negative);
+            }
+            break;
+        case TriggerType::Edge:
+            break;
+        }
+        if (zone != previous) {
+            state.zone = zone;
+            state.since = i;
+            state.started = true;
+            state.timedOut = false;
+        }
+        if (event && i > from) {
+            state.position = i + 1;
+            return i - 1;
+        }
+        width = 0;
+    }
+    state.position = std::max(state.position, to);
+    return 0;
+}
+
+} // namespace Dso
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QtGlobal>
+#include <vector>
+
+#include "enums.h"
+
+namespace Dso {
+
+class RawBuffer;
+class RawConverter;
+struct ConversionParameters;
+
+/// \brief Software trigger search on the raw ADC data of the trigger channel.
+/// The trigger level is mapped back into the raw domain with the calibration of the channel:
+/// a (downsampled) sample reaches the level if the integer sum of its raw bucket is beyond a
+/// threshold. The thresholds are derived from the converted voltages of the sums, so the search
+/// finds exactly the edges that a search on the converted samples would find, without converting
+/// the block first.
+/// The edges of both slopes are found in one pass: the samples are compared with SSE2 if available,
+/// the edges and the smoothing criterion are evaluated on bit masks of 64 samples. The found edges
+/// are cached, so the searches of one block continue where the last one stopped.
+class RawTrigger {
+  public:
+    /// \brief A threshold crossing that fulfils the smoothing criterion.
+    struct Edge {
+        unsigned position; ///< The sample before the edge, like search() returns it
+        int slope;         ///< 1 for a rising, -1 for a falling edge
+    };
+
+    /// \brief The setup of a trigger type other than Edge, the times are in samples.
+    struct Condition {
+        TriggerType type = TriggerType::PulseWidth;
+        Slope slope = Slope::Positive;                 ///< Polarity of pulses, runts and timeouts
+        TriggerCondition condition = TriggerCondition::Less;
+        unsigned time = 0;                             ///< Limit of the pulse width or the timeout
+        unsigned timeUpper = 0;                        ///< Upper limit for Inside and Outside pulse widths
+    };
+
+    /// \brief State of the scan of findCondition(), a default constructed state starts at sample 0.
+    struct ConditionState {
+        unsigned position = 0;  ///< The next sample that is evaluated
+        bool known = false;     ///< zone holds the zone of the sample before position
+        int zone = 0;           ///< 1 above, -1 below the level or band, 0 inside the band
+        unsigned since = 0;     ///< The sample that entered the zone
+        bool started = false;   ///< since is a crossing, not the start of the scan
+        bool timedOut = false;  ///< The timeout of the zone was reported
+        int outer = 0;          ///< Runt: the last zone outside of the band, 0 = none yet
+        bool excursion = false; ///< Runt: the band was entered after outer
+    };
+
+    /// \brief Sum the raw buckets of a channel like the conversion does.
+    /// \param channel The channel index within the interleaved raw data.
+    void prepare(const RawBuffer &rawData, const ConversionParameters &parameters, unsigned channel);
+
+    /// \brief Map a trigger level into thresholds of the bucket sums.
+    /// \param converter The calibrated conversion of the trigger channel.
+    /// \param downsampling The number of raw samples of one bucket.
+    /// \param level The trigger level in V.
+    void setLevel(const RawConverter &converter, unsigned downsampling, double level);
+
+    /// \brief Map the band of the runt and window triggers into the raw domain.
+    /// \param low The lower level of the band in V.
+    /// \param high The upper level of the band in V.
+    void setBand(const RawConverter &converter, unsigned downsampling, double low, double high);
+
+    /// \brief Interpolate linearly where the level is crossed between the samples index and index + 1.
+    /// The voltages are those of the conversion, so the position does not depend on the converted window.
+    /// \return The position of the crossing after index in samples, [0, 1], -1 if the level is not crossed.
+    double crossing(const RawConverter &converter, unsigned downsampling, size_t index, double level) const;
+
+    /// \brief Forget the prepared channel, e.g. if the trigger source is not sampled.
+    inline void clear() {
+        sums.clear();
+        cached = false;
+    }
+
+    /// \return The number of (downsampled) samples of the prepared channel.
+    inline size_t size() const { return sums.size(); }
+
+    /// \return true if the sample is at or beyond the level in the direction of the slope,
+    /// i.e. slope * voltage >= slope * level.
+    /// \param slope 1 for a rising, -1 for a falling edge.
+    inline bool reached(size_t index, int slope) const { return passes(thresholds[slope < 0], sums[index]); }
+
+    /// \brief Search the first edge in [from, to) that crosses the level.
+    /// The edges are taken from the cache, findEdges() continues the scan if necessary.
+    /// \param sampleSet The number of samples before and after the edge that are checked...
+    /// \param threshold ... more than threshold of them have to be on the correct side of the level.
+    /// \return The sample before the edge, 0 if there is no edge.
+    unsigned search(int slope, unsigned from, unsigned to, unsigned sampleSet, unsigned threshold);
+
+    /// \brief Same as search() with a scalar loop per sample, the reference for the self check.
+    unsigned searchScalar(int slope, unsigned from, unsigned to, unsigned sampleSet, unsigned threshold) const;
+
+    /// \brief Find the first edges of both slopes in [from, to) in one pass.
+    /// \param edges Receives at most maxEdges edges, ordered by their position.
+    /// \return The number of found edges.
+    unsigned findEdges(unsigned from, unsigned to, unsigned sampleSet, unsigned threshold, Edge *edges,
+                       unsigned maxEdges) const;
+
+    /// \brief Find the next event of a trigger condition with a state machine, one linear scan without memory.
+    /// The scan continues where the last call with the same state stopped, events up to from only update
+    /// the state. Pulse width and timeout use the trigger level, runt and window the band.
+    /// \param width Receives the width of a triggering pulse in samples.
+    /// \return The sample before the event, 0 if there is none in (from, to).
+    unsigned findCondition(const Condition &condition, ConditionState &state, unsigned from, unsigned to,
+                           unsigned &width) const;
+
+  private:
+    /// \brief The sums that reach the level for one slope: sum >= threshold if rising, else sum <= threshold.
+    struct Threshold {
+        bool rising = true;
+        qint64 sum = 0;
+    };
+
+    static inline bool passes(const Threshold &threshold, unsigned sum) {
+        return threshold.rising ? qint64(sum) >= threshold.sum : qint64(sum) <= threshold.sum;
+    }
+
+    /// \brief The threshold of the sums whose voltage reaches the level, slope * voltage >= slope * level.
+    static Threshold mapLevel(const RawConverter &converter, unsigned downsampling, double level, int slope);
+
+    /// \brief Set bit n of masks[0] (rising) and masks[1] (falling) if sample first + n reaches the level.
+    void reachedMasks(size_t first, quint64 masks[2]) const;
+
+    std::vector<unsigned> sums;  ///< The raw sum of each bucket of the trigger channel
+    Threshold thresholds[2];     ///< For the rising [0] and the falling [1] slope
+    Threshold band[2];           ///< Above the upper [0] and below the lower [1] level of the band
+    // cache of the edges found by search()
+    bool cached = false;         ///< The cache belongs to the prepared samples and level
+    std::vector<Edge> edges;     ///< The edges after scanFrom up to scanned, ordered by position
+    unsigned scanFrom = 0;       ///< Start of the cached scan
+    unsigned scanned = 0;        ///< All edges up to this sample are cached
+    unsigned scanSampleSet = 0;  ///< The smoothing parameters of the cached scan
+    unsigned scanThreshold = 0;
+};
+
+} // namespace Dso
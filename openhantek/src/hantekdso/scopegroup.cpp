@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "dsomodel.h"
+#include "hantekdsocontrol.h"
+#include "scopegroup.h"
+#include "usb/usbdevice.h"
+
+namespace {
+
+/// \brief Linear interpolation with the edge values outside of the samples.
+inline float sampleAt(const std::vector<float> &samples, double position) {
+    if (position <= 0.0)
+        return samples.front();
+    const size_t index = size_t(position);
+    if (index + 1 >= samples.size())
+        return samples.back();
+    const float fraction = float(position - double(index));
+    return samples[index] + fraction * (samples[index + 1] - samples[index]);
+}
+
+/// \brief Copy samples that are shifted by position, target gets the size of count.
+void resample(const std::vector<float> &samples, double position, size_t count, std::vector<float> &target) {
+    target.resize(count);
+    if (position == std::floor(position) && position >= 0 && size_t(position) + count <= samples.size()) {
+        std::copy(samples.begin() + long(position), samples.begin() + long(position) + long(count), target.begin());
+        return;
+    }
+    for (size_t index = 0; index < count; ++index)
+        target[index] = sampleAt(samples, position + double(index));
+}
+
+} // namespace
+
+
+ScopeGroup::ScopeGroup(const std::vector<HantekDsoControl *> &controls) : devices(controls) {
+    const Dso::ControlSpecification *deviceSpec = devices.front()->getDevice()->getModel()->spec();
+    deviceChannels = deviceSpec->channels;
+    // the limits of the first device with the channels of all devices
+    groupSpec.reset(new Dso::ControlSpecification(unsigned(devices.size()) * deviceChannels));
+    groupSpec->samplerate = deviceSpec->samplerate;
+    groupSpec->bufferDividers = deviceSpec->bufferDividers;
+    groupSpec->sampleSize = deviceSpec->sampleSize;
+    groupSpec->fixedSampleRates = deviceSpec->fixedSampleRates;
+    for (ChannelID channel = 0; channel < groupSpec->channels; ++channel) {
+        groupSpec->voltageLimit[channel] = deviceSpec->voltageLimit[localChannel(channel)];
+        groupSpec->voltageOffset[channel] = deviceSpec->voltageOffset[localChannel(channel)];
+    }
+    groupSpec->gain = deviceSpec->gain;
+    groupSpec->couplings = deviceSpec->couplings;
+    groupSpec->triggerModes = deviceSpec->triggerModes;
+    groupSpec->fixedUSBinLength = deviceSpec->fixedUSBinLength;
+
+    for (unsigned device = 0; device < devices.size(); ++device) {
+        frames.emplace_back(new Frame);
+        // direct, the samples are copied in the acquisition thread before they are acknowledged
+        connect(devices[device], &HantekDsoControl::samplesAvailable,
+                [this, device](const DSOsamples *samples) { input(device, samples); });
+    }
+}
+
+
+void ScopeGroup::samplesProcessed() { devices.front()->samplesProcessed(); }
+
+
+void ScopeGroup::input(unsigned device, const DSOsamples *samples) {
+    if (devices.size() == 1) { // nothing to merge
+        emit samplesAvailable(samples);
+        return;
+    }
+    if (device) {
+        {
+            QReadLocker sourceLocker(&samples->lock);
+            Frame &frame = *frames[device];
+            QMutexLocker frameLocker(&frame.mutex);
+            frame.data.resize(samples->data.size());
+            frame.peakMin.resize(samples->data.size());
+            frame.peakMax.resize(samples->data.size());
+            for (size_t channel = 0; channel < samples->data.size(); ++channel) {
+                frame.data[channel] = samples->data[channel]; // keeps the capacity
+                const bool peaks = channel < samples->peakMin.size() &&
+                                   samples->peakMin[channel].size() == samples->data[channel].size();
+                if (peaks) {
+                    frame.peakMin[channel] = samples->peakMin[channel];
+                    frame.peakMax[channel] = samples->peakMax[channel];
+                } else {
+                    frame.peakMin[channel].clear();
+                    frame.peakMax[channel].clear();
+                }
+            }
+            frame.samplerate = samples->samplerate;
+            frame.clipped = samples->clipped;
+            frame.corrupted = samples->corrupted;
+            frame.captured = samples->timing.captured;
+            frame.sequence = samples->timing.sequence;
+        }
+        devices[device]->samplesProcessed(); // only the first device waits for the post processing
+        return;
+    }
+    {
+        QReadLocker firstLocker(&samples->lock);
+        QWriteLocker mergedLocker(&merged.lock);
+        merge(*samples);
+    }
+    emit samplesAvailable(&merged);
+}
+
+
+void ScopeGroup::merge(const DSOsamples &first) {
+    merged.samplerate = first.samplerate;
+    merged.clipped = first.clipped;
+    merged.liveTrigger = first.liveTrigger;
+    merged.triggerPosition = first.triggerPosition;
+    merged.triggerFraction = first.triggerFraction;
+    merged.pulseWidth = first.pulseWidth;
+    merged.triggerEvents = first.triggerEvents;
+    merged.pulseWidthMin = first.pulseWidthMin;
+    merged.pulseWidthMax = first.pulseWidthMax;
+    merged.etsCoverage = first.etsCoverage;
+    merged.averagedFrames = first.averagedFrames;
+    merged.corrupted = first.corrupted;
+    merged.timing = first.timing;
+
+    const ChannelID channels = groupSpec->channels;
+    merged.data.resize(channels);
+    merged.peakMin.resize(channels);
+    merged.peakMax.resize(channels);
+    size_t length = 0; // the window of the first device
+    for (ChannelID channel = 0; channel < deviceChannels; ++channel) {
+        const bool used = channel < first.data.size() && !first.data[channel].empty();
+        merged.data[channel] = used ? first.data[channel] : std::vector<float>();
+        const bool peaks = used && channel < first.peakMin.size() && first.peakMin[channel].size() == first.data[channel].size();
+        merged.peakMin[channel] = peaks ? first.peakMin[channel] : std::vector<float>();
+        merged.peakMax[channel] = peaks ? first.peakMax[channel] : std::vector<float>();
+        if (used)
+            length = std::max(length, first.data[channel].size());
+    }
+
+    // all devices trigger on the same input, it carries the reference signal
+    const ChannelID reference = ChannelID(devices.front()->getDeviceSettings()->trigger.source);
+    for (unsigned device = 1; device < devices.size(); ++device) {
+        Frame &frame = *frames[device];
+        QMutexLocker frameLocker(&frame.mutex);
+        const ChannelID firstChannel = this->firstChannel(device);
+        size_t frameLength = 0;
+        for (const std::vector<float> &samples : frame.data)
+            frameLength = std::max(frameLength, samples.size());
+        const size_t count = length ? length : frameLength;
+        // the position of the first merged sample in the frame, placed by the capture timestamps
+        double position = double(first.timing.captured - frame.captured) * 1e-9 * first.samplerate;
+        const bool usable = frame.sequence && frame.samplerate == first.samplerate && frameLength &&
+                            std::fabs(position) < double(std::max(count, frameLength));
+        if (usable && reference < frame.data.size() && reference < first.data.size() &&
+            !frame.data[reference].empty() && !first.data[reference].empty()) {
+            const unsigned range =
+                unsigned(std::min(SCOPE_GROUP_JITTER * first.samplerate, double(std::max<size_t>(count / 4, 1))));
+            position = align(first.data[reference], frame.data[reference], position, std::max(range, 1u));
+        }
+        for (ChannelID channel = 0; channel < deviceChannels; ++channel) {
+            std::vector<float> &data = merged.data[firstChannel + channel];
+            std::vector<float> &peakMin = merged.peakMin[firstChannel + channel];
+            std::vector<float> &peakMax = merged.peakMax[firstChannel + channel];
+            if (!usable || channel >= frame.data.size() || frame.data[channel].empty()) { // no overlapping frame
+                data.clear();
+                peakMin.clear();
+                peakMax.clear();
+                continue;
+            }
+            resample(frame.data[channel], position, count, data);
+            if (frame.peakMin[channel].size() == frame.data[channel].size()) {
+                resample(frame.peakMin[channel], position, count, peakMin);
+                resample(frame.peakMax[channel], position, count, peakMax);
+            } else {
+                peakMin.clear();
+                peakMax.clear();
+            }
+            // the samples of a frame with a gap are shown as invalid like clipped ones
+            if ((frame.clipped & (0x01 << channel)) || frame.corrupted)
+                merged.clipped |= 0x01 << (firstChannel + channel);
+        }
+    }
+}
+
+
+double ScopeGroup::align(const std::vector<float> &reference, const std::vector<float> &samples, double estimate,
+                         unsigned range) {
+    const long referenceSize = long(reference.size());
+    const long size = long(samples.size());
+    if (referenceSize < 4 || size < 4)
+        return estimate;
+    // a subset of the reference is correlated, it keeps the cost per lag constant
+    const long step = std::max(1L, referenceSize / SCOPE_GROUP_CORRELATION);
+    double referenceMean = 0.0;
+    long referenceCount = 0;
+    for (long index = 0; index < referenceSize; index += step, ++referenceCount)
+        referenceMean += double(reference[size_t(index)]);
+    referenceMean /= double(referenceCount);
+    double mean = 0.0;
+    for (float value : samples)
+        mean += double(value);
+    mean /= double(size);
+
+    const long center = std::lround(estimate);
+    // at least half of the correlated reference samples have to fall into the frame
+    auto correlation = [&](long lag) {
+        double sum = 0.0;
+        long count = 0;
+        for (long index = 0; index < referenceSize; index += step) {
+            const long position = index + center + lag;
+            if (position < 0 || position >= size)
+                continue;
+            sum += (double(reference[size_t(index)]) - referenceMean) * (double(samples[size_t(position)]) - mean);
+            ++count;
+        }
+        return 2 * count >= referenceCount ? sum / double(count) : -std::numeric_limits<double>::infinity();
+    };
+
+    // coarse search with a lag step that keeps the number of lags bounded, then sample by sample
+    const long lagRange = long(range);
+    const long lagStep = std::max(1L, lagRange / 32);
+    long best = 0;
+    double bestCorrelation = -std::numeric_limits<double>::infinity();
+    for (long lag = -lagRange; lag <= lagRange; lag += lagStep) {
+        const double value = correlation(lag);
+        if (value > bestCorrelation) {
+            bestCorrelation = value;
+            best = lag;
+        }
+    }
+    const long coarse = best;
+    for (long lag = std::max(-lagRange, coarse - lagStep + 1); lag <= std::min(lagRange, coarse + lagStep - 1); ++lag) {
+        const double value = correlation(lag);
+        if (value > bestCorrelation) {
+            bestCorrelation = value;
+            best = lag;
+        }
+    }
+    if (!(bestCorrelation > 0.0)) // the reference signal is not on both devices
+        return estimate;
+    // the vertex of the parabola through the maximum and its neighbours
+    double fraction = 0.0;
+    const double before = correlation(best - 1);
+    const double after = correlation(best + 1);
+    const double curvature = before - 2.0 * bestCorrelation + after;
+    if (std::isfinite(before) && std::isfinite(after) && curvature < 0.0)
+        fraction = std::max(-0.5, std::min(0.5, 0.5 * (before - after) / curvature));
+    return double(center + best) + fraction;
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <memory>
+#include <vector>
+
+#include "controlspecification.h"
+#include "dsosamples.h"
+
+class HantekDsoControl;
+
+#define SCOPE_GROUP_DEVICES_MAX 4    ///< The channels of the group fit into the bitmask of the clipped channels
+#define SCOPE_GROUP_JITTER 2e-3      ///< Uncertainty of the capture timestamps of different devices in s
+#define SCOPE_GROUP_CORRELATION 2048 ///< Samples of the trigger channel that are cross-correlated
+
+/// \brief Several oscilloscopes of the same model that are shown as one scope with the channels of all devices.
+/// Every device keeps its own HantekDsoControl and acquisition thread. The frames of the further devices are
+/// copied in their threads and acknowledged at once, so no device waits for another. A frame of the first
+/// device is merged with the latest frames of the others in the thread of the first device: the frames are
+/// placed by their capture timestamps, the placement is refined by the cross-correlation of the trigger
+/// channels, which carry the same reference signal on all devices. Only the first device waits for the post
+/// processing. A group of one device passes the frames through.
+class ScopeGroup : public QObject {
+    Q_OBJECT
+
+  public:
+    /// \param controls The controls of the devices, the first one paces the group.
+    explicit ScopeGroup(const std::vector<HantekDsoControl *> &controls);
+
+    /// \return The specification of one device with the channels of all devices.
+    inline const Dso::ControlSpecification *spec() const { return groupSpec.get(); }
+    inline const std::vector<HantekDsoControl *> &controls() const { return devices; }
+    /// \return The control of the device that samples a channel of the group.
+    inline HantekDsoControl *control(ChannelID channel) const { return devices[channel / deviceChannels]; }
+    /// \return The channel of its device that is a channel of the group.
+    inline ChannelID localChannel(ChannelID channel) const { return channel % deviceChannels; }
+    /// \return The channel of the group that is the first channel of a device.
+    inline ChannelID firstChannel(unsigned device) const { return ChannelID(device * deviceChannels); }
+
+    /// \brief Acknowledge the samples of the last samplesAvailable() signal.
+    /// Thread safe, connect it directly to the end of the post processing.
+    void samplesProcessed();
+
+    /// \brief Place a frame of another device on the time axis of a reference frame.
+    /// \param reference The trigger channel of the reference frame.
+    /// \param samples The trigger channel of the other frame.
+    /// \param estimate The position of reference[0] within samples, estimated from the capture timestamps.
+    /// \param range The cross-correlation maximum is searched in [estimate - range, estimate + range].
+    /// \return The refined position with sub-sample resolution, estimate if the channels do not correlate.
+    static double align(const std::vector<float> &reference, const std::vector<float> &samples, double estimate,
+                        unsigned range);
+
+  signals:
+    void samplesAvailable(const DSOsamples *samples); ///< The merged frame is available
+
+  private:
+    /// \brief The last frame of a further device.
+    struct Frame {
+        QMutex mutex;
+        std::vector<std::vector<float>> data;
+        std::vector<std::vector<float>> peakMin;
+        std::vector<std::vector<float>> peakMax;
+        double samplerate = 0.0;
+        unsigned char clipped = 0;
+        bool corrupted = false;
+        qint64 captured = 0;
+        unsigned long long sequence = 0; ///< 0 = no frame yet
+    };
+
+    /// \brief Called in the thread of the device that published the samples.
+    void input(unsigned device, const DSOsamples *samples);
+    /// \brief Build the merged frame from the frame of the first device.
+    void merge(const DSOsamples &first);
+
+    std::vector<HantekDsoControl *> devices;
+    ChannelID deviceChannels;                       ///< The channels of one device
+    std::unique_ptr<Dso::ControlSpecification> groupSpec;
+    std::vector<std::unique_ptr<Frame>> frames;     ///< The last frame of each device, [0] is unused
+    DSOsamples merged;                              ///< The frame with the channels of all devices
+};
@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "dsosamples.h"
+#include "segmentstore.h"
+
+namespace Dso {
+
+void SegmentStore::configure(unsigned count, unsigned length, unsigned channels) {
+    if (count == this->count && length == segmentLength && channels == this->channels)
+        return;
+    this->count = count;
+    segmentLength = length;
+    this->channels = channels;
+    used = 0;
+    arena.assign(size_t(count) * channels * length, 0.0f);
+    infos.assign(count, SegmentInfo());
+    channelMask.assign(count, 0);
+}
+
+
+bool SegmentStore::append(const std::vector<std::vector<float>> &data, size_t start, double samplerate,
+                          const SegmentInfo &info) {
+    if (used >= count)
+        return false;
+    if (used && samplerate != this->samplerate) // a new timebase starts a new sequence
+        used = 0;
+    this->samplerate = samplerate;
+    unsigned char mask = 0;
+    for (unsigned channel = 0; channel < channels && channel < data.size(); ++channel) {
+        if (data[channel].size() < start + segmentLength)
+            continue;
+        std::copy(data[channel].begin() + long(start), data[channel].begin() + long(start + segmentLength),
+                  arena.begin() + long((size_t(used) * channels + channel) * segmentLength));
+        mask |= 0x01 << channel;
+    }
+    infos[used] = info;
+    channelMask[used] = mask;
+    ++used;
+    return true;
+}
+
+
+void SegmentStore::view(DSOsamples &target, int segment) const {
+    if (!used)
+        return;
+    const bool overlay = segment < 0 || unsigned(segment) >= used;
+    const unsigned shown = overlay ? used - 1 : unsigned(segment);
+    target.data.resize(channels);
+    target.peakMin.resize(channels);
+    target.peakMax.resize(channels);
+    target.clipped = 0;
+    target.corrupted = false;
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        std::vector<float> &samples = target.data[channel];
+        std::vector<float> &peakMin = target.peakMin[channel];
+        std::vector<float> &peakMax = target.peakMax[channel];
+        peakMin.clear();
+        peakMax.clear();
+        if (!(channelMask[shown] & (0x01 << channel))) {
+            samples.clear();
+            continue;
+        }
+        samples.assign(this->samples(shown, channel), this->samples(shown, channel) + segmentLength);
+        if (!overlay)
+            continue;
+        // the envelope of all segments shows the variation of the signal around the trigger point
+        peakMin = samples;
+        peakMax = samples;
+        for (unsigned index = 0; index < used; ++index) {
+            if (!(channelMask[index] & (0x01 << channel)))
+                continue;
+            const float *data = this->samples(index, channel);
+            for (unsigned sample = 0; sample < segmentLength; ++sample) {
+                peakMin[sample] = std::min(peakMin[sample], data[sample]);
+                peakMax[sample] = std::max(peakMax[sample], data[sample]);
+            }
+        }
+    }
+    for (unsigned index = overlay ? 0 : shown; index <= shown; ++index) {
+        target.clipped |= infos[index].clipped;
+        target.corrupted |= infos[index].corrupted;
+    }
+    target.samplerate = samplerate;
+    // the segments start one sample before the screen, a trigger position of 0 means not triggered
+    target.triggerPosition = 1;
+    target.triggerFraction = 0.0;
+    target.etsCoverage = 0.0;
+    target.averagedFrames = 0;
+    target.liveTrigger = true;
+    target.pulseWidth = 0.0;
+    target.triggerEvents = overlay ? used : 1;
+    target.pulseWidthMin = target.pulseWidthMax = 0.0;
+}
+
+} // namespace Dso
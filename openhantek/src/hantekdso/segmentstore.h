@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QtGlobal>
+#include <vector>
+
+struct DSOsamples;
+
+namespace Dso {
+
+/// \brief Origin of one stored segment.
+struct SegmentInfo {
+    qint64 time = 0;                 ///< monotonicTime() of the trigger point, estimated from the end of the block
+    unsigned long long sequence = 0; ///< The acquisition that contained the segment
+    unsigned char clipped = 0;       ///< Bitmask of the channels that were clipped in this acquisition
+    bool corrupted = false;          ///< The acquisition had a gap
+};
+
+/// \brief Preallocated memory for the windows around the trigger points of a segmented acquisition.
+/// The arena holds count * channels * length samples. It is only reallocated if the configuration
+/// changes, so capturing a sequence does not allocate memory.
+class SegmentStore {
+  public:
+    /// \brief Set the number and length of the segments, the stored segments are discarded on a change.
+    void configure(unsigned count, unsigned length, unsigned channels);
+
+    /// \brief Discard the stored segments and start a new sequence.
+    inline void clear() { used = 0; }
+
+    inline unsigned size() const { return used; }
+    inline unsigned capacity() const { return count; }
+    inline unsigned length() const { return segmentLength; }
+    inline bool isFull() const { return count && used >= count; }
+    inline double getSamplerate() const { return samplerate; }
+    inline const SegmentInfo &info(unsigned segment) const { return infos[segment]; }
+
+    /// \brief Copy the samples [start, start + length()) of all channels as the next segment.
+    /// Channels without enough samples, i.e. unused ones, are stored as empty.
+    /// \return false if the store is full.
+    bool append(const std::vector<std::vector<float>> &data, size_t start, double samplerate,
+                const SegmentInfo &info);
+
+    /// \brief Fill the samples of a DSOsamples with the stored segments.
+    /// \param segment The index of the shown segment. If it is negative, the last segment is shown
+    /// with the min/max envelope of all segments as overlay.
+    void view(DSOsamples &target, int segment) const;
+
+  private:
+    inline const float *samples(unsigned segment, unsigned channel) const {
+        return arena.data() + (size_t(segment) * channels + channel) * segmentLength;
+    }
+
+    unsigned count = 0;
+    unsigned segmentLength = 0;
+    unsigned channels = 0;
+    unsigned used = 0;
+    double samplerate = 0.0;
+    std::vector<float> arena;               ///< The samples, ordered by segment, channel
+    std::vector<SegmentInfo> infos;         ///< Origin of each segment
+    std::vector<unsigned char> channelMask; ///< Bitmask of the stored channels of each segment
+};
+
+} // namespace Dso
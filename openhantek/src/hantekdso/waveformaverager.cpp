@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <algorithm>
+
+#include "dsosamples.h"
+#include "viewconstants.h"
+#include "waveformaverager.h"
+
+namespace Dso {
+
+void WaveformAverager::configure(AveragingMode mode, unsigned count, unsigned length, unsigned channels,
+                                 double samplerate, bool envelope) {
+    length += 2; // one sample before and after the screen
+    const unsigned planes = envelope ? 3 : 1;
+    if (mode == AveragingMode::Linear) // the ring holds count frames
+        count = std::min(count, unsigned(AVERAGE_ARENA_MAX / (size_t(channels) * planes * length)));
+    count = std::max(count, 1u);
+    if (mode == this->mode && count == this->count && length == this->length && channels == this->channels &&
+        samplerate == this->samplerate && planes == this->planes)
+        return;
+    this->mode = mode;
+    this->count = count;
+    this->length = length;
+    this->channels = channels;
+    this->samplerate = samplerate;
+    this->planes = planes;
+    const size_t traces = size_t(channels) * planes;
+    ring.assign(mode == AveragingMode::Linear ? size_t(count) * traces * length : 0, 0.0f);
+    sums.assign(traces * length, 0.0);
+    clear();
+}
+
+
+void WaveformAverager::clear() {
+    std::fill(ring.begin(), ring.end(), 0.0f);
+    std::fill(sums.begin(), sums.end(), 0.0);
+    frames = 0;
+    next = 0;
+    usedChannels = 0;
+}
+
+
+void WaveformAverager::add(const DSOsamples &frame) {
+    const size_t start = frame.triggerPosition > 0 ? size_t(frame.triggerPosition) : 0;
+    if (mode == AveragingMode::Off || !length || !start)
+        return;
+    const std::vector<std::vector<float>> &data = frame.data;
+    unsigned char used = 0;
+    for (unsigned channel = 0; channel < channels && channel < data.size(); ++channel) {
+        if (data[channel].size() >= start + length) // the last sample is interpolated with the next one
+            used |= 0x01 << channel;
+    }
+    if (used != usedChannels) { // a channel was switched on or off
+        clear();
+        usedChannels = used;
+    }
+    frames = std::min(frames + 1, count);
+    const float weight = float(frame.triggerFraction);
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        if (!(used & (0x01 << channel)))
+            continue;
+        const std::vector<float> *sources[] = {&data[channel], &data[channel], &data[channel]};
+        if (planes > 1 && channel < frame.peakMin.size() && channel < frame.peakMax.size() &&
+            frame.peakMin[channel].size() == data[channel].size() &&
+            frame.peakMax[channel].size() == data[channel].size()) {
+            sources[1] = &frame.peakMin[channel];
+            sources[2] = &frame.peakMax[channel];
+        }
+        for (unsigned plane = 0; plane < planes; ++plane) {
+            const size_t trace = size_t(channel) * planes + plane;
+            // sample index is (index - fraction) after the screen start, interpolate the aligned samples
+            const float *samples = sources[plane]->data() + start - 1;
+            double *sum = sums.data() + trace * length;
+            if (mode == AveragingMode::Linear) {
+                float *oldest = ring.data() + (size_t(next) * channels * planes + trace) * length;
+                for (unsigned index = 0; index < length; ++index) {
+                    const float value = samples[index] + weight * (samples[index + 1] - samples[index]);
+                    sum[index] += double(value) - double(oldest[index]);
+                    oldest[index] = value;
+                }
+            } else { // the first frames have a larger weight until the average is complete
+                const double factor = 1.0 / frames;
+                for (unsigned index = 0; index < length; ++index) {
+                    const float value = samples[index] + weight * (samples[index + 1] - samples[index]);
+                    sum[index] += (double(value) - sum[index]) * factor;
+                }
+            }
+        }
+    }
+    if (mode == AveragingMode::Linear)
+        next = (next + 1) % count;
+}
+
+
+void WaveformAverager::view(DSOsamples &target) const {
+    target.data.resize(channels);
+    target.peakMin.resize(channels);
+    target.peakMax.resize(channels);
+    const double scale = mode == AveragingMode::Linear && frames ? 1.0 / frames : 1.0;
+    for (unsigned channel = 0; channel < channels; ++channel) {
+        std::vector<float> *outputs[] = {&target.data[channel], &target.peakMin[channel], &target.peakMax[channel]};
+        for (std::vector<float> *output : outputs)
+            output->clear();
+        if (!frames || !(usedChannels & (0x01 << channel)))
+            continue;
+        for (unsigned plane = 0; plane < planes; ++plane) {
+            std::vector<float> &samples = *outputs[plane];
+            samples.resize(length);
+            const double *sum = sums.data() + (size_t(channel) * planes + plane) * length;
+            for (unsigned index = 0; index < length; ++index)
+                samples[index] = float(sum[index] * scale);
+        }
+    }
+    target.triggerPosition = 1;
+    target.triggerFraction = 0.0;
+}
+
+} // namespace Dso
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <vector>
+
+#include "enums.h"
+
+struct DSOsamples;
+
+namespace Dso {
+
+/// \brief Average of the screens of the triggered frames, aligned on the sub-sample trigger crossing.
+/// The linear average keeps the last frames in a ring and a running sum, the exponential average only the
+/// average itself. With peak detect the envelope is averaged like the trace. Adding a frame costs O(samples)
+/// independent of the number of averaged frames. The memory is allocated by configure(), adding a frame does
+/// not allocate memory.
+class WaveformAverager {
+  public:
+    /// \brief Set up the average, the averaged frames are discarded on a change.
+    /// \param count The number of averaged frames, limited by the memory of the linear average.
+    /// \param length The samples per channel of the screen.
+    /// \param envelope Average the peak detect envelope as well.
+    void configure(AveragingMode mode, unsigned count, unsigned length, unsigned channels, double samplerate,
+                   bool envelope);
+
+    /// \brief Discard the averaged frames.
+    void clear();
+
+    /// \brief Add the screen of a triggered frame to the average.
+    /// The screen starts at frame.triggerPosition, the trigger crossing is frame.triggerFraction of a sample
+    /// interval after it. A channel without envelope contributes its samples to the averaged envelope.
+    void add(const DSOsamples &frame);
+
+    /// \brief Replace the samples and the envelope of target with the average.
+    /// The average starts one sample interval before the screen, target.triggerPosition points to the screen.
+    void view(DSOsamples &target) const;
+
+    /// \return The number of frames in the average.
+    inline unsigned size() const { return frames; }
+
+  private:
+    AveragingMode mode = AveragingMode::Off;
+    unsigned count = 0;      ///< Frames of a complete average
+    unsigned length = 0;     ///< Averaged samples per channel, the screen and one sample on either side
+    unsigned channels = 0;
+    double samplerate = 0.0;
+    unsigned planes = 1;     ///< Traces per channel: the samples, with the envelope also its minimum and maximum
+    unsigned frames = 0;     ///< Frames in the average, up to count
+    unsigned next = 0;       ///< Linear: the slot of the ring that is replaced next
+    unsigned char usedChannels = 0;
+    std::vector<float> ring; ///< Linear: the last count frames, ordered by frame, channel, plane, sample
+    std::vector<double> sums; ///< Running sum (linear) or average (exponential), ordered by channel, plane, sample
+};
+
+} // namespace Dso
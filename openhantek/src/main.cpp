@@ -3,9 +3,11 @@
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QLibraryInfo>
 #include <QLocale>
 #include <QSurfaceFormat>
+#include <QTimer>
 #include <QTranslator>
 #ifdef __linux__
 #include <QStyleFactory>
@@ -17,6 +19,8 @@
 	#include <libusb-1.0/libusb.h>
 #endif
 #include <memory>
+#include <set>
+#include <vector>
 
 // Settings
 #include "settings.h"
@@ -26,7 +30,12 @@
 // DSO core logic
 #include "dsomodel.h"
 #include "hantekdsocontrol.h"
+#include "scopegroup.h"
+#include "usb/finddevices.h"
+#include "usb/hotplugwatcher.h"
 #include "usb/usbdevice.h"
+#include "usb/uploadFirmware.h"
+#include "utils/threadscheduling.h"
 
 // Post processing
 #include "post/graphgenerator.h"
@@ -55,26 +64,95 @@
 #include "OH_VERSION.h"
 
 
+#define SCOPE_GROUP_CONNECT_TIMEOUT 10000 ///< Longest wait for the further devices of a group in ms
+
+
 using namespace Hantek;
 
-/// \brief Initialize the device with the current settings.
-void applySettingsToDevice(HantekDsoControl *dsoControl, DsoSettingsScope *scope,
-                           const Dso::ControlSpecification *spec) {
+/// \brief Initialize a device of the group with the current settings.
+void applySettingsToDevice(HantekDsoControl *dsoControl, DsoSettingsScope *scope, const ScopeGroup *group,
+                           unsigned device) {
+    const Dso::ControlSpecification *spec = group->spec();
     bool mathUsed = scope->anyUsed(spec->channels);
-    for (ChannelID channel = 0; channel < spec->channels; ++channel) {
-        dsoControl->setProbe( channel, scope->voltage[channel].probeUsed, scope->voltage[channel].probeAttn );
-        dsoControl->setGain(channel, scope->gain(channel) * DIVS_VOLTAGE);
-        dsoControl->setTriggerLevel(channel, scope->voltage[channel].trigger);
-        dsoControl->setChannelUsed(channel, mathUsed | scope->anyUsed(channel));
-        dsoControl->setChannelInverted(channel, scope->voltage[channel].inverted);
-        dsoControl->setCoupling(channel, Dso::Coupling(scope->voltage[channel].couplingOrMathIndex));
+    const ChannelID firstChannel = group->firstChannel(device);
+    for (ChannelID local = 0; local < dsoControl->getChannelCount(); ++local) {
+        const ChannelID channel = firstChannel + local;
+        dsoControl->setProbe( local, scope->voltage[channel].probeUsed, scope->voltage[channel].probeAttn );
+        dsoControl->setGain(local, scope->gain(channel) * DIVS_VOLTAGE);
+        dsoControl->setChannelUsed(local, mathUsed | scope->anyUsed(channel));
+        dsoControl->setChannelInverted(local, scope->voltage[channel].inverted);
+        dsoControl->setCoupling(local, Dso::Coupling(scope->voltage[channel].couplingOrMathIndex));
     }
 
+    dsoControl->setRecordLength(scope->horizontal.recordLength);
+    dsoControl->setPeakDetect(scope->horizontal.peakDetect);
+    dsoControl->setSegmentedCapture(scope->horizontal.segmentCount, scope->horizontal.segmentLength);
+    dsoControl->setHistoryMemory(scope->horizontal.historyMemory);
+    dsoControl->setEtsFactor(scope->horizontal.etsFactor);
+    dsoControl->setAveraging(scope->horizontal.averaging, scope->horizontal.averageCount);
     dsoControl->setRecordTime(scope->horizontal.timebase * DIVS_TIME);
     dsoControl->setTriggerMode(scope->trigger.mode);
     dsoControl->setTriggerPosition(scope->trigger.position);
     dsoControl->setTriggerSlope(scope->trigger.slope);
-    dsoControl->setTriggerSource(scope->trigger.source, scope->trigger.smooth);
+    // every device triggers on its own input of the trigger channel with the level of the trigger channel
+    const ChannelID source = ChannelID(scope->trigger.source);
+    dsoControl->setTriggerSource(group->localChannel(source), scope->trigger.smooth);
+    dsoControl->setTriggerLevel(group->localChannel(source), scope->voltage[source].trigger);
+    dsoControl->setTriggerType(scope->trigger.type);
+    dsoControl->setTriggerCondition(scope->trigger.condition, scope->trigger.time, scope->trigger.timeUpper);
+    dsoControl->setTriggerSecondLevel(scope->trigger.secondLevel);
+    dsoControl->setFastAcquisition(scope->trigger.fastAcquisition);
+}
+
+/// \brief Connect further devices of the model of the first device, for a scope group.
+/// The devices without firmware get it and are taken after their renumeration.
+/// \param count The number of further devices that are wanted.
+/// \return The connected devices, fewer than count if not enough were found in time.
+std::vector<std::unique_ptr<USBDevice>> connectFurtherDevices(libusb_context *context, const USBDevice *first,
+                                                              unsigned count) {
+    std::vector<std::unique_ptr<USBDevice>> further;
+    std::set<UniqueUSBid> uploaded;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < SCOPE_GROUP_CONNECT_TIMEOUT) {
+        // a fresh list, a renumerated device at the same port is not updated by updateDeviceList()
+        FindDevices findDevices(context);
+        findDevices.updateDeviceList();
+        std::vector<UniqueUSBid> ready;
+        bool pending = false;
+        for (const auto &entry : *findDevices.getDevices()) {
+            USBDevice *candidate = entry.second.get();
+            if (entry.first == first->getUniqueUSBDeviceID() || candidate->getModel() != first->getModel())
+                continue;
+            if (candidate->needsFirmware()) {
+                if (uploaded.insert(entry.first).second) {
+                    UploadFirmware uploadFirmware;
+                    if (uploadFirmware.startUpload(candidate))
+                        pending = true;
+                    else
+                        qWarning() << uploadFirmware.getErrorMessage();
+                } else
+                    pending = true;
+                continue;
+            }
+            ready.push_back(entry.first);
+        }
+        if (ready.size() >= count || !pending) {
+            for (UniqueUSBid id : ready) {
+                if (further.size() == count)
+                    break;
+                std::unique_ptr<USBDevice> device = findDevices.takeDevice(id);
+                QString errorMessage;
+                if (device->connectDevice(errorMessage))
+                    further.push_back(std::move(device));
+                else
+                    qWarning() << errorMessage;
+            }
+            break;
+        }
+        QThread::msleep(250);
+    }
+    return further;
 }
 
 /// \brief Initialize resources and translations and show the main window.
@@ -90,6 +168,11 @@ int main(int argc, char *argv[]) {
 #endif
 
     bool useGLES = false;
+    bool useStreaming = false;
+    unsigned scopes = 1;
+    ThreadScheduling acquisitionScheduling;
+    ThreadScheduling processingScheduling;
+    bool useLatencyWatchdog = false;
     {
         QCoreApplication parserApp(argc, argv);
         QCommandLineParser p;
@@ -97,8 +180,51 @@ int main(int argc, char *argv[]) {
         p.addVersionOption();
         QCommandLineOption useGlesOption("useGLES", QCoreApplication::tr("Use OpenGL ES instead of OpenGL"));
         p.addOption(useGlesOption);
+        QCommandLineOption useStreamingOption("streaming",
+                                              QCoreApplication::tr("Read samples with asynchronous USB streaming"));
+        p.addOption(useStreamingOption);
+        QCommandLineOption scopesOption(
+            "scopes",
+            QCoreApplication::tr("Acquire with several devices of the same model, the selected one and further ones "
+                                 "(max. %1), their trigger channels have to carry the same signal")
+                .arg(SCOPE_GROUP_DEVICES_MAX),
+            QCoreApplication::tr("count"), "1");
+        p.addOption(scopesOption);
+        QCommandLineOption acquisitionPriorityOption(
+            "acquisitionPriority",
+            QCoreApplication::tr("Scheduling of the acquisition threads: normal, high, fifo:<1-99> or rr:<1-99>, "
+                                 "falls back to high if real-time scheduling is not permitted"),
+            QCoreApplication::tr("policy"), "normal");
+        p.addOption(acquisitionPriorityOption);
+        QCommandLineOption acquisitionCpusOption(
+            "acquisitionCpus", QCoreApplication::tr("CPUs of the acquisition threads, e.g. 2,3 or 2-3"),
+            QCoreApplication::tr("cpus"));
+        p.addOption(acquisitionCpusOption);
+        QCommandLineOption processingPriorityOption(
+            "processingPriority",
+            QCoreApplication::tr("Scheduling of the post processing thread, see acquisitionPriority"),
+            QCoreApplication::tr("policy"), "normal");
+        p.addOption(processingPriorityOption);
+        QCommandLineOption processingCpusOption(
+            "processingCpus", QCoreApplication::tr("CPUs of the post processing thread"), QCoreApplication::tr("cpus"));
+        p.addOption(processingCpusOption);
+        QCommandLineOption latencyWatchdogOption(
+            "latencyWatchdog",
+            QCoreApplication::tr("Measure the scheduling latency and the jitter of the acquisition loop, "
+                                 "shown in the tooltip of the acquisition rate"));
+        p.addOption(latencyWatchdogOption);
         p.process(parserApp);
+        if (!acquisitionScheduling.parsePolicy(p.value(acquisitionPriorityOption)) ||
+            !acquisitionScheduling.parseCpus(p.value(acquisitionCpusOption)) ||
+            !processingScheduling.parsePolicy(p.value(processingPriorityOption)) ||
+            !processingScheduling.parseCpus(p.value(processingCpusOption))) {
+            qWarning() << "Invalid thread priority or CPU list";
+            return -1;
+        }
+        useLatencyWatchdog = p.isSet(latencyWatchdogOption);
+        scopes = qBound(1u, p.value(scopesOption).toUInt(), unsigned(SCOPE_GROUP_DEVICES_MAX));
         useGLES = p.isSet(useGlesOption);
+        useStreaming = p.isSet(useStreamingOption);
     }
 
 #ifdef __arm__
@@ -146,22 +272,60 @@ int main(int argc, char *argv[]) {
         return -1;
     }
 
-    //////// Create DSO control object and move it to a separate thread ////////
-    QThread dsoControlThread;
-    dsoControlThread.setObjectName("dsoControlThread");
-    HantekDsoControl dsoControl(device.get());
-    dsoControl.moveToThread(&dsoControlThread);
-    QObject::connect(&dsoControlThread, &QThread::started, &dsoControl, &HantekDsoControl::run);
-    QObject::connect(&dsoControl, &HantekDsoControl::communicationError, QCoreApplication::instance(),
-                     &QCoreApplication::quit);
-    QObject::connect(device.get(), &USBDevice::deviceDisconnected, QCoreApplication::instance(),
-                     &QCoreApplication::quit);
+    std::vector<std::unique_ptr<USBDevice>> devices;
+    devices.push_back(std::move(device));
+    if (scopes > 1) {
+        for (std::unique_ptr<USBDevice> &further : connectFurtherDevices(context, devices.front().get(), scopes - 1))
+            devices.push_back(std::move(further));
+        if (devices.size() < scopes)
+            qWarning() << "Only" << devices.size() << "of" << scopes << "devices are available";
+    }
+
+    //////// Create a DSO control object per device and move it to a separate thread ////////
+    std::vector<std::unique_ptr<QThread>> dsoControlThreads;
+    std::vector<std::unique_ptr<HantekDsoControl>> dsoControls;
+    std::vector<HantekDsoControl *> controls;
+    for (std::unique_ptr<USBDevice> &usbDevice : devices) {
+        QThread *dsoControlThread = new QThread;
+        dsoControlThread->setObjectName(dsoControlThreads.empty() ? QString("dsoControlThread")
+                                                                   : QString("dsoControlThread%1").arg(controls.size()));
+        HantekDsoControl *dsoControl = new HantekDsoControl(usbDevice.get());
+        dsoControl->setStreaming(useStreaming);
+        dsoControl->setScheduling(acquisitionScheduling);
+        dsoControl->setLatencyWatchdog(useLatencyWatchdog && dsoControlThreads.empty()); // the first device
+        dsoControl->moveToThread(dsoControlThread);
+        QObject::connect(dsoControlThread, &QThread::started, dsoControl, &HantekDsoControl::run);
+        // a lost device is taken over again when it is plugged in, other communication errors are fatal
+        USBDevice *deviceOfControl = usbDevice.get();
+        QObject::connect(dsoControl, &HantekDsoControl::communicationError, QCoreApplication::instance(),
+                         [deviceOfControl]() {
+                             if (deviceOfControl->isConnected())
+                                 QCoreApplication::quit();
+                         });
+        dsoControlThreads.emplace_back(dsoControlThread);
+        dsoControls.emplace_back(dsoControl);
+        controls.push_back(dsoControl);
+    }
+    HantekDsoControl &dsoControl = *controls.front();
+    ScopeGroup group(controls);
+    HotplugWatcher hotplugWatcher(context);
+    QObject::connect(&hotplugWatcher, &HotplugWatcher::deviceArrived, [&devices, &controls](libusb_device *rawDevice) {
+        // offered to the first control that lost its device, reattaching checks the model
+        for (size_t index = 0; index < devices.size(); ++index) {
+            if (devices[index]->isConnected())
+                continue;
+            libusb_ref_device(rawDevice); // released by reconnectDevice()
+            QMetaObject::invokeMethod(controls[index], "reconnectDevice", Qt::QueuedConnection,
+                                      Q_ARG(libusb_device *, rawDevice));
+            return;
+        }
+    });
 
     //////// Create settings object ////////
-    DsoSettings settings(device->getModel()->spec());
+    DsoSettings settings(group.spec());
 
     //////// Create exporters ////////
-    ExporterRegistry exportRegistry(device->getModel()->spec(), &settings);
+    ExporterRegistry exportRegistry(group.spec(), &settings);
 
     ExporterCSV exporterCSV;
     ExporterImage exportImage;
@@ -176,10 +340,10 @@ int main(int argc, char *argv[]) {
     //////// Create post processing objects ////////
     QThread postProcessingThread;
     postProcessingThread.setObjectName("postProcessingThread");
-    PostProcessing postProcessing(settings.scope.countChannels());
+    PostProcessing postProcessing(settings.scope.countChannels(), &dsoControl.frameCounters());
 
     SpectrumGenerator spectrumGenerator(&settings.scope, &settings.post);
-    MathChannelGenerator mathchannelGenerator(&settings.scope, device->getModel()->spec()->channels);
+    MathChannelGenerator mathchannelGenerator(&settings.scope, group.spec()->channels);
     GraphGenerator graphGenerator(&settings.scope, &settings.view);
 
     postProcessing.registerProcessor(&samplesToExportRaw);
@@ -188,13 +352,23 @@ int main(int argc, char *argv[]) {
     postProcessing.registerProcessor(&graphGenerator);
 
     postProcessing.moveToThread(&postProcessingThread);
-    QObject::connect(&dsoControl, &HantekDsoControl::samplesAvailable, &postProcessing, &PostProcessing::input);
+    if (!processingScheduling.isDefault()) // direct, runs in the started thread
+        QObject::connect(&postProcessingThread, &QThread::started, [&processingScheduling]() {
+            QString message;
+            if (processingScheduling.apply(message))
+                qDebug() << "Post processing thread:" << message;
+            else
+                qWarning() << "Post processing thread:" << message;
+        });
+    QObject::connect(&group, &ScopeGroup::samplesAvailable, &postProcessing, &PostProcessing::input);
+    QObject::connect(&postProcessing, &PostProcessing::processingFinished, &group,
+                     [&group]() { group.samplesProcessed(); }, Qt::DirectConnection);
     QObject::connect(&postProcessing, &PostProcessing::processingFinished, &exportRegistry, &ExporterRegistry::input,
                      Qt::DirectConnection);
 
     //////// Create main window ////////
     iconFont->initFontAwesome();
-    MainWindow openHantekMainWindow(&dsoControl, &settings, &exportRegistry);
+    MainWindow openHantekMainWindow(&group, &settings, &exportRegistry);
     QObject::connect(&postProcessing, &PostProcessing::processingFinished, &openHantekMainWindow,
                      &MainWindow::showNewData);
     QObject::connect(&exportRegistry, &ExporterRegistry::exporterProgressChanged, &openHantekMainWindow,
@@ -203,29 +377,51 @@ int main(int argc, char *argv[]) {
                      &MainWindow::exporterStatusChanged);
     openHantekMainWindow.show();
 
-    applySettingsToDevice(&dsoControl, &settings.scope, device->getModel()->spec());
+    for (unsigned index = 0; index < controls.size(); ++index) {
+        HantekDsoControl *control = controls[index];
+        applySettingsToDevice(control, &settings.scope, &group, index);
+        // the acquisition loop has ended, the settings that were changed in the meantime are sent again;
+        // they are copied here in the GUI thread that owns them and applied in the thread of the control
+        QObject::connect(control, &HantekDsoControl::deviceReconnected, QCoreApplication::instance(),
+                         [control, index, &settings, &group]() {
+                             DsoSettingsScope scope = settings.scope;
+                             QTimer::singleShot(0, control, [control, index, scope, &group]() mutable {
+                                 applySettingsToDevice(control, &scope, &group, index);
+                                 QMetaObject::invokeMethod(control, "run", Qt::QueuedConnection);
+                             });
+                         });
+    }
 
-    //////// Start DSO thread and go into GUI main loop
-    dsoControl.enableSampling(true);
+    //////// Start DSO threads and go into GUI main loop
+    for (HantekDsoControl *control : controls)
+        control->enableSampling(true);
     postProcessingThread.start();
-    dsoControlThread.start();
+    for (std::unique_ptr<QThread> &dsoControlThread : dsoControlThreads)
+        dsoControlThread->start();
+    hotplugWatcher.watch(false); // the selected devices are already there
     int res = openHantekApplication.exec();
 
     //////// Clean up ////////
+    hotplugWatcher.stop();
 
     // wait 2 * record time (delay is ms) for dso to finish
     unsigned waitForDso = 2000 * dsoControl.getSamplesize() / dsoControl.getSamplerate();
     if ( waitForDso < 10000 ) // minimum 10 s
         waitForDso = 10000;
-    dsoControlThread.quit();
-    dsoControlThread.wait( waitForDso );
+    for (std::unique_ptr<QThread> &dsoControlThread : dsoControlThreads) {
+        dsoControlThread->requestInterruption(); // leave the acquisition loop
+        dsoControlThread->quit();
+    }
+    for (std::unique_ptr<QThread> &dsoControlThread : dsoControlThreads)
+        dsoControlThread->wait( waitForDso );
 
     postProcessingThread.quit();
     postProcessingThread.wait(10000);
 
-    if (context && device != nullptr) { 
-        device.reset(); // causes libusb_close(), which must be called before libusb_exit() 
-        libusb_exit(context); 
+    if (context && !devices.empty()) {
+        dsoControls.clear();
+        devices.clear(); // causes libusb_close(), which must be called before libusb_exit()
+        libusb_exit(context);
     }
 
     return res;
@@ -15,21 +15,26 @@
 #include "exporting/exporterinterface.h"
 #include "exporting/exporterregistry.h"
 #include "hantekdsocontrol.h"
+#include "scopegroup.h"
 #include "usb/usbdevice.h"
 #include "viewconstants.h"
 
 #include "settings.h"
 
 #include <QFileDialog>
+#include <QLabel>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QDesktopServices>
 
 #include "OH_VERSION.h"
 
-MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, ExporterRegistry *exporterRegistry,
+MainWindow::MainWindow(ScopeGroup *group, DsoSettings *settings, ExporterRegistry *exporterRegistry,
                        QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow), mSettings(settings), exporterRegistry(exporterRegistry) {
+    // the first device paces the group, the global settings are sent to all devices
+    HantekDsoControl *dsoControl = group->control(0);
+    const std::vector<HantekDsoControl *> &controls = group->controls();
     ui->setupUi(this);
     ui->actionAbout->setIcon(iconFont->icon(fa::questioncircle));
     ui->actionUserManual->setIcon(iconFont->icon(fa::filepdfo));
@@ -50,7 +55,8 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     setWindowTitle(
         tr("OpenHantek6022 (%1) - Device %2 (FW%3)") //" - Renderer %4")
             .arg(QString::fromStdString( VERSION))
-            .arg(QString::fromStdString(dsoControl->getDevice()->getModel()->name))
+            .arg(QString::fromStdString(dsoControl->getDevice()->getModel()->name) +
+                 (controls.size() > 1 ? QString(" x%1").arg(controls.size()) : QString()))
             .arg((unsigned int)dsoControl->getDevice()->getFwVersion(),4,16,QChar('0'))
     );
 
@@ -69,7 +75,7 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     }
 
     DsoSettingsScope *scope = &(mSettings->scope);
-    const Dso::ControlSpecification *spec = dsoControl->getDevice()->getModel()->spec();
+    const Dso::ControlSpecification *spec = group->spec();
 
     registerDockMetaTypes();
 
@@ -94,6 +100,7 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
 
     // Central oszilloscope widget
     dsoWidget = new DsoWidget(&mSettings->scope, &mSettings->view, spec);
+    dsoWidget->setFrameCounters(&dsoControl->frameCounters());
     setCentralWidget(dsoWidget);
 
     // Command field inside the status bar
@@ -102,6 +109,42 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
 
     statusBar()->addPermanentWidget(commandEdit, 1);
 
+    // Achieved acquisition rate inside the status bar
+    QLabel *acquisitionRateLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(acquisitionRateLabel);
+    // the frames of every device, the processed and rendered ones are counted by the first device
+    auto frameReport = [controls]() {
+        if (controls.size() == 1)
+            return controls.front()->frameCounters().toString();
+        QStringList lines;
+        for (unsigned device = 0; device < controls.size(); ++device)
+            lines << tr("Device %1: %2").arg(device + 1).arg(controls[device]->frameCounters().toString());
+        return lines.join("\n");
+    };
+    connect(dsoControl, &HantekDsoControl::acquisitionRateChanged, [acquisitionRateLabel, frameReport](double rate) {
+        acquisitionRateLabel->setText(tr("%1 acq/s").arg(rate, 0, 'f', rate < 10 ? 1 : 0));
+        acquisitionRateLabel->setToolTip(frameReport());
+    });
+    // emitted after acquisitionRateChanged with --latencyWatchdog
+    connect(dsoControl, &HantekDsoControl::schedulingLatencyChanged,
+            [acquisitionRateLabel, frameReport](const QString &report) {
+                acquisitionRateLabel->setToolTip(frameReport() + "\n" + report);
+            });
+    // Shown trigger windows, more than the acquisitions with the fast acquisition
+    QLabel *waveformRateLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(waveformRateLabel);
+    connect(dsoControl, &HantekDsoControl::waveformRateChanged, [waveformRateLabel](double rate) {
+        waveformRateLabel->setText(tr("%1 wfm/s").arg(rate, 0, 'f', rate < 10 ? 1 : 0));
+    });
+    // USB throughput of the first device, the tooltip shows its transfer statistics
+    QLabel *transferRateLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(transferRateLabel);
+    const USBDevice *device = dsoControl->getDevice();
+    connect(dsoControl, &HantekDsoControl::transferRateChanged, [transferRateLabel, device](double rate) {
+        transferRateLabel->setText(tr("%1 MB/s").arg(rate / 1e6, 0, 'f', 1));
+        transferRateLabel->setToolTip(device->getStatistics().toString());
+    });
+
     connect(ui->actionManualCommand, &QAction::toggled, [this, commandEdit](bool checked) {
         commandEdit->setVisible(checked);
         if (checked)
@@ -117,18 +160,30 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     });
 
     // Connect general signals
-    connect(dsoControl, &HantekDsoControl::statusMessage, statusBar(), &QStatusBar::showMessage);
+    for (HantekDsoControl *control : controls)
+        connect(control, &HantekDsoControl::statusMessage, statusBar(), &QStatusBar::showMessage);
 
     // Connect signals to DSO controller and widget
-    connect(horizontalDock, &HorizontalDock::samplerateChanged, [dsoControl, this]() {
-        dsoControl->setSamplerate(mSettings->scope.horizontal.samplerate);
+    connect(horizontalDock, &HorizontalDock::samplerateChanged, [controls, this]() {
+        for (HantekDsoControl *control : controls)
+            control->setSamplerate(mSettings->scope.horizontal.samplerate);
         this->dsoWidget->updateSamplerate(mSettings->scope.horizontal.samplerate);
     });
-    connect(horizontalDock, &HorizontalDock::timebaseChanged, [dsoControl, this]() {
-        dsoControl->setRecordTime(mSettings->scope.horizontal.timebase * DIVS_TIME);
+    connect(horizontalDock, &HorizontalDock::timebaseChanged, [controls, this]() {
+        for (HantekDsoControl *control : controls)
+            control->setRecordTime(mSettings->scope.horizontal.timebase * DIVS_TIME);
         this->dsoWidget->updateTimebase(mSettings->scope.horizontal.timebase);
     });
     connect(horizontalDock, &HorizontalDock::frequencybaseChanged, dsoWidget, &DsoWidget::updateFrequencybase);
+    for (HantekDsoControl *control : controls) {
+        connect(horizontalDock, &HorizontalDock::recordLengthChanged, control, &HantekDsoControl::setRecordLength);
+        connect(horizontalDock, &HorizontalDock::peakDetectChanged, control, &HantekDsoControl::setPeakDetect);
+        connect(horizontalDock, &HorizontalDock::segmentsChanged, control, &HantekDsoControl::setSegmentedCapture);
+        connect(horizontalDock, &HorizontalDock::segmentViewChanged, control, &HantekDsoControl::setSegmentView);
+        connect(horizontalDock, &HorizontalDock::historyChanged, control, &HantekDsoControl::replayHistory);
+        connect(horizontalDock, &HorizontalDock::etsChanged, control, &HantekDsoControl::setEtsFactor);
+        connect(horizontalDock, &HorizontalDock::averagingChanged, control, &HantekDsoControl::setAveraging);
+    }
     connect(dsoControl, &HantekDsoControl::samplerateChanged, [this, horizontalDock](double samplerate) {
         // The timebase was set, let's adapt the samplerate accordingly
         //printf( "main::samplerateChanged( %g )\n", samplerate );
@@ -136,20 +191,39 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
         horizontalDock->setSamplerate(samplerate);
         dsoWidget->updateSamplerate(samplerate);
     });
-    connect(horizontalDock, &HorizontalDock::calfreqChanged, [dsoControl, this]() {
-        dsoControl->setCalFreq(mSettings->scope.horizontal.calfreq);
+    connect(horizontalDock, &HorizontalDock::calfreqChanged, [controls, this]() {
+        for (HantekDsoControl *control : controls)
+            control->setCalFreq(mSettings->scope.horizontal.calfreq);
     });
 
-    connect(triggerDock, &TriggerDock::modeChanged, dsoControl, &HantekDsoControl::setTriggerMode);
+    for (HantekDsoControl *control : controls) {
+        connect(triggerDock, &TriggerDock::modeChanged, control, &HantekDsoControl::setTriggerMode);
+        connect(triggerDock, &TriggerDock::slopeChanged, control, &HantekDsoControl::setTriggerSlope);
+        connect(triggerDock, &TriggerDock::typeChanged, control, &HantekDsoControl::setTriggerType);
+        connect(triggerDock, &TriggerDock::conditionChanged, control, &HantekDsoControl::setTriggerCondition);
+        connect(triggerDock, &TriggerDock::secondLevelChanged, control, &HantekDsoControl::setTriggerSecondLevel);
+        connect(triggerDock, &TriggerDock::fastAcquisitionChanged, control, &HantekDsoControl::setFastAcquisition);
+        connect(dsoWidget, &DsoWidget::triggerPositionChanged, control, &HantekDsoControl::setTriggerPosition);
+    }
     connect(triggerDock, &TriggerDock::modeChanged, dsoWidget, &DsoWidget::updateTriggerMode);
-    connect(triggerDock, &TriggerDock::sourceChanged, dsoControl, &HantekDsoControl::setTriggerSource);
+    // every device triggers on its own input of the trigger channel, they all carry the reference signal,
+    // with the level of the trigger channel
+    connect(triggerDock, &TriggerDock::sourceChanged, [this, group](unsigned int id, bool smooth) {
+        for (HantekDsoControl *control : group->controls()) {
+            control->setTriggerSource(group->localChannel(id), smooth);
+            control->setTriggerLevel(group->localChannel(id), mSettings->scope.voltage[id].trigger);
+        }
+    });
     connect(triggerDock, &TriggerDock::sourceChanged, dsoWidget, &DsoWidget::updateTriggerSource);
-    connect(triggerDock, &TriggerDock::slopeChanged, dsoControl, &HantekDsoControl::setTriggerSlope);
     connect(triggerDock, &TriggerDock::slopeChanged, dsoWidget, &DsoWidget::updateTriggerSlope);
-    connect(dsoWidget, &DsoWidget::triggerPositionChanged, dsoControl, &HantekDsoControl::setTriggerPosition);
-    connect(dsoWidget, &DsoWidget::triggerLevelChanged, dsoControl, &HantekDsoControl::setTriggerLevel);
+    connect(dsoWidget, &DsoWidget::triggerLevelChanged, [this, group](ChannelID channel, double level) {
+        if (channel != mSettings->scope.trigger.source) // the other levels are sent with a change of the source
+            return;
+        for (HantekDsoControl *control : group->controls())
+            control->setTriggerLevel(group->localChannel(channel), level);
+    });
 
-    auto usedChanged = [this, dsoControl, spec](ChannelID channel) {
+    auto usedChanged = [this, group, spec](ChannelID channel) {
         if (channel >= (unsigned int)mSettings->scope.voltage.size())
             return;
 
@@ -157,37 +231,38 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
 
         // Normal channel, check if voltage/spectrum or math channel is used
         if (channel < spec->channels)
-            dsoControl->setChannelUsed(channel, mathUsed | mSettings->scope.anyUsed(channel));
+            group->control(channel)->setChannelUsed(group->localChannel(channel),
+                                                    mathUsed | mSettings->scope.anyUsed(channel));
         // Math channel, update all channels
         else if (channel == spec->channels) {
             for (ChannelID c = 0; c < spec->channels; ++c)
-                dsoControl->setChannelUsed(c, mathUsed | mSettings->scope.anyUsed(c));
+                group->control(c)->setChannelUsed(group->localChannel(c), mathUsed | mSettings->scope.anyUsed(c));
         }
     };
     connect(voltageDock, &VoltageDock::usedChanged, usedChanged);
     connect(spectrumDock, &SpectrumDock::usedChanged, usedChanged);
 
     connect(voltageDock, &VoltageDock::modeChanged, dsoWidget, &DsoWidget::updateMathMode);
-    connect(voltageDock, &VoltageDock::gainChanged, [this, dsoControl, spec](ChannelID channel ) {
+    connect(voltageDock, &VoltageDock::gainChanged, [this, group, spec](ChannelID channel ) {
         if (channel >= spec->channels)
             return;
-        dsoControl->setGain(channel, mSettings->scope.gain(channel) * DIVS_VOLTAGE);
+        group->control(channel)->setGain(group->localChannel(channel), mSettings->scope.gain(channel) * DIVS_VOLTAGE);
     });
-    connect(voltageDock, &VoltageDock::probeAttnChanged, [this, dsoControl, spec](ChannelID channel, bool probeUsed, double probeAttn ) {
+    connect(voltageDock, &VoltageDock::probeAttnChanged, [group, spec](ChannelID channel, bool probeUsed, double probeAttn ) {
         if (channel >= spec->channels)
             return;
-        dsoControl->setProbe( channel, probeUsed, probeAttn );
+        group->control(channel)->setProbe( group->localChannel(channel), probeUsed, probeAttn );
     });
-    connect(voltageDock, &VoltageDock::invertedChanged, [this, dsoControl, spec](ChannelID channel, bool inverted) {
+    connect(voltageDock, &VoltageDock::invertedChanged, [group, spec](ChannelID channel, bool inverted) {
         if (channel >= spec->channels)
             return;
-        dsoControl->setChannelInverted( channel, inverted );
+        group->control(channel)->setChannelInverted( group->localChannel(channel), inverted );
     });
     connect(voltageDock, &VoltageDock::couplingChanged, dsoWidget, &DsoWidget::updateVoltageCoupling);
-    connect(voltageDock, &VoltageDock::couplingChanged, [this, dsoControl, spec](ChannelID channel, Dso::Coupling coupling ) {
+    connect(voltageDock, &VoltageDock::couplingChanged, [group, spec](ChannelID channel, Dso::Coupling coupling ) {
         if (channel >= spec->channels)
             return;
-        dsoControl->setCoupling( channel, coupling );
+        group->control(channel)->setCoupling( group->localChannel(channel), coupling );
     });
     connect(voltageDock, &VoltageDock::gainChanged, dsoWidget, &DsoWidget::updateVoltageGain);
     connect(voltageDock, &VoltageDock::usedChanged, dsoWidget, &DsoWidget::updateVoltageUsed);
@@ -195,9 +270,10 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
     connect(spectrumDock, &SpectrumDock::magnitudeChanged, dsoWidget, &DsoWidget::updateSpectrumMagnitude);
 
     // Started/stopped signals from oscilloscope
-    connect(dsoControl, &HantekDsoControl::samplingStatusChanged, [this, dsoControl](bool enabled) {
+    connect(dsoControl, &HantekDsoControl::samplingStatusChanged, [this, horizontalDock](bool enabled) {
         QSignalBlocker blocker(this->ui->actionSampling);
         if (enabled) {
+            horizontalDock->setHistory(0); // live acquisition
             this->ui->actionSampling->setText(tr("Stop"));
             this->ui->actionSampling->setStatusTip(tr("Stop the oscilloscope"));
         } else {
@@ -206,7 +282,8 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
         }
         this->ui->actionSampling->setChecked(enabled);
     });
-    connect(this->ui->actionSampling, &QAction::triggered, dsoControl, &HantekDsoControl::enableSampling);
+    for (HantekDsoControl *control : controls)
+        connect(this->ui->actionSampling, &QAction::triggered, control, &HantekDsoControl::enableSampling);
     this->ui->actionSampling->setChecked(dsoControl->isSampling());
 
     connect(dsoControl, &HantekDsoControl::samplerateLimitsChanged, horizontalDock,
@@ -238,12 +315,17 @@ MainWindow::MainWindow(HantekDsoControl *dsoControl, DsoSettings *settings, Expo
 
     connect(ui->actionExit, &QAction::triggered, this, &QWidget::close);
 
-    connect(ui->actionSettings, &QAction::triggered, [this]() {
+    connect(ui->actionSettings, &QAction::triggered, [this, controls]() {
         mSettings->mainWindowGeometry = saveGeometry();
         mSettings->mainWindowState = saveState();
 
         DsoConfigDialog *configDialog = new DsoConfigDialog(this->mSettings, this);
         configDialog->setModal(true);
+        // the history memory is exchanged in the thread of the acquisition
+        for (HantekDsoControl *control : controls)
+            connect(configDialog, &QDialog::accepted, control, [this, control]() {
+                control->setHistoryMemory(mSettings->scope.horizontal.historyMemory);
+            });
         configDialog->show();
     });
 
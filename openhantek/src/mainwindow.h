@@ -4,7 +4,7 @@
 #include <memory>
 
 class SpectrumGenerator;
-class HantekDsoControl;
+class ScopeGroup;
 class DsoSettings;
 class ExporterRegistry;
 class DsoWidget;
@@ -24,7 +24,7 @@ class MainWindow : public QMainWindow {
     Q_OBJECT
 
   public:
-    explicit MainWindow(HantekDsoControl *dsoControl, DsoSettings *mSettings, ExporterRegistry *exporterRegistry,
+    explicit MainWindow(ScopeGroup *group, DsoSettings *mSettings, ExporterRegistry *exporterRegistry,
                         QWidget *parent = 0);
     ~MainWindow();
   public slots:
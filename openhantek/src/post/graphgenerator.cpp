@@ -2,6 +2,7 @@
 
 #include <QDebug>
 #include <QMutex>
+#include <algorithm>
 #include <exception>
 #include <math.h>
 
@@ -74,7 +75,8 @@ void GraphGenerator::generateGraphsTYvoltage(PPresult *result, const DsoSettings
         const SampleValues &samples = useVoltSamplesOf(channel, result, scope);
 
         // Check if this channel is used and available at the data analyzer
-        if (samples.sample.empty()) {
+        // a short roll or segment view may have no samples after the skipped ones
+        if (samples.sample.empty() || skipSamples >= samples.sample.size()) {
             // Delete all vector arrays
             target.clear();
             continue;
@@ -83,11 +85,13 @@ void GraphGenerator::generateGraphsTYvoltage(PPresult *result, const DsoSettings
         // time distance between sampling points
         float horizontalFactor = (float)(samples.interval / scope->horizontal.timebase);
         // printf( "hF: %g\n", horizontalFactor );
+        // the trigger crossing lies between two samples, move it to the same place on the screen in every frame
+        const float xStart = MARGIN_LEFT - float( result->triggerFraction ) * horizontalFactor;
 
         // round up and add one dot (n+1 dots to display n lines) 
         unsigned dotsOnScreen = DIVS_TIME / horizontalFactor + 0.99 + 1;
         // Set size directly to avoid reallocations
-        target.reserve( dotsOnScreen );
+        target.reserve( std::min( dotsOnScreen, 2 * maxColumns ) );
 
         const float gain = (float)scope->gain(channel);
         const float offset = (float)scope->voltage[channel].offset;
@@ -96,6 +100,7 @@ void GraphGenerator::generateGraphsTYvoltage(PPresult *result, const DsoSettings
 
         // sinc interpolation in case of too less samples on screen
         // https://ccrma.stanford.edu/~jos/resample/resample.pdf
+        std::vector <float> resample; // must outlive sampleIterator
         if ( view->interpolation == Dso::INTERPOLATION_SINC
             && dotsOnScreen < 100 ) { // valid for timebase <= 500 ns/div
             const unsigned int sincSize = sinc.size();
@@ -104,32 +109,62 @@ void GraphGenerator::generateGraphsTYvoltage(PPresult *result, const DsoSettings
             // we would need sincWidth on left side, but we take what we get
             const unsigned int left = std::min( sincWidth, skip );
             const unsigned int resampleSize = (left + dotsOnScreen + sincWidth) * oversample;
-            std::vector <double> resample;
-            resample.resize( resampleSize ); // prefilled with zero
+            std::vector <double> sum( resampleSize ); // prefilled with zero, accumulated with double precision
             horizontalFactor /= oversample; // distance between (resampled) dots
             dotsOnScreen = DIVS_TIME / horizontalFactor + 0.99 + 1; // dot count after resample
             target.reserve( dotsOnScreen ); // increase target size
             // sampleIt -> start of left margin
             auto sampleIt = samples.sample.cbegin() + skip - left;
             for ( unsigned int resamplePos = 0; resamplePos < resampleSize; resamplePos += oversample, ++sampleIt ) {
-                resample[ resamplePos ] += *sampleIt; //  * sinc( 0 )
+                sum[ resamplePos ] += *sampleIt; //  * sinc( 0 )
                 auto sincIt = sinc.cbegin(); // one half of sinc pulse without sinc(0) 
                 for ( unsigned int sincPos = 1; sincPos <= sincSize; ++sincPos, ++sincIt ) { // sinc( 1..n )
                     const double conv = *sampleIt * *sincIt;
                     if ( resamplePos >= sincPos ) // left half of sinc in visible range
-                        resample[ resamplePos - sincPos ] += conv;
+                        sum[ resamplePos - sincPos ] += conv;
                     if ( resamplePos + sincPos < resampleSize ) // right half of sinc visible
-                        resample[ resamplePos + sincPos ] += conv;
+                        sum[ resamplePos + sincPos ] += conv;
                 }
             }
+            resample.assign( sum.cbegin(), sum.cend() );
             sampleIterator = resample.cbegin() + ( left + 0.5 ) * oversample; // -> visible resamples
-        }
+        } else if ( dotsOnScreen > samples.sample.size() - skipSamples ) // avoid sample[] overrun
+            dotsOnScreen = samples.sample.size() - skipSamples;
         // printf("dotsOnScreen: %d\n", dotsOnScreen);
-        if ( dotsOnScreen > SAMPLESIZE_USED / 2 + 1) // avoid target[] overrun
-            dotsOnScreen = SAMPLESIZE_USED / 2 + 1;  // typical 10001, defined in viewconstants.h
         target.clear(); // remove all previous dots and fill in new trace
+        // peak detect envelope, drawn as vertical line from min to max for each sample
+        const DataChannel *channelData = result->data( channel );
+        if ( resample.empty() && channelData->peakMin.size() == samples.sample.size() ) {
+            auto minIterator = channelData->peakMin.cbegin() + skipSamples;
+            auto maxIterator = channelData->peakMax.cbegin() + skipSamples;
+            const unsigned columns = std::min( dotsOnScreen, maxColumns );
+            for ( unsigned column = 0; column < columns; ++column ) {
+                const unsigned first = unsigned( (unsigned long long)dotsOnScreen * column / columns );
+                const unsigned last = unsigned( (unsigned long long)dotsOnScreen * ( column + 1 ) / columns );
+                const double low = *std::min_element( minIterator + first, minIterator + last );
+                const double high = *std::max_element( maxIterator + first, maxIterator + last );
+                const float x = xStart + first * horizontalFactor;
+                target.push_back( QVector3D( x, low / gain + offset, 0.0 ) );
+                target.push_back( QVector3D( x, high / gain + offset, 0.0 ) );
+            }
+            continue;
+        }
+        if ( dotsOnScreen > 2 * maxColumns ) {
+            // long record, draw min and max of each column to keep the drawing fast without losing peaks
+            for ( unsigned column = 0; column < maxColumns; ++column ) {
+                const unsigned first = unsigned( (unsigned long long)dotsOnScreen * column / maxColumns );
+                const unsigned last = unsigned( (unsigned long long)dotsOnScreen * ( column + 1 ) / maxColumns );
+                auto minMax = std::minmax_element( sampleIterator + first, sampleIterator + last );
+                auto left = std::min( minMax.first, minMax.second ); // keep the order of the extrema
+                auto right = std::max( minMax.first, minMax.second );
+                const float x = xStart + first * horizontalFactor;
+                target.push_back( QVector3D( x, *left / gain + offset, 0.0 ) );
+                target.push_back( QVector3D( x, *right / gain + offset, 0.0 ) );
+            }
+            continue;
+        }
         for (unsigned int position = 0; position < dotsOnScreen; ++position) {
-            target.push_back(QVector3D(MARGIN_LEFT + position * horizontalFactor,
+            target.push_back(QVector3D(xStart + position * horizontalFactor,
                                         *sampleIterator++ / gain + offset, 0.0 ));
         }
     }
@@ -161,7 +196,7 @@ void GraphGenerator::generateGraphsTYspectrum(PPresult *result) {
         float horizontalFactor = (float)(samples.interval / scope->horizontal.frequencybase);
 
         // Fill vector array
-        std::vector<double>::const_iterator dataIterator = samples.sample.begin();
+        std::vector<float>::const_iterator dataIterator = samples.sample.begin();
         const float magnitude = (float)scope->spectrum[channel].magnitude;
         const float offset = (float)scope->spectrum[channel].offset;
 
@@ -206,8 +241,8 @@ void GraphGenerator::generateGraphsXY(PPresult *result, const DsoSettingsScope *
         drawLines.reserve(sampleCount * 2);
 
         // Fill vector array
-        std::vector<double>::const_iterator xIterator = xSamples.sample.begin();
-        std::vector<double>::const_iterator yIterator = ySamples.sample.begin();
+        std::vector<float>::const_iterator xIterator = xSamples.sample.begin();
+        std::vector<float>::const_iterator yIterator = ySamples.sample.begin();
         const double xGain = scope->gain(xChannel);
         const double yGain = scope->gain(yChannel);
         const double xOffset = scope->voltage[xChannel].offset;
@@ -39,6 +39,7 @@ class GraphGenerator : public QObject, public Processor {
     const unsigned int sincWidth = 5;
     const unsigned int oversample = 10;
     const unsigned int sincSize = sincWidth * oversample;
+    const unsigned int maxColumns = 5000; ///< Long records are drawn as min/max pairs of this many columns
 
     // Processor interface
     void process(PPresult *data) override;
@@ -17,7 +17,7 @@ void MathChannelGenerator::process(PPresult *result) {
         return;
 
     DataChannel *const channelData = result->modifyData(physicalChannels);
-    std::vector<double> &resultData = channelData->voltage.sample;
+    std::vector<float> &resultData = channelData->voltage.sample;
 
     unsigned src = 0;
     const double sign = scope->voltage[physicalChannels].inverted ? -1.0 : 1.0;
@@ -30,8 +30,8 @@ void MathChannelGenerator::process(PPresult *result) {
         // Set sampling interval
         channelData->voltage.interval = result->data(0)->voltage.interval;
         // Calculate values and write them into the sample buffer
-        std::vector<double>::const_iterator ch1Iterator = result->data(0)->voltage.sample.begin();
-        std::vector<double>::const_iterator ch2Iterator = result->data(1)->voltage.sample.begin();
+        std::vector<float>::const_iterator ch1Iterator = result->data(0)->voltage.sample.begin();
+        std::vector<float>::const_iterator ch2Iterator = result->data(1)->voltage.sample.begin();
         double (*calculate)( double, double );
 
         switch (Dso::getMathMode(scope->voltage[physicalChannels])) {
@@ -53,7 +53,7 @@ void MathChannelGenerator::process(PPresult *result) {
                 break;
         }
         for (auto it = resultData.begin(), end = resultData.end(); it != end; ++it) {
-            *it = sign * calculate( *ch1Iterator++, *ch2Iterator++ );
+            *it = float( sign * calculate( *ch1Iterator++, *ch2Iterator++ ) );
         }
     } else { // unary operators (calculate "AC coupling")
         if ( Dso::getMathMode( scope->voltage[physicalChannels] ) == Dso::MathMode::AC_CH1 )
@@ -79,7 +79,7 @@ void MathChannelGenerator::process(PPresult *result) {
         auto srcIt = result->data( src )->voltage.sample.begin();
         for ( auto dstIt = resultData.begin(), dstEnd = resultData.end(); 
               dstIt != dstEnd; ++srcIt, ++dstIt ) {
-            *dstIt = sign * ( *srcIt - average );
+            *dstIt = float( sign * ( *srcIt - average ) );
         }
     }
 }
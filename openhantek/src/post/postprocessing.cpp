@@ -1,6 +1,7 @@
 #include "postprocessing.h"
 
-PostProcessing::PostProcessing(unsigned channelCount) : channelCount(channelCount) {
+PostProcessing::PostProcessing(unsigned channelCount, Dso::FrameCounters *frameCounters)
+    : channelCount(channelCount), frameCounters(frameCounters) {
     qRegisterMetaType<std::shared_ptr<PPresult>>();
 }
 
@@ -9,25 +10,39 @@ void PostProcessing::registerProcessor(Processor *processor) { processors.push_b
 void PostProcessing::convertData(const DSOsamples *source, PPresult *destination) {
     //printf( "PostProcessing::convertData()\n" );
     QReadLocker locker(&source->lock);
+    destination->timing = source->timing;
+    destination->etsCoverage = source->etsCoverage;
+    destination->averagedFrames = source->averagedFrames;
     if ( source->triggerPosition ) {
         destination->softwareTriggerTriggered = source->liveTrigger;
         destination->skipSamples = source->triggerPosition;
+        destination->triggerFraction = source->triggerFraction;
         destination->pulseWidth = source->pulseWidth;
+        destination->triggerEvents = source->triggerEvents;
+        destination->pulseWidthMin = source->pulseWidthMin;
+        destination->pulseWidthMax = source->pulseWidthMax;
     } else {
         destination->softwareTriggerTriggered = false;
         destination->skipSamples = 0;
+        destination->triggerFraction = 0;
         destination->pulseWidth = 0;
+        destination->triggerEvents = 0;
+        destination->pulseWidthMin = destination->pulseWidthMax = 0;
     }
 
     for (ChannelID channel = 0; channel < source->data.size(); ++channel) {
-        const std::vector<double> &rawChannelData = source->data.at(channel);
+        const std::vector<float> &rawChannelData = source->data.at(channel);
 
         if (rawChannelData.empty()) { continue; }
         DataChannel *const channelData = destination->modifyData(channel);
         channelData->voltage.interval = 1.0 / source->samplerate;
         channelData->voltage.sample = rawChannelData;
+        if (channel < source->peakMin.size() && source->peakMin[channel].size() == rawChannelData.size()) {
+            channelData->peakMin = source->peakMin[channel];
+            channelData->peakMax = source->peakMax[channel];
+        }
         //printf( "PP CH%d: %d\n", channel+1, source->clipped );
-        channelData->valid = ! ( source->clipped & (0x01 << channel) );
+        channelData->valid = ! ( source->clipped & (0x01 << channel) ) && ! source->corrupted;
     }
 }
 
@@ -35,6 +50,11 @@ void PostProcessing::input(const DSOsamples *data) {
     //printf( "PostProcessing::input()\n" );
     currentData.reset(new PPresult(channelCount));
     convertData(data, currentData.get());
+    currentData->processed = Dso::monotonicTime();
+    if (currentData->timing.sequence != lastSequence) {
+        lastSequence = currentData->timing.sequence;
+        frameCounters->processed.fetchAndAddRelaxed(1);
+    }
     for (Processor *p : processors) 
         p->process(currentData.get());
     std::shared_ptr<PPresult> res = std::move(currentData);
@@ -21,7 +21,8 @@ class PostProcessing : public QObject {
     Q_OBJECT
 
   public:
-    PostProcessing(unsigned channelCount);
+    /// \param frameCounters The processed frames are counted here, in the counters of the device that paces.
+    PostProcessing(unsigned channelCount, Dso::FrameCounters *frameCounters);
     /**
      * Adds a new processor that is called when a new input arrived. The order of the processors is
      * imporant. The first added processor will be called first. This class does not take ownership
@@ -38,6 +39,8 @@ class PostProcessing : public QObject {
     std::vector<Processor *> processors;
     ///
     std::unique_ptr<PPresult> currentData;
+    Dso::FrameCounters *frameCounters;
+    unsigned long long lastSequence = 0; ///< The last processed frame, a replayed frame is not counted
     static void convertData(const DSOsamples *source, PPresult *destination);
 
   public slots:
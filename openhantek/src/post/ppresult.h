@@ -7,10 +7,13 @@
 
 #include <vector>
 #include "hantekprotocol/types.h"
+#include "hantekdso/framestatistics.h"
 
 /// \brief Struct for a array of sample values.
+/// The samples are single precision, the 8 bit ADC data needs no more. Sums over the samples,
+/// e.g. averages and rms values, are calculated with double precision.
 struct SampleValues {
-    std::vector<double> sample; ///< Vector holding the sampling data
+    std::vector<float> sample;  ///< Vector holding the sampling data
     double interval = 0.0;      ///< The interval between two sample values
 };
 
@@ -18,6 +21,8 @@ struct SampleValues {
 struct DataChannel {
     SampleValues voltage;   ///< The time-domain voltage levels (V)
     SampleValues spectrum;  ///< The frequency-domain power levels (dB)
+    std::vector<float> peakMin; ///< Peak detect envelope of the voltage samples, empty if off
+    std::vector<float> peakMax;
     bool valid = true;      ///< Not clipped, distorted, dropouts etc.
     double vpp = 0.0;       ///< The peak-to-peak voltage of the _displayed_ part of trace
     double rms = 0.0;       ///< The DC + AC rms value of the signal = sqrt( dc * dc + acc * ac )
@@ -50,7 +55,16 @@ class PPresult {
     bool softwareTriggerTriggered = false;
     /// skip samples at start of channel to get triggered tace on screen
     unsigned int skipSamples = 0;
+    /// the trigger crossing is this fraction of a sample interval later, the graph is shifted back by it
+    double triggerFraction = 0.0;
     double pulseWidth = 0.0;///< The width of the triggered pulse
+    unsigned triggerEvents = 0;  ///< Trigger events overlaid by the fast acquisition
+    double pulseWidthMin = 0.0;  ///< Shortest and longest pulse width of these events
+    double pulseWidthMax = 0.0;
+    double etsCoverage = 0.0;    ///< Part of the equivalent-time grid with samples, 0 = off
+    unsigned averagedFrames = 0; ///< Frames in the shown average, 0 = off
+    Dso::FrameTiming timing;///< Sequence number and timestamps of the acquired frame
+    qint64 processed = 0;   ///< Dso::monotonicTime() when the post processing started
 
     ChannelsGraphs vaChannelSpectrum;
     ChannelsGraphs vaChannelVoltage;
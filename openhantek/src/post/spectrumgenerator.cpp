@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0+
 
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
 
 #include <QColor>
@@ -22,7 +23,7 @@ SpectrumGenerator::SpectrumGenerator(const DsoSettingsScope *scope, const DsoSet
 
 
 SpectrumGenerator::~SpectrumGenerator() {
-    if (lastWindowBuffer) fftw_free(lastWindowBuffer);
+    if (lastWindowBuffer) fftwf_free(lastWindowBuffer);
 }
 
 
@@ -39,10 +40,12 @@ void SpectrumGenerator::process(PPresult *result) {
         }
         // Calculate new window
         // scale all windows to display 1 Veff as 0 dBu reference level.
-        size_t sampleCount = channelData->voltage.sample.size();
+        // long records are analyzed by their first part to keep the processing time low
+        const size_t recordLength = channelData->voltage.sample.size();
+        size_t sampleCount = std::min( recordLength, maxSpectrumLength );
         if (!lastWindowBuffer || lastWindow != postprocessing->spectrumWindow || lastRecordLength != sampleCount) {
-            if (lastWindowBuffer) fftw_free(lastWindowBuffer);
-            lastWindowBuffer = fftw_alloc_real(sampleCount);
+            if (lastWindowBuffer) fftwf_free(lastWindowBuffer);
+            lastWindowBuffer = fftwf_alloc_real(sampleCount);
             lastRecordLength = (unsigned)sampleCount;
 
             unsigned int windowEnd = lastRecordLength - 1;
@@ -165,14 +168,14 @@ void SpectrumGenerator::process(PPresult *result) {
         channelData->spectrum.sample.resize(sampleCount);
 
         // Create sample buffer and apply window
-        std::unique_ptr<double[]> windowedValues = std::unique_ptr<double[]>(new double[sampleCount]);
+        std::unique_ptr<float[]> windowedValues = std::unique_ptr<float[]>(new float[sampleCount]);
 
         // calculate the peak-to-peak value of the displayed part of trace
         double min = INT_MAX;
         double max = INT_MIN;
         unsigned right = result->skipSamples + DIVS_TIME * scope->horizontal.timebase / channelData->voltage.interval;
-        if ( right > sampleCount )
-            right = sampleCount;
+        if ( right > recordLength )
+            right = recordLength;
         for (unsigned int position = result->skipSamples; // left side of trace
              position < right; // right side
              ++position) {
@@ -199,7 +202,7 @@ void SpectrumGenerator::process(PPresult *result) {
         for (unsigned int position = 0; position < sampleCount; ++position) {
             double ac_sample = *voltageIterator++ - dc;
             ac2 += ac_sample * ac_sample;
-            windowedValues[position] = lastWindowBuffer[position] * ac_sample;
+            windowedValues[position] = float(lastWindowBuffer[position] * ac_sample);
         }
         ac2 /= sampleCount;
         channelData->ac = sqrt( ac2 ); // rms of AC component
@@ -211,11 +214,12 @@ void SpectrumGenerator::process(PPresult *result) {
         /// \todo Check if record length is multiple of 2
         /// \todo Reuse plan and use FFTW_MEASURE to get fastest algorithm
 
-        fftw_plan fftPlan;
-        fftPlan = fftw_plan_r2r_1d(sampleCount, windowedValues.get(),
+        // single precision is plenty for the 8 bit samples and twice as fast
+        fftwf_plan fftPlan;
+        fftPlan = fftwf_plan_r2r_1d(sampleCount, windowedValues.get(),
                                     &channelData->spectrum.sample.front(), FFTW_R2HC, FFTW_ESTIMATE);
-        fftw_execute(fftPlan);
-        fftw_destroy_plan(fftPlan);
+        fftwf_execute(fftPlan);
+        fftwf_destroy_plan(fftPlan);
 
         // Do an autocorrelation to get the frequency of the signal
         // fft: f(t) ⊶ F(ω); calculate power spectrum |F(ω)|²
@@ -228,8 +232,8 @@ void SpectrumGenerator::process(PPresult *result) {
         // in these cases use spectrum instead if peak position is too small.
 
         // create a copy of powerSpectrum because hc2r iDFT destroys spectrum input
-        const double norm = 1.0 / dftLength / dftLength;
-        std::unique_ptr<double[]> powerSpectrum = std::move(windowedValues);
+        const float norm = 1.0f / dftLength / dftLength;
+        std::unique_ptr<float[]> powerSpectrum = std::move(windowedValues);
 
         unsigned int position;
         // correct the (half-)complex values in spectrum (1st part real forward), (2nd part imag backwards) -> magnitude
@@ -256,10 +260,10 @@ void SpectrumGenerator::process(PPresult *result) {
         channelData->spectrum.sample.resize( dftLength + 1 );
 
         // Do half-complex to real inverse transformation -> autocorrelation
-        std::unique_ptr<double[]> correlation = std::unique_ptr<double[]>(new double[sampleCount]);
-        fftPlan = fftw_plan_r2r_1d(sampleCount, powerSpectrum.get(), correlation.get(), FFTW_HC2R, FFTW_ESTIMATE);
-        fftw_execute(fftPlan);
-        fftw_destroy_plan(fftPlan);
+        std::unique_ptr<float[]> correlation = std::unique_ptr<float[]>(new float[sampleCount]);
+        fftPlan = fftwf_plan_r2r_1d(sampleCount, powerSpectrum.get(), correlation.get(), FFTW_HC2R, FFTW_ESTIMATE);
+        fftwf_execute(fftPlan);
+        fftwf_destroy_plan(fftPlan);
 
         // Get the frequency from the correlation results
         unsigned int peakCorrPos = 0;
@@ -298,7 +302,7 @@ void SpectrumGenerator::process(PPresult *result) {
             // Check if this value has to be limited
             if (value < offsetLimit)
                 value = offsetLimit;
-            *spectrumIterator = value;
+            *spectrumIterator = float(value);
             // detect frequency peak
             if ( value > peakSpectrum  ) {
                 peakSpectrum = value;
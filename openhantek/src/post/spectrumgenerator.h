@@ -31,7 +31,8 @@ class SpectrumGenerator : public Processor {
     const DsoSettingsPostProcessing* postprocessing;
     unsigned int lastRecordLength = 0;                        ///< The record length of the previously analyzed data
     Dso::WindowFunction lastWindow = (Dso::WindowFunction)-1; ///< The previously used dft window function
-    double *lastWindowBuffer = nullptr;
+    float *lastWindowBuffer = nullptr;
+    const size_t maxSpectrumLength = 1 << 18; ///< Longest record that is transformed
     // Processor interface
     void process(PPresult *data) override;
 };
@@ -29,7 +29,14 @@ struct DsoSettingsScopeHorizontal {
     double frequencybase = 1e3;                     ///< Frequencybase in Hz/div
     DsoSettingsScopeCursor cursor;
 
-    unsigned int recordLength = 0; ///< Sample count
+    unsigned int recordLength = RECORDLENGTH_DEFAULT; ///< Samples per channel of one acquisition
+    bool peakDetect = false;                          ///< Show the min/max envelope of each sample
+    unsigned segmentCount = 0;                        ///< Segments of a segmented acquisition, 0 = off
+    unsigned segmentLength = SEGMENT_LENGTH_DEFAULT;  ///< Samples per channel of one segment
+    unsigned historyMemory = HISTORY_MEMORY_DEFAULT;  ///< Memory of the acquisition history in MiB, 0 = off
+    unsigned etsFactor = 1;                           ///< Equivalent-time sampling bins per sample, 1 = off
+    Dso::AveragingMode averaging = Dso::AveragingMode::Off; ///< Averaging of the triggered frames
+    unsigned averageCount = 16;                       ///< Frames of the average
 
     /// TODO Use ControlSettingsSamplerateTarget
     double timebase = 1e-3;  ///< Timebase in s/div
@@ -45,6 +52,12 @@ struct DsoSettingsScopeTrigger {
     Dso::Slope slope = Dso::Slope::Positive;        ///< Rising or falling edge causes trigger
     unsigned int source = 0;                        ///< Channel that is used as trigger source
     bool smooth = false;                            ///< Don't trigger on glitches
+    Dso::TriggerType type = Dso::TriggerType::Edge; ///< Edge or an advanced trigger
+    Dso::TriggerCondition condition = Dso::TriggerCondition::Less; ///< Pulse width or window condition
+    double time = 1e-6;                             ///< Pulse width limit or timeout in s
+    double timeUpper = 2e-6;                        ///< Upper pulse width limit in s
+    double secondLevel = 0.0;                       ///< Other level of the runt and window band in V
+    bool fastAcquisition = false;                   ///< Overlay all trigger events of a block
 };
 
 /// \brief Base for DsoSettingsScopeSpectrum and DsoSettingsScopeVoltage
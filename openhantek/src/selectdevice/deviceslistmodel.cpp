@@ -63,22 +63,60 @@ void DevicesListModel::updateDeviceList()
     const FindDevices::DeviceList* devices = findDevices->getDevices();
     beginInsertRows(QModelIndex(),0,(int)devices->size());
     for (auto &i : *devices) {
-        DeviceListEntry entry;
-        entry.name = QString::fromStdString(i.second->getModel()->name);
-        entry.id = i.first;
-        if (i.second->needsFirmware()) {
-            UploadFirmware uf;
-            if (!uf.startUpload(i.second.get())) {
-                entry.errorMessage = uf.getErrorMessage();
-            }
-            entry.needFirmware = true;
-        } else if (i.second->connectDevice(entry.errorMessage)) {
-            entry.canConnect = true;
-            i.second->disconnectFromDevice();
-        } else {
-            entry.canConnect = false;
-        }
-        entries.push_back(entry);
+        entries.push_back(makeEntry(i.first, i.second.get()));
+    }
+    endInsertRows();
+}
+
+void DevicesListModel::deviceAdded(UniqueUSBid id)
+{
+    const FindDevices::DeviceList* devices = findDevices->getDevices();
+    FindDevices::DeviceList::const_iterator device = devices->find(id);
+    if (device == devices->end() || !device->second) return;
+    const int row = rowOf(id);
+    if (row >= 0) { // renumerated after the firmware upload
+        entries[(unsigned)row] = makeEntry(id, device->second.get());
+        emit dataChanged(index(row, 0), index(row, columnCount(QModelIndex()) - 1));
+        return;
     }
+    beginInsertRows(QModelIndex(), (int)entries.size(), (int)entries.size());
+    entries.push_back(makeEntry(id, device->second.get()));
     endInsertRows();
 }
+
+void DevicesListModel::deviceRemoved(UniqueUSBid id)
+{
+    const int row = rowOf(id);
+    if (row < 0) return;
+    beginRemoveRows(QModelIndex(), row, row);
+    entries.erase(entries.begin() + row);
+    endRemoveRows();
+}
+
+int DevicesListModel::rowOf(UniqueUSBid id) const
+{
+    for (unsigned row = 0; row < entries.size(); ++row) {
+        if (entries[row].id == id) return (int)row;
+    }
+    return -1;
+}
+
+DeviceListEntry DevicesListModel::makeEntry(UniqueUSBid id, USBDevice *device)
+{
+    DeviceListEntry entry;
+    entry.name = QString::fromStdString(device->getModel()->name);
+    entry.id = id;
+    entry.canConnect = false;
+    entry.needFirmware = false;
+    if (device->needsFirmware()) {
+        UploadFirmware uf;
+        if (!uf.startUpload(device)) {
+            entry.errorMessage = uf.getErrorMessage();
+        }
+        entry.needFirmware = true;
+    } else if (device->connectDevice(entry.errorMessage)) {
+        entry.canConnect = true;
+        device->disconnectFromDevice();
+    }
+    return entry;
+}
@@ -19,7 +19,15 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
     QVariant data(const QModelIndex &index, int role) const override;
     void updateDeviceList();
+    /// Add or update the entry of a device that {@see FindDevices::addDevice} has found.
+    void deviceAdded(UniqueUSBid id);
+    /// Remove the entry of a device that {@see FindDevices::removeDevice} has removed.
+    void deviceRemoved(UniqueUSBid id);
+    /// \return The row of the device, -1 if it is not listed
+    int rowOf(UniqueUSBid id) const;
 private:
+    /// Check the device, a device without firmware gets it uploaded.
+    DeviceListEntry makeEntry(UniqueUSBid id, USBDevice *device);
     std::vector<DeviceListEntry> entries;
     FindDevices* findDevices;
 };
@@ -1,12 +1,13 @@
 #include "selectsupporteddevice.h"
 
-#include <QTimer>
 #include <QDesktopServices>
 #include <QFile>
+#include <QSet>
 #include <QUrl>
 
 #include "usb/uploadFirmware.h"
 #include "usb/finddevices.h"
+#include "usb/hotplugwatcher.h"
 #include "dsomodel.h"
 #include "devicelistentry.h"
 #include "deviceslistmodel.h"
@@ -83,23 +84,46 @@ std::unique_ptr<USBDevice> SelectSupportedDevice::showSelectDeviceModal(libusb_c
 
     updateSupportedDevices();
 
-    QTimer timer;
-    timer.setInterval(1000);
-    connect(&timer, &QTimer::timeout, [this, &model, &findDevices, &messageNoDevices]() {
-        if (findDevices->updateDeviceList())
-            model->updateDeviceList();
+    auto showDevices = [this, &model, &messageNoDevices]() {
         if (model->rowCount(QModelIndex())) {
             ui->cmbDevices->setCurrentIndex(0);
         } else {
             ui->labelReadyState->setText(messageNoDevices);
         }
+    };
+    showDevices();
+
+    // the list is updated per plug event, the device with the uploaded firmware arrives again after renumeration
+    QSet<UniqueUSBid> uploading;
+    HotplugWatcher watcher(context);
+    connect(&watcher, &HotplugWatcher::deviceArrived, [this, &model, &findDevices, &uploading, &showDevices](libusb_device *device) {
+        const UniqueUSBid id = findDevices->addDevice(device);
+        if (!id)
+            return;
+        model->deviceAdded(id);
+        showDevices();
+        const int row = model->rowOf(id);
+        const bool ready = row >= 0 && model->data(model->index(row, 0), Qt::UserRole+1).toBool();
+        if (ready && uploading.contains(id) && model->rowCount(QModelIndex()) == 1) {
+            // the only scope came up with the firmware that we have just uploaded, start it right away
+            selectedDevice = id;
+            QCoreApplication::instance()->quit();
+        } else if (row >= 0 && model->data(model->index(row, 0), Qt::UserRole+2).toBool()) {
+            uploading.insert(id);
+        }
+    });
+    connect(&watcher, &HotplugWatcher::deviceLeft, [&model, &findDevices, &showDevices](libusb_device *device) {
+        const UniqueUSBid id = findDevices->removeDevice(device);
+        if (!id)
+            return;
+        model->deviceRemoved(id);
+        showDevices();
     });
-    timer.start();
-    QCoreApplication::sendEvent(&timer, new QTimerEvent(timer.timerId())); // immediate timer event
+    watcher.watch();
 
     show();
     QCoreApplication::instance()->exec();
-    timer.stop();
+    watcher.stop();
     close();
 
     return findDevices->takeDevice(selectedDevice);
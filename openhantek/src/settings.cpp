@@ -85,6 +85,14 @@ void DsoSettings::load() {
     }
     if (store->contains("timebase")) scope.horizontal.timebase = store->value("timebase").toDouble();
     if (store->contains("recordLength")) scope.horizontal.recordLength = store->value("recordLength").toUInt();
+    if (store->contains("peakDetect")) scope.horizontal.peakDetect = store->value("peakDetect").toBool();
+    if (store->contains("segmentCount")) scope.horizontal.segmentCount = store->value("segmentCount").toUInt();
+    if (store->contains("segmentLength")) scope.horizontal.segmentLength = store->value("segmentLength").toUInt();
+    if (store->contains("etsFactor")) scope.horizontal.etsFactor = store->value("etsFactor").toUInt();
+    if (store->contains("averaging"))
+        scope.horizontal.averaging = (Dso::AveragingMode)store->value("averaging").toUInt();
+    if (store->contains("averageCount")) scope.horizontal.averageCount = store->value("averageCount").toUInt();
+    if (store->contains("historyMemory")) scope.horizontal.historyMemory = store->value("historyMemory").toUInt();
     if (store->contains("samplerate")) scope.horizontal.samplerate = store->value("samplerate").toDouble();
     store->endGroup();
     // Trigger
@@ -93,6 +101,14 @@ void DsoSettings::load() {
     if (store->contains("position")) scope.trigger.position = store->value("position").toDouble();
     if (store->contains("slope")) scope.trigger.slope = (Dso::Slope)store->value("slope").toUInt();
     if (store->contains("source")) scope.trigger.source = store->value("source").toUInt();
+    if (store->contains("type")) scope.trigger.type = (Dso::TriggerType)store->value("type").toUInt();
+    if (store->contains("condition"))
+        scope.trigger.condition = (Dso::TriggerCondition)store->value("condition").toUInt();
+    if (store->contains("time")) scope.trigger.time = store->value("time").toDouble();
+    if (store->contains("timeUpper")) scope.trigger.timeUpper = store->value("timeUpper").toDouble();
+    if (store->contains("secondLevel")) scope.trigger.secondLevel = store->value("secondLevel").toDouble();
+    if (store->contains("fastAcquisition"))
+        scope.trigger.fastAcquisition = store->value("fastAcquisition").toBool();
     store->endGroup();
     // Spectrum
     for (ChannelID channel = 0; channel < scope.spectrum.size(); ++channel) {
@@ -223,6 +239,13 @@ void DsoSettings::save() {
         store->setValue(QString("marker%1").arg(marker), scope.getMarker(marker));
     store->setValue("timebase", scope.horizontal.timebase);
     store->setValue("recordLength", scope.horizontal.recordLength);
+    store->setValue("peakDetect", scope.horizontal.peakDetect);
+    store->setValue("segmentCount", scope.horizontal.segmentCount);
+    store->setValue("segmentLength", scope.horizontal.segmentLength);
+    store->setValue("historyMemory", scope.horizontal.historyMemory);
+    store->setValue("etsFactor", scope.horizontal.etsFactor);
+    store->setValue("averaging", (unsigned)scope.horizontal.averaging);
+    store->setValue("averageCount", scope.horizontal.averageCount);
     store->setValue("samplerate", scope.horizontal.samplerate);
     store->endGroup();
     // Trigger
@@ -231,6 +254,12 @@ void DsoSettings::save() {
     store->setValue("position", scope.trigger.position);
     store->setValue("slope", (unsigned)scope.trigger.slope);
     store->setValue("source", scope.trigger.source);
+    store->setValue("type", (unsigned)scope.trigger.type);
+    store->setValue("condition", (unsigned)scope.trigger.condition);
+    store->setValue("time", scope.trigger.time);
+    store->setValue("timeUpper", scope.trigger.timeUpper);
+    store->setValue("secondLevel", scope.trigger.secondLevel);
+    store->setValue("fastAcquisition", scope.trigger.fastAcquisition);
     store->endGroup();
     // Spectrum
     for (ChannelID channel = 0; channel < scope.spectrum.size(); ++channel) {
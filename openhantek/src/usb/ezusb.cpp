@@ -34,6 +34,7 @@
 #endif
 
 #include "ezusb.h"
+#include "firmwareimage.h"
 
 #define logerror(...) fprintf(stderr, __VA_ARGS__)
 
@@ -642,3 +643,77 @@ exit:
     fclose(image);
     return ret;
 }
+
+int ezusb_load_image(libusb_device_handle *device, const FirmwareImage *image, int fx_type, unsigned *writes) {
+    uint32_t cpucs_addr;
+    bool (*is_external)(uint32_t off, size_t len);
+    struct ram_poke_context ctx;
+    unsigned char chunk[FIRMWARE_CHUNK_SIZE];
+    uint32_t chunk_addr = 0;
+    size_t chunk_len = 0;
+    uint32_t high = 0; /* end of the highest segment so far */
+
+    switch (fx_type) {
+    case FX_TYPE_FX2LP:
+        cpucs_addr = 0xe600;
+        is_external = fx2lp_is_external;
+        break;
+    case FX_TYPE_FX2:
+        cpucs_addr = 0xe600;
+        is_external = fx2_is_external;
+        break;
+    case FX_TYPE_FX3:
+        logerror("FX3 images are not supported\n");
+        return -EINVAL;
+    default:
+        cpucs_addr = 0x7f92;
+        is_external = fx_is_external;
+        break;
+    }
+
+    /* halt the CPU while we overwrite its code/data */
+    if (!ezusb_cpucs(device, cpucs_addr, false)) return -1;
+
+    ctx.device = device;
+    ctx.mode = internal_only;
+    ctx.total = ctx.count = 0;
+    for (unsigned index = 0; index < image->segmentCount; ++index) {
+        const FirmwareSegment *segment = &image->segments[index];
+        const unsigned char *data = image->data + segment->offset;
+        uint32_t addr = segment->address;
+        size_t len = segment->length;
+        while (len) {
+            /* write the chunk unless the segment continues it after a small gap;
+             * the gaps are unused code space, zeros are NOPs for the 8051.
+             * A gap below the end of an earlier segment is never filled.
+             */
+            if (chunk_len && (addr < chunk_addr + chunk_len || addr - (chunk_addr + chunk_len) > FIRMWARE_GAP_FILL ||
+                              (addr > chunk_addr + chunk_len && chunk_addr + chunk_len < high) ||
+                              addr - chunk_addr >= FIRMWARE_CHUNK_SIZE || is_external(chunk_addr, addr + 1 - chunk_addr))) {
+                if (ram_poke(&ctx, chunk_addr, is_external(chunk_addr, chunk_len), chunk, chunk_len) < 0) return -1;
+                chunk_len = 0;
+            }
+            if (!chunk_len) chunk_addr = addr;
+            size_t gap = addr - (chunk_addr + chunk_len);
+            memset(chunk + chunk_len, 0, gap);
+            chunk_len += gap;
+            size_t part = len < FIRMWARE_CHUNK_SIZE - chunk_len ? len : FIRMWARE_CHUNK_SIZE - chunk_len;
+            memcpy(chunk + chunk_len, data, part);
+            chunk_len += part;
+            addr += part;
+            data += part;
+            len -= part;
+        }
+        if (addr > high) high = addr;
+    }
+    if (chunk_len && ram_poke(&ctx, chunk_addr, is_external(chunk_addr, chunk_len), chunk, chunk_len) < 0) return -1;
+
+    if (verbose && (ctx.count != 0)) {
+        logerror("... WROTE: %d bytes, %d segments, avg %d\n", (int)ctx.total, (int)ctx.count,
+                 (int)(ctx.total / ctx.count));
+    }
+    if (writes) *writes = (unsigned)ctx.count;
+
+    /* reset the CPU so it runs what we just uploaded */
+    return ezusb_cpucs(device, cpucs_addr, true) ? 0 : -1;
+}
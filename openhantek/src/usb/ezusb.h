@@ -22,6 +22,7 @@
 #include <inttypes.h>
 
 struct libusb_device_handle;
+struct FirmwareImage;
 #define FX_TYPE_FX2 2   /* USB 2.0 versions */
 #define FX_TYPE_FX2LP 3 /* Updated FX2 */
 #define FX_TYPE_FX3 4   /* USB 3.0 versions */
@@ -36,6 +37,17 @@ struct libusb_device_handle;
  */
 extern int ezusb_load_ram(libusb_device_handle *device, const char *path, int fx_type, int stage);
 
+/*
+ * This function uploads a firmware image that was converted at build time
+ * into RAM, using the first stage loader. Neighbouring segments are merged
+ * into control writes of up to FIRMWARE_CHUNK_SIZE bytes, small gaps between
+ * them are filled with zeros. The number of control writes is returned in
+ * writes if it is not NULL.
+ *
+ * The target processor is reset at the end of this upload.
+ */
+extern int ezusb_load_image(libusb_device_handle *device, const FirmwareImage *image, int fx_type, unsigned *writes);
+
 /* Verbosity level (default 1). Can be increased or decreased with options v/q
  */
 extern int verbose;
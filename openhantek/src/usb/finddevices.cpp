@@ -33,10 +33,6 @@ int FindDevices::updateDeviceList() {
 
     for (ssize_t deviceIterator = 0; deviceIterator < deviceCount; ++deviceIterator) {
         libusb_device *device = deviceList[deviceIterator];
-        // Get device descriptor
-        struct libusb_device_descriptor descriptor;
-        libusb_get_device_descriptor(device, &descriptor);
-
         DeviceList::const_iterator inList = devices.find(USBDevice::computeUSBdeviceID(device));
 
         if (inList != devices.end()) {
@@ -44,15 +40,10 @@ int FindDevices::updateDeviceList() {
             continue;
         }
 
-        for (DSOModel* model : ModelRegistry::get()->models()) {
-            // Check VID and PID for firmware flashed devices
-            bool supported = descriptor.idVendor == model->vendorID && descriptor.idProduct == model->productID;
-            // Devices without firmware have different VID/PIDs
-            supported |= descriptor.idVendor == model->vendorIDnoFirmware && descriptor.idProduct == model->productIDnoFirmware;
-            if (supported) {
-                ++changes;
-                devices[USBDevice::computeUSBdeviceID(device)] = std::unique_ptr<USBDevice>(new USBDevice(model, device, findIteration));
-            }
+        DSOModel *model = findModel(device);
+        if (model) {
+            ++changes;
+            devices[USBDevice::computeUSBdeviceID(device)] = std::unique_ptr<USBDevice>(new USBDevice(model, device, findIteration, context));
         }
     }
 
@@ -78,6 +69,40 @@ int FindDevices::updateDeviceList() {
     return changes;
 }
 
+UniqueUSBid FindDevices::addDevice(libusb_device *device)
+{
+    DSOModel *model = findModel(device);
+    if (!model) return 0;
+    const UniqueUSBid id = USBDevice::computeUSBdeviceID(device);
+    DeviceList::iterator inList = devices.find(id);
+    // a device that renumerates after the firmware upload arrives at the same port
+    if (inList == devices.end() || !inList->second || inList->second->getRawDevice() != device)
+        devices[id] = std::unique_ptr<USBDevice>(new USBDevice(model, device, findIteration, context));
+    return id;
+}
+
+UniqueUSBid FindDevices::removeDevice(libusb_device *device)
+{
+    const UniqueUSBid id = USBDevice::computeUSBdeviceID(device);
+    DeviceList::iterator inList = devices.find(id);
+    // the arrival of the renumerated device may have replaced it already
+    if (inList == devices.end() || (inList->second && inList->second->getRawDevice() != device)) return 0;
+    devices.erase(inList);
+    return id;
+}
+
+DSOModel *FindDevices::findModel(libusb_device *device)
+{
+    // Devices without firmware have different VID/PIDs
+    struct libusb_device_descriptor descriptor;
+    if (libusb_get_device_descriptor(device, &descriptor) != LIBUSB_SUCCESS) return nullptr;
+    DSOModel *found = nullptr;
+    for (DSOModel* model : ModelRegistry::get()->models()) {
+        if (USBDevice::isModel(model, descriptor)) found = model; // the last registered model wins
+    }
+    return found;
+}
+
 const FindDevices::DeviceList* FindDevices::getDevices()
 {
     return &devices;
@@ -14,7 +14,8 @@ struct libusb_context;
 /**
  * @brief Search for Hantek devices.
  * Use usually want to call `updateDeviceList` and then retrieve the list via `getDevices`.
- * You can call `updateDeviceList` as often as you want.
+ * You can call `updateDeviceList` as often as you want. With a {@link HotplugWatcher} the list
+ * is updated per event with `addDevice` and `removeDevice` instead.
  * If you have found your favorite device, you want to call `takeDevice`. The device will
  * not be available in `getDevices` anymore and this will not change with calls to `updateDeviceList`.
  *
@@ -27,6 +28,12 @@ class FindDevices{
     /// Updates the device list. To clear the list, just dispose this object
     /// \return If negative it represents a libusb error code otherwise the amount of updates
     int updateDeviceList();
+    /// Add a plugged in device if it is supported, a device at the same port is replaced.
+    /// \return The unique usb id of the device, 0 if it is not supported
+    UniqueUSBid addDevice(libusb_device *device);
+    /// Remove an unplugged device.
+    /// \return The unique usb id of the device, 0 if it was not in the list
+    UniqueUSBid removeDevice(libusb_device *device);
     const DeviceList *getDevices();
     /**
      * @brief takeDevice
@@ -35,6 +42,8 @@ class FindDevices{
      */
     std::unique_ptr<USBDevice> takeDevice(UniqueUSBid id);
   private:
+    /// \return The model of the device, nullptr if it is not supported
+    static DSOModel *findModel(libusb_device *device);
     libusb_context *context; ///< The usb context used for this device
     DeviceList devices;
     unsigned findIteration = 0;
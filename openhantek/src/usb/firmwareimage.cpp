@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "firmwareimage.h"
+
+// generated from res/firmware/*-firmware.hex
+extern const FirmwareImage firmwareImages[];
+extern const unsigned firmwareImageCount;
+
+const FirmwareImage *findFirmwareImage(const std::string &token) {
+    for (unsigned image = 0; image < firmwareImageCount; ++image) {
+        if (token == firmwareImages[image].token)
+            return &firmwareImages[image];
+    }
+    return nullptr;
+}
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#define FIRMWARE_CHUNK_SIZE 4096 ///< Largest control write of the firmware upload
+#define FIRMWARE_GAP_FILL 64     ///< Gaps up to this size between segments are filled, it saves control writes
+
+/// \brief A contiguous memory area of a firmware image.
+struct FirmwareSegment {
+    uint16_t address; ///< Start in the RAM of the device
+    uint16_t length;
+    uint32_t offset;  ///< Start in FirmwareImage::data
+};
+
+/// \brief A firmware image, converted from the Intel HEX file at build time by cmake/firmware2cpp.cmake.
+struct FirmwareImage {
+    const char *token; ///< DSOModel::firmwareToken
+    const FirmwareSegment *segments;
+    unsigned segmentCount;
+    const unsigned char *data;
+    size_t size; ///< Bytes of data
+};
+
+/// \return The built in firmware for the firmware token of a model, nullptr if there is none.
+const FirmwareImage *findFirmwareImage(const std::string &token);
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "hotplugwatcher.h"
+
+HotplugWatcher::HotplugWatcher(libusb_context *context, QObject *parent)
+    : QThread(parent), context(context), watched(context) {
+    setObjectName("hotplugWatcher");
+    // the events of the program's context also complete the transfers of the opened devices
+    libusb_context *own = nullptr;
+    if (libusb_init(&own) == LIBUSB_SUCCESS)
+        watched = own;
+    else
+        qWarning("HotplugWatcher: no libusb context of its own, the device list is polled");
+    qRegisterMetaType<libusb_device *>();
+    connect(this, &HotplugWatcher::arrived, this, &HotplugWatcher::forwardArrived, Qt::QueuedConnection);
+    connect(this, &HotplugWatcher::left, this, &HotplugWatcher::forwardLeft, Qt::QueuedConnection);
+}
+
+
+HotplugWatcher::~HotplugWatcher() {
+    stop();
+    if (watched != context)
+        libusb_exit(watched);
+}
+
+
+void HotplugWatcher::watch(bool enumerate) {
+    if (isRunning())
+        return;
+    // the devices that are already connected are reported from within the registration
+    hotplug = watched != context && libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+              libusb_hotplug_register_callback(
+                  watched, libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                  enumerate ? LIBUSB_HOTPLUG_ENUMERATE : LIBUSB_HOTPLUG_NO_FLAGS, LIBUSB_HOTPLUG_MATCH_ANY,
+                  LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, hotplugCallback, this,
+                  &callback) == LIBUSB_SUCCESS;
+    if (!hotplug)
+        poll(enumerate);
+    start();
+}
+
+
+void HotplugWatcher::stop() {
+    if (!isRunning())
+        return;
+    requestInterruption();
+    if (hotplug) // also wakes up the event handling
+        libusb_hotplug_deregister_callback(watched, callback);
+    wait();
+    hotplug = false;
+    for (libusb_device *device : known)
+        libusb_unref_device(device);
+    known.clear();
+    for (const auto &pair : reported) {
+        libusb_unref_device(pair.first);
+        libusb_unref_device(pair.second);
+    }
+    reported.clear();
+}
+
+
+void HotplugWatcher::run() {
+    while (!isInterruptionRequested()) {
+        if (hotplug) {
+            struct timeval timeout = {0, HOTPLUG_EVENT_TIMEOUT * 1000};
+            libusb_handle_events_timeout_completed(watched, &timeout, nullptr);
+        } else {
+            msleep(HOTPLUG_POLL_INTERVAL);
+            poll(true);
+        }
+    }
+}
+
+
+int LIBUSB_CALL HotplugWatcher::hotplugCallback(libusb_context *, libusb_device *device, libusb_hotplug_event event,
+                                                void *watcher) {
+    HotplugWatcher *self = static_cast<HotplugWatcher *>(watcher);
+    libusb_ref_device(device); // released after forwarding
+    if (event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED)
+        emit self->arrived(device, QPrivateSignal());
+    else
+        emit self->left(device, QPrivateSignal());
+    return 0; // stay registered
+}
+
+
+void HotplugWatcher::poll(bool report) {
+    libusb_device **deviceList;
+    ssize_t deviceCount = libusb_get_device_list(watched, &deviceList);
+    if (deviceCount < 0)
+        return;
+    // a renumerated device is a new libusb_device even at the same port, the known ones can not be reused
+    const std::set<libusb_device *> present(deviceList, deviceList + deviceCount);
+    for (libusb_device *device : present) {
+        if (known.count(device))
+            continue;
+        known.insert(libusb_ref_device(device));
+        if (report)
+            emit arrived(libusb_ref_device(device), QPrivateSignal());
+    }
+    for (std::set<libusb_device *>::iterator it = known.begin(); it != known.end();) {
+        if (present.count(*it)) {
+            ++it;
+            continue;
+        }
+        if (report) // hands over the reference of the list
+            emit left(*it, QPrivateSignal());
+        else
+            libusb_unref_device(*it);
+        it = known.erase(it);
+    }
+#if !defined(__FreeBSD__) // see FindDevices::updateDeviceList()
+    libusb_free_device_list(deviceList, true);
+#endif
+}
+
+
+libusb_device *HotplugWatcher::findInContext(libusb_device *device) {
+    if (watched == context)
+        return libusb_ref_device(device);
+    libusb_device **deviceList;
+    ssize_t deviceCount = libusb_get_device_list(context, &deviceList);
+    if (deviceCount < 0)
+        return nullptr;
+    libusb_device *found = nullptr;
+    // the bus address is unique while the device is plugged in, a renumerated device gets a new one
+    for (ssize_t index = 0; index < deviceCount && !found; ++index) {
+        if (libusb_get_bus_number(deviceList[index]) == libusb_get_bus_number(device) &&
+            libusb_get_device_address(deviceList[index]) == libusb_get_device_address(device))
+            found = libusb_ref_device(deviceList[index]);
+    }
+#if !defined(__FreeBSD__) // see FindDevices::updateDeviceList()
+    libusb_free_device_list(deviceList, true);
+#endif
+    return found;
+}
+
+
+void HotplugWatcher::forwardArrived(libusb_device *device) {
+    if (reported.count(device)) { // already reported, e.g. by the enumeration
+        libusb_unref_device(device);
+        return;
+    }
+    libusb_device *found = findInContext(device);
+    if (found) { // keeps the reference of the signal
+        reported[device] = found;
+        emit deviceArrived(found);
+    } else {
+        qWarning("HotplugWatcher: device %u:%u is not known to libusb", libusb_get_bus_number(device),
+                 libusb_get_device_address(device));
+        libusb_unref_device(device);
+    }
+}
+
+
+void HotplugWatcher::forwardLeft(libusb_device *device) {
+    // the device of the program's context may be gone already, use the one that was reported
+    std::map<libusb_device *, libusb_device *>::iterator it = reported.find(device);
+    libusb_device *found = nullptr;
+    if (it != reported.end()) {
+        found = it->second;
+        libusb_unref_device(it->first);
+        reported.erase(it);
+    } else {
+        found = findInContext(device);
+    }
+    if (found) {
+        emit deviceLeft(found);
+        libusb_unref_device(found);
+    }
+    libusb_unref_device(device);
+}
@@ -0,0 +1,66 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QThread>
+#include <map>
+#include <set>
+
+#include "usbdevice.h"
+
+#define HOTPLUG_POLL_INTERVAL 250 ///< Interval of the device list comparison without hotplug support in ms
+#define HOTPLUG_EVENT_TIMEOUT 100 ///< Longest wait for libusb events before the interruption is checked in ms
+
+/// \brief Reports the USB devices that are plugged in or unplugged.
+/// The libusb hotplug callbacks are used where the platform supports them, otherwise the device list is
+/// compared every HOTPLUG_POLL_INTERVAL ms. The thread handles the libusb events of a context of its own,
+/// it never runs the transfer callbacks of the devices that are opened in the context of the program.
+/// The signals are emitted in the thread of the watcher object with the device of the program's context.
+/// The device is only referenced during the signal, a receiver that keeps it has to call libusb_ref_device().
+class HotplugWatcher : public QThread {
+    Q_OBJECT
+
+  public:
+    /// \param context The context of the reported devices.
+    explicit HotplugWatcher(libusb_context *context, QObject *parent = nullptr);
+    ~HotplugWatcher() override;
+
+    /// \brief Register the callback and start the event thread.
+    /// \param enumerate Report the devices that are already connected as arrived.
+    void watch(bool enumerate = true);
+
+    /// \brief Stop the event thread, must be called before the context is closed.
+    void stop();
+
+    /// \return true if libusb reports the events, false if the device list is polled.
+    inline bool usesHotplug() const { return hotplug; }
+
+  signals:
+    void deviceArrived(libusb_device *device); ///< A device has been plugged in
+    void deviceLeft(libusb_device *device);    ///< A device has been unplugged
+    // from the event thread, the device is referenced until it is forwarded
+    void arrived(libusb_device *device, QPrivateSignal);
+    void left(libusb_device *device, QPrivateSignal);
+
+  protected:
+    void run() override;
+
+  private:
+    static int LIBUSB_CALL hotplugCallback(libusb_context *context, libusb_device *device,
+                                           libusb_hotplug_event event, void *watcher);
+    /// \brief Compare the device list with the last one.
+    /// \param report Emit the changes, false only takes the list.
+    void poll(bool report);
+    void forwardArrived(libusb_device *device);
+    void forwardLeft(libusb_device *device);
+    /// \return The referenced device of the program's context at the same bus address, nullptr if none.
+    libusb_device *findInContext(libusb_device *device);
+
+    libusb_context *context;
+    libusb_context *watched;                 ///< Own context, the program's one if it can't be created
+    /// The referenced devices of the own context that were reported with their device in the program's context
+    std::map<libusb_device *, libusb_device *> reported;
+    bool hotplug = false;                    ///< The callback is registered
+    libusb_hotplug_callback_handle callback; ///< Handle of the registered callback
+    std::set<libusb_device *> known;         ///< The referenced devices of the last poll
+};
@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include "transferstatistics.h"
+
+QString TransferStatistics::toString() const {
+    return QString("received %1 MB in %2 transfers, retries %3, timeouts %4, errors %5")
+        .arg(bytes.load() / 1e6, 0, 'f', 1)
+        .arg(transfers.load())
+        .arg(retries.load())
+        .arg(timeouts.load())
+        .arg(errors.load());
+}
@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QString>
+
+/// \brief Counters of the bulk IN transfers of a device.
+/// Updated by the acquisition thread and the completion callbacks of the streaming transfers.
+struct TransferStatistics {
+    QAtomicInteger<quint64> bytes;     ///< Received bytes
+    QAtomicInteger<quint64> transfers; ///< Completed transfers, also the ones with a timeout or error
+    QAtomicInteger<quint64> retries;   ///< Transfers that were submitted again after a timeout
+    QAtomicInteger<quint64> timeouts;  ///< Transfers that timed out
+    QAtomicInteger<quint64> errors;    ///< Transfers that failed otherwise
+
+    /// \brief One line summary of the counters for the log and the status bar.
+    QString toString() const;
+};
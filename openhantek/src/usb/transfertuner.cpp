@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QThread>
+
+#include "transfertuner.h"
+
+namespace {
+
+const unsigned transferSizes[] = {16384, 32768, 65536, 131072};
+const unsigned transferCounts[] = {16, 32, 64};
+
+} // namespace
+
+
+double TransferTrial::headroom(double rate) const {
+    if (latency <= 0.0)
+        return 0.0;
+    return config.size * double(config.count) / rate / latency;
+}
+
+
+TransferTuner::TransferTuner(StreamFactory factory, double rate, unsigned blockSize, double processingTime)
+    : factory(factory), rate(rate), blockSize(blockSize), processingTime(processingTime) {}
+
+
+std::vector<TransferConfig> TransferTuner::candidates() {
+    std::vector<TransferConfig> configs;
+    for (unsigned size : transferSizes) {
+        for (unsigned count : transferCounts) {
+            TransferConfig config;
+            config.size = size;
+            config.count = count;
+            configs.push_back(config);
+        }
+    }
+    return configs;
+}
+
+
+TransferTrial TransferTuner::measure(const TransferConfig &config, unsigned milliseconds) {
+    TransferTrial trial;
+    trial.config = config;
+    std::unique_ptr<USBStream> stream = factory();
+    if (!stream) {
+        trial.error = LIBUSB_ERROR_NO_DEVICE;
+        return trial;
+    }
+    stream->setExpectedRate(rate);
+    int errorCode = stream->start(config.size, config.count, 2 * blockSize);
+    if (errorCode < 0) {
+        trial.error = errorCode;
+        return trial;
+    }
+    std::vector<unsigned char> block(blockSize);
+    // the first block contains the gap of the start and the time to submit the transfers
+    errorCode = stream->read(block.data(), blockSize, TUNER_READ_TIMEOUT);
+    const unsigned gaps = stream->getGaps();
+    const unsigned errors = stream->getErrors();
+    const unsigned long long received = stream->getBytesReceived();
+    QElapsedTimer timer;
+    timer.start();
+    while (errorCode >= 0 && timer.elapsed() < qint64(milliseconds)) {
+        if (processingTime > 0.0)
+            QThread::usleep((unsigned long)(processingTime * 1000));
+        errorCode = stream->read(block.data(), blockSize, TUNER_READ_TIMEOUT);
+    }
+    // a slow consumer skips data, it was received nevertheless; take the transfers that finished meanwhile
+    if (errorCode >= 0)
+        stream->handleEvents(0);
+    trial.throughput = (stream->getBytesReceived() - received) / (timer.nsecsElapsed() * 1e-9);
+    trial.latency = stream->getMaxCompletionInterval() * 1e-9;
+    trial.lost = stream->getGaps() - gaps + stream->getErrors() - errors;
+    trial.error = errorCode < 0 ? errorCode : 0;
+    stream->stop();
+    return trial;
+}
+
+
+bool TransferTuner::isGood(const TransferTrial &trial) const {
+    return !trial.error && !trial.lost && trial.throughput >= TUNER_THROUGHPUT * rate;
+}
+
+
+TransferConfig TransferTuner::tune(unsigned milliseconds) {
+    trials.clear();
+    const TransferTrial *best = nullptr;
+    for (const TransferConfig &config : candidates()) {
+        trials.push_back(measure(config, milliseconds));
+        if (trials.back().error == LIBUSB_ERROR_NO_DEVICE)
+            break;
+        if (isGood(trials.back()) && trials.back().headroom(rate) >= TUNER_HEADROOM)
+            return config;
+    }
+    // none with the full headroom: the good one with the most, otherwise the least lost data
+    for (const TransferTrial &trial : trials) {
+        if (!best || (isGood(trial) && !isGood(*best)) ||
+            (isGood(trial) && isGood(*best) && trial.headroom(rate) > best->headroom(rate)) ||
+            (!isGood(trial) && !isGood(*best) &&
+             (trial.error < best->error || (trial.error == best->error && trial.lost < best->lost))))
+            best = &trial;
+    }
+    return best ? best->config : TransferConfig();
+}
+
+
+TransferConfig TransferTuner::forLatency(double rate, double latency, unsigned long long minRing) {
+    TransferConfig largest;
+    for (const TransferConfig &config : candidates()) {
+        const unsigned long long ring = (unsigned long long)config.size * config.count;
+        if (ring < minRing)
+            continue;
+        if (ring / rate >= TUNER_HEADROOM * latency)
+            return config;
+        if (ring > (unsigned long long)largest.size * largest.count)
+            largest = config;
+    }
+    return largest;
+}
+
+
+QString TransferTuner::hostKey(libusb_device *device) {
+#ifdef __linux__
+    // the root hub of a bus is a child of its host controller, e.g. /sys/devices/pci0000:00/0000:00:14.0/usb1;
+    // the bus numbers are assigned at boot, the path of the controller is fixed by the hardware
+    const QString devices = "/sys/devices/";
+    const QString rootHub =
+        QFileInfo(QString("/sys/bus/usb/devices/usb%1").arg(libusb_get_bus_number(device))).canonicalFilePath();
+    if (!rootHub.startsWith(devices))
+        return QString();
+    const QString controller = QFileInfo(rootHub).path();
+    if (controller.length() <= devices.length())
+        return QString();
+    // a settings key must not contain '/'
+    QString key = controller.mid(devices.length()).replace('/', '_');
+    // PCI controllers also have their vendor and device id
+    QFile vendorFile(QDir(controller).filePath("vendor"));
+    QFile deviceFile(QDir(controller).filePath("device"));
+    if (vendorFile.open(QIODevice::ReadOnly) && deviceFile.open(QIODevice::ReadOnly))
+        key += QString("_%1-%2")
+                   .arg(QString::fromLatin1(vendorFile.readAll()).trimmed())
+                   .arg(QString::fromLatin1(deviceFile.readAll()).trimmed());
+    return key;
+#else
+    Q_UNUSED(device)
+    return QString();
+#endif
+}
+
+
+bool TransferTuner::load(const QString &model, const QString &host, TransferConfig &config) {
+    QSettings settings;
+    settings.beginGroup("transfers");
+    settings.beginGroup(model);
+    settings.beginGroup(host);
+    if (!settings.contains("size") || !settings.contains("count"))
+        return false;
+    config.size = settings.value("size").toUInt();
+    config.count = settings.value("count").toUInt();
+    return config.size && config.count;
+}
+
+
+void TransferTuner::save(const QString &model, const QString &host, const TransferConfig &config) {
+    QSettings settings;
+    settings.beginGroup("transfers");
+    settings.beginGroup(model);
+    settings.beginGroup(host);
+    settings.setValue("size", config.size);
+    settings.setValue("count", config.count);
+}
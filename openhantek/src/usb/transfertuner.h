@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "usbstream.h"
+
+#define TUNER_TRIAL_TIME 400    ///< Duration of the measurement of one configuration in ms
+#define TUNER_READ_TIMEOUT 1000 ///< Longest wait for a block during a measurement in ms
+#define TUNER_HEADROOM 4.0      ///< The ring of transfers shall cover this many longest completion intervals
+#define TUNER_THROUGHPUT 0.95   ///< Fraction of the device rate a configuration has to sustain
+#define TUNER_ONLINE_TIME 5     ///< Seconds the acquisition streams with a configuration before it is judged
+
+/// \brief A configuration of the streaming transfers.
+struct TransferConfig {
+    unsigned size = 0;  ///< Bytes of one transfer
+    unsigned count = 0; ///< Transfers in flight
+};
+
+/// \brief The measurement of one TransferConfig.
+struct TransferTrial {
+    TransferConfig config;
+    double throughput = 0.0;     ///< Bytes per second received by the stream
+    double latency = 0.0;        ///< Longest time between two transfer completions in s
+    unsigned long long lost = 0; ///< Detected gaps and failed transfers
+    int error = 0;               ///< libusb error that ended the measurement
+
+    /// \return The time the ring of transfers covers divided by the latency.
+    double headroom(double rate) const;
+};
+
+/// \brief Finds the size and number of the streaming transfers that keep up with the device on this host.
+/// The candidates stream for TUNER_TRIAL_TIME ms each while the blocks are read like in the acquisition,
+/// including the time to process a block. The first configuration that sustains the rate without lost
+/// data and with TUNER_HEADROOM wins; the candidates are measured by increasing transfer size, smaller
+/// transfers deliver the samples earlier. This sweep takes seconds and belongs to the streambenchmark
+/// tool; the acquisition keeps streaming and picks the next configuration with forLatency() from the
+/// latency of its running stream instead. The result is kept per host controller and model in the
+/// application settings, so the tuning runs only once.
+class TransferTuner {
+  public:
+    /// Creates a stream that is not started, e.g. USBDevice::createStream() or a simulated one.
+    typedef std::function<std::unique_ptr<USBStream>()> StreamFactory;
+
+    /// \param factory Creates the streams that are measured.
+    /// \param rate The data rate of the device in bytes per second.
+    /// \param blockSize The size of the blocks the acquisition reads.
+    /// \param processingTime The time the acquisition needs per block in ms, no events are handled then.
+    TransferTuner(StreamFactory factory, double rate, unsigned blockSize, double processingTime = 0.0);
+
+    /// \return The measured configurations, by increasing transfer size and number.
+    static std::vector<TransferConfig> candidates();
+
+    /// \brief Stream with a configuration and measure it.
+    TransferTrial measure(const TransferConfig &config, unsigned milliseconds = TUNER_TRIAL_TIME);
+
+    /// \brief Measure the candidates until one is good enough.
+    /// \return The best configuration, the one with the least lost data if none is good enough.
+    TransferConfig tune(unsigned milliseconds = TUNER_TRIAL_TIME);
+
+    /// \return The measurements of the last tune().
+    inline const std::vector<TransferTrial> &getTrials() const { return trials; }
+
+    /// \brief Choose the configuration for a measured latency without streaming each candidate.
+    /// \param rate The data rate of the device in bytes per second.
+    /// \param latency The longest time between two transfer completions in s.
+    /// \param minRing Smallest ring of transfers in bytes, the smaller ones lost data.
+    /// \return The first candidate with TUNER_HEADROOM, the largest ring if none has it, size 0 if no
+    /// candidate has minRing.
+    static TransferConfig forLatency(double rate, double latency, unsigned long long minRing = 0);
+
+    /// \return Identification of the host controller the device is connected to that stays the same
+    /// across reboots and ports, empty if there is none. Use the default transfers then.
+    static QString hostKey(libusb_device *device);
+    /// \brief Get the persisted configuration of a model at a host controller.
+    /// \return false if there is none.
+    static bool load(const QString &model, const QString &host, TransferConfig &config);
+    static void save(const QString &model, const QString &host, const TransferConfig &config);
+
+  private:
+    bool isGood(const TransferTrial &trial) const;
+
+    StreamFactory factory;
+    double rate;
+    unsigned blockSize;
+    double processingTime;
+    std::vector<TransferTrial> trials;
+};
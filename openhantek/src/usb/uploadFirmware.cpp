@@ -2,8 +2,8 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QString>
-#include <QTemporaryFile>
 #ifdef __FreeBSD__
 	#include <libusb.h>
 #else
@@ -12,6 +12,7 @@
 #include <memory>
 
 #include "ezusb.h"
+#include "firmwareimage.h"
 #include "uploadFirmware.h"
 #include "usbdevice.h"
 
@@ -22,6 +23,14 @@
 bool UploadFirmware::startUpload(USBDevice *device) {
     if (device->isConnected() || !device->needsFirmware()) return false;
 
+    QElapsedTimer timer;
+    timer.start();
+    const FirmwareImage *image = findFirmwareImage(device->getModel()->firmwareToken);
+    if (!image) {
+        errorMessage = TR("No firmware for %1").arg(QString::fromStdString(device->getModel()->firmwareToken));
+        return false;
+    }
+
     // Open device
     libusb_device_handle *handle;
     int errorCode = libusb_open(device->getRawDevice(), &handle);
@@ -31,13 +40,6 @@ bool UploadFirmware::startUpload(USBDevice *device) {
         return false;
     }
 
-    // Write firmware from resources to temp files
-    QFile firmwareRes(
-        QString(":/firmware/%1-firmware.hex").arg(QString::fromStdString(device->getModel()->firmwareToken)));
-    auto temp_firmware_path = std::unique_ptr<QTemporaryFile>(QTemporaryFile::createNativeFile(firmwareRes));
-    if (!temp_firmware_path) return false;
-    temp_firmware_path->open();
-
     /* We need to claim the first interface */
     libusb_set_auto_detach_kernel_driver(handle, 1);
     int status = libusb_claim_interface(handle, 0);
@@ -47,8 +49,11 @@ bool UploadFirmware::startUpload(USBDevice *device) {
         return false;
     }
 
+    const qint64 opened = timer.nsecsElapsed();
+
     // Write firmware into internal RAM using first stage loader built into EZ-USB hardware
-    status = ezusb_load_ram(handle, temp_firmware_path->fileName().toUtf8().constData(), FX_TYPE_FX2LP, 0);
+    unsigned writes = 0;
+    status = ezusb_load_image(handle, image, FX_TYPE_FX2LP, &writes);
     if (status != LIBUSB_SUCCESS) {
         errorMessage = TR("Writing the main firmware failed: %1").arg(libusb_error_name(status));
         libusb_release_interface(handle, 0);
@@ -56,11 +61,23 @@ bool UploadFirmware::startUpload(USBDevice *device) {
         return false;
     }
 
+    const qint64 uploaded = timer.nsecsElapsed();
     libusb_release_interface(handle, 0);
     libusb_close(handle);
 
+    timingReport = QString("Firmware %1: %2 bytes in %3 writes, open %4 ms, upload %5 ms, total %6 ms")
+                       .arg(image->token)
+                       .arg(image->size)
+                       .arg(writes)
+                       .arg(opened * 1e-6, 0, 'f', 1)
+                       .arg((uploaded - opened) * 1e-6, 0, 'f', 1)
+                       .arg(timer.nsecsElapsed() * 1e-6, 0, 'f', 1);
+    qDebug() << timingReport;
+
     return status == LIBUSB_SUCCESS;
 }
 
 const QString &UploadFirmware::getErrorMessage() const { return errorMessage; }
 
+const QString &UploadFirmware::getTimingReport() const { return timingReport; }
+
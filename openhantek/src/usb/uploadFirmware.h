@@ -7,13 +7,15 @@
 class USBDevice;
 
 /**
- * Extracts the firmware from the applications resources, and uploads the
- * firmware to the given device.
+ * Uploads the firmware that is built into the application to the given device.
  */
 class UploadFirmware {
   public:
     bool startUpload(USBDevice *device);
     const QString &getErrorMessage() const;
+    /// Duration of the phases of the last successful upload
+    const QString &getTimingReport() const;
   private:
     QString errorMessage;
+    QString timingReport;
 };
@@ -5,6 +5,7 @@
 #include <iostream>
 
 #include "usbdevice.h"
+#include "usbstream.h"
 
 #include "hantekdso/dsomodel.h"
 // #include "hantekprotocol/bulkStructs.h"
@@ -53,8 +54,9 @@ UniqueUSBid USBDevice::computeUSBdeviceID(libusb_device *device) {
 }
 
 
-USBDevice::USBDevice(DSOModel *model, libusb_device *device, unsigned findIteration)
-    : model(model), device(device), findIteration(findIteration), uniqueUSBdeviceID(computeUSBdeviceID(device)) {
+USBDevice::USBDevice(DSOModel *model, libusb_device *device, unsigned findIteration, libusb_context *context)
+    : model(model), context(context), device(device), findIteration(findIteration),
+      uniqueUSBdeviceID(computeUSBdeviceID(device)) {
     libusb_ref_device(device);
     libusb_get_device_descriptor(device, &descriptor);
 }
@@ -142,6 +144,8 @@ void USBDevice::disconnectFromDevice() {
     if (!device)
         return;
 
+    stopStreaming();
+
     if (this->handle) {
         // Release claimed interface
         if (this->interface != -1) libusb_release_interface(this->handle, this->interface);
@@ -163,6 +167,29 @@ void USBDevice::disconnectFromDevice() {
 bool USBDevice::isConnected() { return this->handle != 0; }
 
 
+bool USBDevice::isModel(const DSOModel *model, const libusb_device_descriptor &descriptor) {
+    return (descriptor.idVendor == model->vendorID && descriptor.idProduct == model->productID) ||
+           (descriptor.idVendor == model->vendorIDnoFirmware && descriptor.idProduct == model->productIDnoFirmware);
+}
+
+
+bool USBDevice::reattach(libusb_device *newDevice) {
+    if (isConnected() || newDevice == device)
+        return false;
+    libusb_device_descriptor newDescriptor;
+    if (libusb_get_device_descriptor(newDevice, &newDescriptor) != LIBUSB_SUCCESS || !isModel(model, newDescriptor))
+        return false;
+    libusb_ref_device(newDevice);
+#if defined Q_OS_WIN
+    libusb_unref_device(device); // the other platforms released it in disconnectFromDevice()
+#endif
+    device = newDevice;
+    descriptor = newDescriptor;
+    uniqueUSBdeviceID = computeUSBdeviceID(newDevice);
+    return true;
+}
+
+
 bool USBDevice::needsFirmware() {
     return this->descriptor.idProduct != model->productID 
         || this->descriptor.idVendor != model->vendorID
@@ -177,9 +204,22 @@ int USBDevice::bulkTransfer(unsigned char endpoint, const unsigned char *data, u
 
     int errorCode = LIBUSB_ERROR_TIMEOUT;
     int transferred = 0;
-    for (int attempt = 0; (attempt < attempts || attempts == -1) && errorCode == LIBUSB_ERROR_TIMEOUT; ++attempt)
+    const bool in = endpoint & LIBUSB_ENDPOINT_IN;
+    for (int attempt = 0; (attempt < attempts || attempts == -1) && errorCode == LIBUSB_ERROR_TIMEOUT; ++attempt) {
         errorCode =
             libusb_bulk_transfer(this->handle, endpoint, (unsigned char *)data, (int)length, &transferred, timeout);
+        if (!in)
+            continue;
+        statistics.transfers.fetchAndAddRelaxed(1);
+        if (attempt)
+            statistics.retries.fetchAndAddRelaxed(1);
+        if (errorCode == LIBUSB_ERROR_TIMEOUT)
+            statistics.timeouts.fetchAndAddRelaxed(1);
+        else if (errorCode < 0)
+            statistics.errors.fetchAndAddRelaxed(1);
+    }
+    if (in && transferred > 0)
+        statistics.bytes.fetchAndAddRelaxed(quint64(transferred));
 
     if (errorCode == LIBUSB_ERROR_NO_DEVICE)
         disconnectFromDevice();
@@ -218,6 +258,61 @@ int USBDevice::bulkReadMulti(unsigned char *data, unsigned length, int attempts)
 }
 
 
+int USBDevice::startStreaming(unsigned transferSize, unsigned transferCount) {
+    if (!this->handle)
+        return LIBUSB_ERROR_NO_DEVICE;
+    if (stream)
+        return LIBUSB_SUCCESS;
+    // the transfers shall end on a packet boundary
+    if (this->inPacketLength > 0)
+        transferSize = qMax(1u, transferSize / unsigned(this->inPacketLength)) * unsigned(this->inPacketLength);
+
+    stream = createStream();
+    int errorCode = stream->start(transferSize, transferCount, transferSize * transferCount);
+    if (errorCode != LIBUSB_SUCCESS)
+        stream.reset();
+    return errorCode;
+}
+
+
+std::unique_ptr<USBStream> USBDevice::createStream() {
+    if (!this->handle)
+        return nullptr;
+    std::unique_ptr<USBStream> newStream(new USBStream(context, this->handle, HANTEK_EP_IN));
+    newStream->setStatistics(&statistics);
+    return newStream;
+}
+
+
+void USBDevice::stopStreaming() {
+    if (stream)
+        stream->stop();
+    stream.reset();
+}
+
+
+void USBDevice::flushStream() {
+    if (stream)
+        stream->flush();
+}
+
+
+int USBDevice::bulkReadStream(unsigned char *data, unsigned length, bool *gap) {
+    if (!this->handle)
+        return LIBUSB_ERROR_NO_DEVICE;
+    if (!stream)
+        return bulkReadMulti(data, length);
+
+    unsigned timeout = HANTEK_TIMEOUT_MULTI;
+    if (this->inPacketLength > 0)
+        timeout = HANTEK_TIMEOUT_MULTI * length / unsigned(this->inPacketLength);
+    int errorCode = stream->read(data, length, timeout, gap);
+    if (errorCode == LIBUSB_ERROR_NO_DEVICE)
+        disconnectFromDevice();
+    return errorCode;
+}
+
+
 int USBDevice::controlTransfer(unsigned char type, unsigned char request, unsigned char *data, unsigned int length,
                                int value, int index, int attempts) {
     if (!this->handle)
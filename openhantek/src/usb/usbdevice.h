@@ -11,12 +11,17 @@
 #endif
 #include <memory>
 
+#include "transferstatistics.h"
 #include "usbdevicedefinitions.h"
 
 class DSOModel;
+class USBStream;
 
 typedef unsigned long UniqueUSBid;
 
+Q_DECLARE_OPAQUE_POINTER(libusb_device *)
+Q_DECLARE_METATYPE(libusb_device *)
+
 
 /// \brief Returns string representation for libusb errors.
 /// \param error The error code.
@@ -29,7 +34,8 @@ class USBDevice : public QObject {
     Q_OBJECT
 
   public:
-    explicit USBDevice(DSOModel* model, libusb_device *device, unsigned findIteration = 0);
+    explicit USBDevice(DSOModel* model, libusb_device *device, unsigned findIteration = 0,
+                       libusb_context *context = nullptr);
     USBDevice(const USBDevice&) = delete;
     ~USBDevice();
     bool connectDevice(QString &errorMessage);
@@ -39,6 +45,15 @@ class USBDevice : public QObject {
     /// \return true, if a connection is up.
     bool isConnected();
 
+    /// \brief Take over a new enumeration of the same oscilloscope, e.g. after it was unplugged.
+    /// The device has to be disconnected, it is connected again with connectDevice().
+    /// \param newDevice The raw device, it may still need the firmware.
+    /// \return false, if the device is connected or newDevice is not of the same model.
+    bool reattach(libusb_device *newDevice);
+
+    /// \return true if the raw device has the IDs of the model, with or without firmware.
+    static bool isModel(const DSOModel *model, const libusb_device_descriptor &descriptor);
+
     /**
      * @return Return true if this device needs a firmware first
      */
@@ -93,6 +108,40 @@ class USBDevice : public QObject {
     /// \return Number of received bytes on success, libusb error code on error.
     int bulkReadMulti(unsigned char *data, unsigned length, int attempts = HANTEK_ATTEMPTS_MULTI);
 
+    /// \brief Start the continuous asynchronous reading of the IN endpoint.
+    /// Several bulk transfers are kept in flight, so the device FIFO is drained while the
+    /// previous block is processed, bulkReadStream() takes the data out of the stream buffer.
+    /// \param transferSize The size of one transfer in bytes.
+    /// \param transferCount The number of transfers that are in flight at the same time.
+    /// \return LIBUSB_SUCCESS or a libusb error code.
+    int startStreaming(unsigned transferSize = HANTEK_STREAM_TRANSFER_SIZE,
+                       unsigned transferCount = HANTEK_STREAM_TRANSFERS);
+
+    /// \brief Cancel the streaming transfers.
+    void stopStreaming();
+
+    inline bool isStreaming() const { return stream != nullptr; }
+
+    /// \brief Discard the buffered stream data, e.g. after the acquisition parameters were changed.
+    void flushStream();
+
+    /// \brief Read the next block from the stream started by startStreaming().
+    /// \param data Buffer for the received data.
+    /// \param length The requested number of bytes.
+    /// \param gap Set to true if samples are missing inside the block.
+    /// \return Number of received bytes on success, libusb error code on error.
+    int bulkReadStream(unsigned char *data, unsigned length, bool *gap = nullptr);
+
+    /// \return The stream object, nullptr if not streaming.
+    inline USBStream *getStream() const { return stream.get(); }
+
+    /// \brief Create a stream of the IN endpoint that is not started, e.g. to measure transfer configurations.
+    /// \return nullptr if the device is not connected.
+    std::unique_ptr<USBStream> createStream();
+
+    /// \return The counters of the bulk IN transfers since the device was created.
+    inline const TransferStatistics &getStatistics() const { return statistics; }
+
     /// \brief Control transfer to the oscilloscope.
     /// \param type The request type, also sets the direction of the transfer.
     /// \param request The request field of the packet.
@@ -130,6 +179,9 @@ class USBDevice : public QObject {
      */
     inline libusb_device *getRawDevice() const { return device; }
 
+    /// \return The libusb context of the device, nullptr for the default context.
+    inline libusb_context *getContext() const { return context; }
+
     /**
      * @return Return the unique usb device id {@link USBDevice::computeUSBdeviceID()}.
      */
@@ -164,13 +216,16 @@ class USBDevice : public QObject {
 
     // Libusb specific variables
     struct libusb_device_descriptor descriptor;
+    libusb_context *context; ///< The usb context used for asynchronous transfers
     libusb_device *device; ///< The USB handle for the oscilloscope
     libusb_device_handle *handle = nullptr;
     unsigned findIteration;
-    const unsigned long uniqueUSBdeviceID;
+    unsigned long uniqueUSBdeviceID;
     int interface;
     int outPacketLength; ///< Packet length for the OUT endpoint
     int inPacketLength;  ///< Packet length for the IN endpoint
+    std::unique_ptr<USBStream> stream; ///< Asynchronous IN transfers, see startStreaming()
+    TransferStatistics statistics;
 
   signals:
     void deviceDisconnected(); ///< The device has been disconnected
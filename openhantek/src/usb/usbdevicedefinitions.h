@@ -7,6 +7,11 @@
 #define HANTEK_ATTEMPTS 3         ///< The number of transfer attempts
 #define HANTEK_ATTEMPTS_MULTI 1   ///< The number of multi packet transfer attempts
 
+#define HANTEK_STREAM_TRANSFER_SIZE 16384 ///< Size of one asynchronous transfer in streaming mode
+#define HANTEK_STREAM_TRANSFERS 32        ///< Number of asynchronous transfers in flight
+#define HANTEK_STREAM_TRANSFER_SIZE_FAST 65536 ///< Transfer size for the highest streaming samplerates
+#define HANTEK_STREAM_TRANSFERS_FAST 64        ///< Transfers in flight for the highest streaming samplerates
+
 #define HANTEK_EP_OUT 0x02 ///< OUT Endpoint for bulk transfers
 #define HANTEK_EP_IN 0x86  ///< IN Endpoint for bulk transfers
 
@@ -0,0 +1,414 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "usbstream.h"
+
+#define MAX_GAPS 64 ///< Remembered gap positions, older ones are forgotten
+#define STOP_WARNING 1000 ///< Time in ms after that stop() reports transfers that did not return
+
+
+USBStream::USBStream(libusb_context *context, libusb_device_handle *handle, unsigned char endpoint)
+    : context(context), handle(handle), endpoint(endpoint) {
+    gaps.reserve(MAX_GAPS);
+    clock.start();
+}
+
+
+USBStream::~USBStream() { stop(); }
+
+
+unsigned char *USBStream::allocBuffer(unsigned size) {
+    unsigned char *buffer = nullptr;
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+    // memory that is mapped by the kernel driver avoids copying the data (Linux usbfs only)
+    if (handle)
+        buffer = libusb_dev_mem_alloc(handle, size);
+#endif
+    devMemBuffers.push_back(buffer != nullptr);
+    if (!buffer)
+        buffer = new unsigned char[size];
+    return buffer;
+}
+
+
+void USBStream::freeBuffers() {
+    for (size_t index = 0; index < buffers.size(); ++index) {
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+        if (devMemBuffers[index]) {
+            libusb_dev_mem_free(handle, buffers[index], transferSize);
+            continue;
+        }
+#endif
+        delete[] buffers[index];
+    }
+    buffers.clear();
+    devMemBuffers.clear();
+}
+
+
+int USBStream::start(unsigned transferSize, unsigned transferCount, unsigned fifoSize) {
+    if (isRunning())
+        return LIBUSB_SUCCESS;
+    if (!transferSize || !transferCount)
+        return LIBUSB_ERROR_INVALID_PARAM;
+
+    this->transferSize = transferSize;
+    lastError = LIBUSB_SUCCESS;
+    flush();
+    discard = 0; // nothing is in flight yet
+    resizeFifo(std::max(fifoSize, transferSize * transferCount));
+
+    transfers.assign(transferCount, nullptr);
+    // the device may have dropped data before the first transfer was queued
+    submitEpoch.assign(transferCount, starveEpoch);
+    dataEpoch = starveEpoch - 1;
+    lastCompletion = -1;
+    maxCompletionInterval = 0;
+    // no callback can run before the first transfer is submitted
+    for (unsigned index = 0; index < transferCount; ++index) {
+        buffers.push_back(allocBuffer(transferSize));
+        transfers[index] = libusb_alloc_transfer(0);
+        if (!transfers[index]) {
+            stop();
+            return LIBUSB_ERROR_NO_MEM;
+        }
+        libusb_fill_bulk_transfer(transfers[index], handle, endpoint, buffers[index], (int)transferSize,
+                                  transferCallback, this, 0);
+    }
+    int errorCode = LIBUSB_SUCCESS;
+    {
+        QMutexLocker locker(&lock);
+        running = true;
+        for (libusb_transfer *transfer : transfers) {
+            errorCode = submitTransfer(transfer);
+            if (errorCode < 0)
+                break;
+            ++pending;
+        }
+    }
+    if (errorCode < 0)
+        stop();
+    return errorCode;
+}
+
+
+void USBStream::stop() {
+    {
+        // a callback that runs meanwhile does not resubmit its transfer anymore
+        QMutexLocker locker(&lock);
+        running = false;
+    }
+    for (libusb_transfer *transfer : transfers) {
+        if (transfer)
+            cancelTransfer(transfer);
+    }
+    // The cancelled transfers are returned through the callback, libusb owns them until then and
+    // the callback refers to this stream. libusb returns each transfer, also if the device is gone.
+    QElapsedTimer timer;
+    timer.start();
+    bool warned = false;
+    for (unsigned left = pendingTransfers(); left; left = pendingTransfers()) {
+        if (!warned && timer.elapsed() > STOP_WARNING) {
+            qWarning("USBStream: %u transfers did not return after cancel yet", left);
+            warned = true;
+        }
+        handleEvents(10);
+    }
+    for (libusb_transfer *transfer : transfers) {
+        if (transfer)
+            libusb_free_transfer(transfer);
+    }
+    freeBuffers();
+    transfers.clear();
+}
+
+
+unsigned USBStream::pendingTransfers() const {
+    QMutexLocker locker(&lock);
+    return pending;
+}
+
+
+bool USBStream::isRunning() const {
+    QMutexLocker locker(&lock);
+    return running;
+}
+
+
+void USBStream::setSink(Sink sink) {
+    QMutexLocker locker(&lock);
+    this->sink = sink;
+}
+
+
+void USBStream::setExpectedRate(double bytesPerSecond) {
+    QMutexLocker locker(&lock);
+    if (bytesPerSecond == expectedRate)
+        return;
+    expectedRate = bytesPerSecond;
+    lastCompletion = -1;
+}
+
+
+int USBStream::handleEvents(unsigned timeout) {
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+    return libusb_handle_events_timeout_completed(context, &tv, nullptr);
+}
+
+
+int USBStream::submitTransfer(libusb_transfer *transfer) { return libusb_submit_transfer(transfer); }
+
+
+int USBStream::cancelTransfer(libusb_transfer *transfer) { return libusb_cancel_transfer(transfer); }
+
+
+void LIBUSB_CALL USBStream::transferCallback(libusb_transfer *transfer) {
+    static_cast<USBStream *>(transfer->user_data)->transferCompleted(transfer);
+}
+
+
+void USBStream::markGap(unsigned long long from, unsigned long long to) {
+    ++gapCount;
+    if (gaps.size() == MAX_GAPS)
+        gaps.erase(gaps.begin());
+    gaps.push_back(std::make_pair(from, to));
+}
+
+
+void USBStream::transferCompleted(libusb_transfer *transfer) {
+    // also held while the transfer is resubmitted, stop() can't cancel it in between
+    QMutexLocker locker(&lock);
+    const size_t slot = size_t(std::find(transfers.begin(), transfers.end(), transfer) - transfers.begin());
+
+    // The completions are handled in bursts. Between two bursts no transfer is resubmitted,
+    // if this took longer than the data of the whole ring the device had nowhere to put its samples.
+    const qint64 now = clock.nsecsElapsed();
+    if (lastCompletion >= 0)
+        maxCompletionInterval = std::max(maxCompletionInterval, now - lastCompletion);
+    if (expectedRate > 0 && lastCompletion >= 0 && transfers.size() > 1) {
+        const double ringTime = 1e9 * transferSize * (transfers.size() - 1) / expectedRate;
+        if (now - lastCompletion > ringTime)
+            ++starveEpoch; // the data of the transfers resubmitted from now on follows a gap
+    }
+    lastCompletion = now;
+
+    if (statistics && transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+        statistics->transfers.fetchAndAddRelaxed(1);
+        if (transfer->status == LIBUSB_TRANSFER_TIMED_OUT)
+            statistics->timeouts.fetchAndAddRelaxed(1);
+        else if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+            statistics->errors.fetchAndAddRelaxed(1);
+        if (running && transfer->status != LIBUSB_TRANSFER_COMPLETED && transfer->status != LIBUSB_TRANSFER_NO_DEVICE)
+            statistics->retries.fetchAndAddRelaxed(1); // resubmitted below
+    }
+
+    switch (transfer->status) {
+    case LIBUSB_TRANSFER_TIMED_OUT: // may contain valid data
+        ++errors;
+        ++starveEpoch;
+        // fall through
+    case LIBUSB_TRANSFER_COMPLETED:
+        if (transfer->actual_length > 0) {
+            unsigned length = (unsigned)transfer->actual_length;
+            bytesReceived += length;
+            if (statistics)
+                statistics->bytes.fetchAndAddRelaxed(length);
+            const unsigned char *src = transfer->buffer;
+            if (discard) { // acquired before flush()
+                const unsigned dropped = unsigned(std::min<unsigned long long>(discard, length));
+                discard -= dropped;
+                src += dropped;
+                length -= dropped;
+            }
+            if (sink) {
+                if (length)
+                    sink(src, length);
+            } else if (length) {
+                if (slot < submitEpoch.size() && submitEpoch[slot] != dataEpoch) {
+                    // First data after the ring ran empty. The device FIFO still held some older
+                    // packets, so the gap is somewhere inside this transfer.
+                    dataEpoch = submitEpoch[slot];
+                    markGap(readPosition + fifoCount, readPosition + fifoCount + length);
+                }
+                const unsigned size = (unsigned)fifo.size();
+                unsigned count = length;
+                if (count > size) { // keep only the newest data
+                    overruns += fifoCount + count - size;
+                    readPosition += fifoCount + count - size;
+                    fifoHead = 0;
+                    fifoCount = 0;
+                    src += count - size;
+                    count = size;
+                    broken = true;
+                }
+                if (fifoCount + count > size) { // drop the oldest data
+                    const unsigned overflow = fifoCount + count - size;
+                    overruns += overflow;
+                    readPosition += overflow;
+                    fifoHead = (fifoHead + overflow) % size;
+                    fifoCount -= overflow;
+                    broken = true; // the next read does not continue the last one
+                }
+                const unsigned tail = (fifoHead + fifoCount) % size;
+                const unsigned first = std::min(count, size - tail);
+                memcpy(fifo.data() + tail, src, first);
+                memcpy(fifo.data(), src + first, count - first);
+                fifoCount += count;
+            }
+        }
+        if (running) {
+            if (slot < submitEpoch.size())
+                submitEpoch[slot] = starveEpoch;
+            int errorCode = submitTransfer(transfer);
+            if (errorCode == LIBUSB_SUCCESS)
+                return;
+            lastError = errorCode;
+        }
+        break;
+    case LIBUSB_TRANSFER_CANCELLED:
+        break;
+    case LIBUSB_TRANSFER_NO_DEVICE:
+        lastError = LIBUSB_ERROR_NO_DEVICE;
+        running = false;
+        break;
+    default: // error, stall or overflow, the data of this transfer is lost
+        ++errors;
+        ++starveEpoch;
+        lastError = LIBUSB_ERROR_IO;
+        if (running) {
+            if (slot < submitEpoch.size())
+                submitEpoch[slot] = starveEpoch;
+            if (submitTransfer(transfer) == LIBUSB_SUCCESS)
+                return;
+        }
+        break;
+    }
+    --pending; // this transfer is not resubmitted
+}
+
+
+int USBStream::read(unsigned char *data, unsigned length, unsigned timeout, bool *gap) {
+    if (fifo.size() < 2 * length) // buffer at least two captures
+        resizeFifo(2 * length);
+
+    // resubmit the completed transfers even if the FIFO holds enough data
+    handleEvents(0);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        {
+            QMutexLocker locker(&lock);
+            if (fifoCount >= length) {
+                const unsigned size = (unsigned)fifo.size();
+                const unsigned first = std::min(length, size - fifoHead);
+                memcpy(data, fifo.data() + fifoHead, first);
+                memcpy(data + first, fifo.data(), length - first);
+                fifoHead = (fifoHead + length) % size;
+                fifoCount -= length;
+                const unsigned long long start = readPosition;
+                readPosition += length;
+                bool hasGap = broken && !blockStart;
+                broken = false;
+                blockStart = false;
+                for (const auto &range : gaps)
+                    hasGap |= range.first < readPosition && range.second > start;
+                // forget the gaps that lie completely before the next block
+                auto it = gaps.begin();
+                while (it != gaps.end() && it->second <= readPosition)
+                    ++it;
+                gaps.erase(gaps.begin(), it);
+                if (gap)
+                    *gap = hasGap;
+                return (int)length;
+            }
+        }
+        {
+            QMutexLocker locker(&lock);
+            if (!running || !pending)
+                return lastError != LIBUSB_SUCCESS ? lastError : LIBUSB_ERROR_IO;
+        }
+        const qint64 elapsed = timer.elapsed();
+        if (elapsed >= timeout)
+            return LIBUSB_ERROR_TIMEOUT;
+        int errorCode = handleEvents(unsigned(timeout - elapsed));
+        if (errorCode < 0 && errorCode != LIBUSB_ERROR_INTERRUPTED)
+            return errorCode;
+    }
+}
+
+
+unsigned long long USBStream::getBytesReceived() const {
+    QMutexLocker locker(&lock);
+    return bytesReceived;
+}
+
+
+unsigned long long USBStream::getOverruns() const {
+    QMutexLocker locker(&lock);
+    return overruns;
+}
+
+
+unsigned USBStream::getErrors() const {
+    QMutexLocker locker(&lock);
+    return errors;
+}
+
+
+unsigned USBStream::getGaps() const {
+    QMutexLocker locker(&lock);
+    return gapCount;
+}
+
+
+qint64 USBStream::getMaxCompletionInterval() const {
+    QMutexLocker locker(&lock);
+    return maxCompletionInterval;
+}
+
+
+void USBStream::flush() {
+    QMutexLocker locker(&lock);
+    readPosition += fifoCount;
+    fifoHead = 0;
+    fifoCount = 0;
+    gaps.clear();
+    broken = true;
+    // the transfers in flight may be filled already, the device FIFO holds the packets after them
+    discard = (unsigned long long)transferSize * transfers.size() + STREAM_DEVICE_FIFO;
+}
+
+
+void USBStream::startBlock() {
+    QMutexLocker locker(&lock);
+    blockStart = true;
+}
+
+
+unsigned USBStream::available() const {
+    QMutexLocker locker(&lock);
+    return fifoCount;
+}
+
+
+void USBStream::resizeFifo(unsigned size) {
+    QMutexLocker locker(&lock);
+    std::vector<unsigned char> newFifo(size);
+    const unsigned oldSize = (unsigned)fifo.size();
+    const unsigned count = std::min(fifoCount, size); // keep the newest bytes
+    for (unsigned index = 0; index < count; ++index)
+        newFifo[index] = fifo[(fifoHead + fifoCount - count + index) % oldSize];
+    readPosition += fifoCount - count;
+    if (count < fifoCount)
+        broken = true;
+    fifo.swap(newFifo);
+    fifoHead = 0;
+    fifoCount = count;
+}
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#ifdef __FreeBSD__
+	#include <libusb.h>
+#else
+	#include <libusb-1.0/libusb.h>
+#endif
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QMutex>
+
+#include "transferstatistics.h"
+
+#define STREAM_DEVICE_FIFO 4096 ///< Bytes the device may still hold after a change of its settings
+
+/// \brief Ring of asynchronous bulk IN transfers that keeps the device FIFO drained.
+/// All transfers are submitted by start() and resubmitted from their completion callback as soon
+/// as their data is handed over, so the USB pipe never idles while the samples are processed.
+/// The received data is either handed to a sink callback or appended to a byte FIFO that is
+/// consumed in order by read(). If the consumer is too slow the oldest FIFO data is overwritten
+/// and counted as overrun.
+///
+/// The device has no flow control, it drops samples if no transfer is queued when its small
+/// internal FIFO is full. If the expected data rate is set, the stream detects when the ring
+/// may have run empty and marks the position of the possible gap, read() reports blocks that
+/// contain such a gap. Data that is dropped by the stream itself, i.e. FIFO overruns and flush(),
+/// breaks the continuity of two consecutive reads, this is reported as a gap of the next read
+/// unless startBlock() declared it as the beginning of an independent block.
+///
+/// libusb runs the completion callbacks in whichever thread handles the events of the context, e.g.
+/// the acquisition thread of another device. All state that the callbacks change is guarded by a mutex
+/// that is never held while the events are handled.
+class USBStream {
+  public:
+    /// Receives the data of each completed transfer in the thread that handles the libusb events,
+    /// the stream is locked during the call.
+    typedef std::function<void(const unsigned char *data, unsigned length)> Sink;
+
+    USBStream(libusb_context *context, libusb_device_handle *handle, unsigned char endpoint);
+    USBStream(const USBStream &) = delete;
+    virtual ~USBStream();
+
+    /// \brief Allocate and submit the transfer ring.
+    /// \param transferSize The size of one transfer in bytes, should be a multiple of the packet size.
+    /// \param transferCount The number of transfers that are in flight at the same time.
+    /// \param fifoSize The initial size of the FIFO that buffers the received data.
+    /// \return LIBUSB_SUCCESS or a libusb error code.
+    int start(unsigned transferSize, unsigned transferCount, unsigned fifoSize);
+
+    /// \brief Cancel all transfers and wait until they are returned by libusb.
+    /// The transfers and their buffers are only freed after libusb handed them back, this also waits
+    /// for a device that reacts slowly to the cancellation.
+    void stop();
+
+    bool isRunning() const;
+    inline unsigned getTransferSize() const { return transferSize; }
+    inline unsigned getTransferCount() const { return unsigned(transfers.size()); }
+
+    /// \brief Set a callback that gets the data instead of the FIFO, nullptr restores the FIFO.
+    void setSink(Sink sink);
+
+    /// \brief Count the transfers also in the statistics of the device, nullptr stops counting.
+    inline void setStatistics(TransferStatistics *statistics) { this->statistics = statistics; }
+
+    /// \brief Set the rate the device produces data with, enables the gap detection.
+    /// \param bytesPerSecond The data rate, 0 disables the gap detection.
+    void setExpectedRate(double bytesPerSecond);
+
+    /// \brief Process libusb events, i.e. run the completion callbacks of finished transfers.
+    /// \param timeout The maximum time to wait for an event in ms.
+    /// \return LIBUSB_SUCCESS or a libusb error code.
+    virtual int handleEvents(unsigned timeout);
+
+    /// \brief Read the next length bytes of the stream.
+    /// Blocks and processes events until enough data was received or the timeout expired.
+    /// \param data Buffer for the received data.
+    /// \param length The requested number of bytes.
+    /// \param timeout The timeout in ms.
+    /// \param gap Set to true if the data has a gap, i.e. samples are missing inside the block.
+    /// \return Number of received bytes on success, libusb error code on error.
+    int read(unsigned char *data, unsigned length, unsigned timeout, bool *gap = nullptr);
+
+    /// \brief Discard all buffered data, e.g. after the device settings were changed.
+    /// The transfers that are in flight and the device FIFO still hold data of the old settings,
+    /// the next ring plus STREAM_DEVICE_FIFO bytes that arrive are dropped as well.
+    void flush();
+
+    /// \brief The next read() starts a block that does not continue the previous one.
+    /// Data that was dropped before it is not reported as gap, e.g. the overruns between two captures.
+    void startBlock();
+
+    /// \return The number of bytes that are currently buffered.
+    unsigned available() const;
+
+    unsigned long long getBytesReceived() const; ///< Total bytes transferred
+    unsigned long long getOverruns() const;      ///< Bytes lost due to FIFO overrun
+    unsigned getErrors() const;                  ///< Failed or timed out transfers
+    unsigned getGaps() const;                    ///< Detected gaps of the device data
+    /// Longest time between two transfer completions since start() in ns, the worst host latency
+    qint64 getMaxCompletionInterval() const;
+
+  protected:
+    /// \brief Queue a transfer, overridden by the simulated device of the stream benchmark.
+    virtual int submitTransfer(libusb_transfer *transfer);
+    /// \brief Cancel a queued transfer.
+    virtual int cancelTransfer(libusb_transfer *transfer);
+
+    static void LIBUSB_CALL transferCallback(libusb_transfer *transfer);
+
+  private:
+    void transferCompleted(libusb_transfer *transfer);
+    unsigned pendingTransfers() const;
+    void resizeFifo(unsigned size);
+    void markGap(unsigned long long from, unsigned long long to);
+    unsigned char *allocBuffer(unsigned size);
+    void freeBuffers();
+
+    libusb_context *context;
+    libusb_device_handle *handle;
+    const unsigned char endpoint;
+
+    /// Guards the members below that the callbacks use. The transfers and buffers are only changed by
+    /// start() and stop() while no transfer is submitted.
+    mutable QMutex lock;
+
+    std::vector<libusb_transfer *> transfers;
+    std::vector<unsigned char *> buffers;
+    std::vector<bool> devMemBuffers;           ///< Buffer was allocated with libusb_dev_mem_alloc
+    std::vector<unsigned> submitEpoch;         ///< Value of starveEpoch when the transfer was submitted
+    unsigned transferSize = 0;
+    unsigned pending = 0;    ///< Transfers that are submitted and not yet returned
+    bool running = false;
+    int lastError = LIBUSB_SUCCESS;
+
+    Sink sink;
+
+    std::vector<unsigned char> fifo; ///< Circular buffer of received but not yet read bytes
+    unsigned fifoHead = 0;           ///< Read position
+    unsigned fifoCount = 0;          ///< Number of valid bytes
+    unsigned long long readPosition = 0;      ///< Stream position of the FIFO head
+    unsigned long long discard = 0;  ///< Received bytes that are dropped, see flush()
+    bool broken = false;             ///< Data was dropped since the last read
+    bool blockStart = false;         ///< The next read does not continue the last one
+    /// Stream position ranges that contain a gap
+    std::vector<std::pair<unsigned long long, unsigned long long>> gaps;
+
+    // Gap detection
+    double expectedRate = 0.0;       ///< Device data rate in bytes per second
+    QElapsedTimer clock;
+    qint64 lastCompletion = -1;      ///< clock time of the last completion in ns
+    qint64 maxCompletionInterval = 0;
+    unsigned starveEpoch = 0;        ///< Incremented each time the ring may have run empty
+    unsigned dataEpoch = 0;          ///< starveEpoch of the transfer that delivered the last data
+
+    unsigned long long bytesReceived = 0;
+    unsigned long long overruns = 0;
+    unsigned errors = 0;
+    unsigned gapCount = 0;
+    TransferStatistics *statistics = nullptr;
+};
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+#if defined Q_OS_WIN
+#include <windows.h>
+#elif defined Q_OS_UNIX
+#include <pthread.h>
+#include <sched.h>
+#endif
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "threadscheduling.h"
+
+namespace {
+
+/// \brief Raise the calling thread to the highest normal priority.
+/// \return Empty on success, the reason otherwise.
+QString raisePriority() {
+#ifdef __linux__
+    // the nice value of a Linux thread is set by its thread id
+    if (setpriority(PRIO_PROCESS, id_t(syscall(SYS_gettid)), THREAD_HIGH_NICE) != 0)
+        return QString::fromLocal8Bit(strerror(errno));
+#else
+    QThread::currentThread()->setPriority(QThread::TimeCriticalPriority);
+#endif
+    return QString();
+}
+
+} // namespace
+
+
+bool ThreadScheduling::parsePolicy(const QString &text) {
+    const QStringList parts = text.trimmed().toLower().split(':');
+    if (parts.size() == 1 && (parts[0] == "normal" || parts[0].isEmpty())) {
+        policy = Policy::NORMAL;
+        return true;
+    }
+    if (parts.size() == 1 && parts[0] == "high") {
+        policy = Policy::HIGH;
+        return true;
+    }
+    if (parts.size() != 2 || (parts[0] != "fifo" && parts[0] != "rr"))
+        return false;
+    bool ok = false;
+    const int value = parts[1].toInt(&ok);
+    if (!ok || value < 1 || value > 99)
+        return false;
+    policy = parts[0] == "fifo" ? Policy::FIFO : Policy::ROUND_ROBIN;
+    priority = value;
+    return true;
+}
+
+
+bool ThreadScheduling::parseCpus(const QString &text) {
+    std::vector<unsigned> list;
+    for (const QString &item : text.split(',', QString::SkipEmptyParts)) {
+        const QStringList range = item.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = false;
+        const unsigned first = range[0].toUInt(&firstOk);
+        const unsigned last = range.size() == 2 ? range[1].toUInt(&lastOk) : first;
+        if (!firstOk || (range.size() == 2 && !lastOk) || range.size() > 2 || last < first || last > 1023)
+            return false;
+        for (unsigned cpu = first; cpu <= last; ++cpu)
+            list.push_back(cpu);
+    }
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    cpus = list;
+    return true;
+}
+
+
+bool ThreadScheduling::apply(QString &message) const {
+    bool ok = true;
+    QStringList applied;
+    if (!cpus.empty()) {
+        QString error;
+#if defined __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned cpu : cpus)
+            if (cpu < CPU_SETSIZE)
+                CPU_SET(cpu, &set);
+        const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (result)
+            error = QString::fromLocal8Bit(strerror(result));
+#elif defined Q_OS_WIN
+        DWORD_PTR mask = 0;
+        for (unsigned cpu : cpus)
+            if (cpu < sizeof(mask) * 8)
+                mask |= DWORD_PTR(1) << cpu;
+        if (!SetThreadAffinityMask(GetCurrentThread(), mask))
+            error = QString("error %1").arg(GetLastError());
+#else
+        error = "not supported";
+#endif
+        QStringList list;
+        for (unsigned cpu : cpus)
+            list << QString::number(cpu);
+        if (error.isEmpty()) {
+            applied << QString("CPUs %1").arg(list.join(','));
+        } else {
+            applied << QString("CPUs %1 failed (%2)").arg(list.join(',')).arg(error);
+            ok = false;
+        }
+    }
+
+    switch (policy) {
+    case Policy::FIFO:
+    case Policy::ROUND_ROBIN: {
+        QString error;
+#if defined Q_OS_UNIX
+        const int schedPolicy = policy == Policy::FIFO ? SCHED_FIFO : SCHED_RR;
+        sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority =
+            std::max(sched_get_priority_min(schedPolicy), std::min(priority, sched_get_priority_max(schedPolicy)));
+        const int result = pthread_setschedparam(pthread_self(), schedPolicy, &param);
+        if (!result) {
+            applied << toString();
+            break;
+        }
+        error = QString::fromLocal8Bit(strerror(result)); // EPERM without CAP_SYS_NICE or RLIMIT_RTPRIO
+#else
+        error = "not supported";
+#endif
+        applied << QString("%1 not permitted (%2)").arg(toString()).arg(error);
+        ok = false;
+    }
+    // fall through
+    case Policy::HIGH: {
+        const QString error = raisePriority();
+        if (error.isEmpty()) {
+            applied << "high priority";
+        } else {
+            applied << QString("high priority not permitted (%1), normal priority").arg(error);
+            ok = false;
+        }
+        break;
+    }
+    case Policy::NORMAL:
+        break;
+    }
+    message = applied.join(", ");
+    return ok;
+}
+
+
+QString ThreadScheduling::toString() const {
+    switch (policy) {
+    case Policy::NORMAL:
+        return "normal";
+    case Policy::HIGH:
+        return "high";
+    case Policy::FIFO:
+        return QString("fifo:%1").arg(priority);
+    case Policy::ROUND_ROBIN:
+        return QString("rr:%1").arg(priority);
+    }
+    return QString();
+}
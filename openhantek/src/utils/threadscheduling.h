@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+#pragma once
+
+#include <QString>
+#include <vector>
+
+#define THREAD_HIGH_NICE -10 ///< Nice value of the HIGH policy and of the fallback of the real-time policies
+
+/// \brief Priority and CPU affinity of a thread, e.g. of the acquisition or the post processing.
+struct ThreadScheduling {
+    enum class Policy {
+        NORMAL,     ///< Leave the thread as it is
+        HIGH,       ///< Highest normal priority
+        FIFO,       ///< Real-time SCHED_FIFO with priority
+        ROUND_ROBIN ///< Real-time SCHED_RR with priority
+    };
+    Policy policy = Policy::NORMAL;
+    int priority = 0;           ///< Real-time priority of FIFO and ROUND_ROBIN, 1..99 on Linux
+    std::vector<unsigned> cpus; ///< The CPUs the thread may run on, empty = all
+
+    /// \brief Parse "normal", "high", "fifo:<priority>" or "rr:<priority>".
+    /// \return false if the text is invalid.
+    bool parsePolicy(const QString &text);
+    /// \brief Parse a list of CPUs and CPU ranges like "2,3" or "1-3", empty = all.
+    /// \return false if the text is invalid.
+    bool parseCpus(const QString &text);
+
+    bool isDefault() const { return policy == Policy::NORMAL && cpus.empty(); }
+
+    /// \brief Apply the scheduling to the calling thread.
+    /// A real-time policy that is not permitted falls back to HIGH, a HIGH that is not permitted
+    /// leaves the normal priority.
+    /// \param message Set to the description of the applied scheduling and of the fallbacks.
+    /// \return false if something could not be applied as requested.
+    bool apply(QString &message) const;
+
+    QString toString() const;
+};
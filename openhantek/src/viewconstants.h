@@ -2,12 +2,31 @@
 
 #pragma once
 
-#define SAMPLESIZE_USED 20000
+#define RECORDLENGTH_DEFAULT 20000 ///< Samples per channel of one acquisition
+#define RECORDLENGTH_MAX 5000000   ///< Longest selectable record
+#define RECORDLENGTH_RAW_MAX (64 << 20) ///< Limits the record length with high downsampling (bytes)
 
 #define DIVS_TIME 10.0   ///< Number of horizontal screen divs
 #define DIVS_VOLTAGE 8.0 ///< Number of vertical screen divs
 #define DIVS_SUB 5       ///< Number of sub-divisions per div
 
+#define ROLL_TIMEBASE_MIN 0.1 ///< Timebases from 100 ms/div on are shown in roll mode (AUTO trigger)
+#define TIMEBASE_MAX 10.0     ///< Slowest selectable timebase in s/div
+
+#define SEGMENT_COUNT_MAX 1000           ///< Most segments of one segmented acquisition
+#define SEGMENT_LENGTH_MIN 100           ///< Shortest segment in samples per channel
+#define SEGMENT_LENGTH_DEFAULT 10000     ///< Samples per channel of one segment
+#define SEGMENT_ARENA_MAX (16 << 20)     ///< Limits segment count * length (samples per channel)
+
+#define ETS_FACTOR_MAX 50 ///< Finest equivalent-time sampling grid in bins per sample interval
+
+#define AVERAGE_COUNT_MAX 1000       ///< Most frames of an average
+#define AVERAGE_ARENA_MAX (16 << 20) ///< Limits frames * channels * length of the linear average (samples)
+
+#define HISTORY_MEMORY_DEFAULT 64   ///< Memory for the raw data of the acquisition history in MiB
+#define HISTORY_MEMORY_MAX 4096     ///< Largest selectable history memory in MiB
+#define HISTORY_FRAMES_MAX 1000     ///< Most acquisitions kept in the history, independent of their size
+
 #define MARGIN_LEFT (-DIVS_TIME / 2.0)
 #define MARGIN_RIGHT (DIVS_TIME / 2.0)
 
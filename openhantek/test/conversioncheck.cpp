@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+// Check of the raw sample conversion and of the raw domain trigger, run by ctest.
+// RawConverter::convert() and its scalar variant have to give the same voltages as the conversion
+// of HantekDsoControl::convertRawDataToSamples() before the RawConverter, for one and two channels,
+// several downsampling factors, calibrations and positions across the chunk boundaries of the raw
+// buffer. The raw domain trigger has to find the same samples beyond the trigger level as a
+// comparison of the converted voltages. Prints the mismatches and the speed of the conversions.
+// Exits with 0 if all results agree, 1 otherwise.
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+#include "bufferpool.h"
+#include "rawconverter.h"
+#include "rawtrigger.h"
+
+#define TOLERANCE 1e-6 ///< Relative deviation of a float sample from the double precision baseline
+
+using namespace Dso;
+
+namespace {
+
+struct Calibration {
+    double offsetError;
+    unsigned short limit;
+    double offset;
+    double scale;
+};
+
+/// \brief The conversion of one channel of the original HantekDsoControl::convertRawDataToSamples().
+/// The raw values of a bucket are summed in double precision, the average is calibrated. The envelope
+/// is the minimum and maximum of the calibrated raw values of each bucket, nullptr skips it.
+/// \return true if a raw sample is at the limit of the ADC range.
+bool convertBaseline(const std::vector<unsigned char> &rawData, size_t position, unsigned stride,
+                     unsigned downsampling, unsigned count, const Calibration &calibration, double *samples,
+                     double *peakMin, double *peakMax) {
+    bool clipped = false;
+    size_t rawBufferPosition = position;
+    for (unsigned index = 0; index < count; ++index, rawBufferPosition += stride * downsampling) {
+        double sample = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        for (unsigned iii = 0; iii < downsampling * stride; iii += stride) {
+            int rawSample = rawData[rawBufferPosition + iii]; // range 0...255
+            if (rawSample == 0x00 || rawSample == 0xFF) // min or max -> clipped
+                clipped = true;
+            sample += (double)rawSample - calibration.offsetError;
+            if (!peakMin)
+                continue;
+            const double voltage =
+                (((double)rawSample - calibration.offsetError) / calibration.limit - calibration.offset) *
+                calibration.scale;
+            min = iii ? std::min(min, voltage) : voltage;
+            max = iii ? std::max(max, voltage) : voltage;
+        }
+        sample /= downsampling;
+        samples[index] = (sample / calibration.limit - calibration.offset) * calibration.scale;
+        if (peakMin) {
+            peakMin[index] = min;
+            peakMax[index] = max;
+        }
+    }
+    return clipped;
+}
+
+
+bool agrees(const std::vector<float> &values, const std::vector<double> &reference) {
+    for (size_t index = 0; index < values.size(); ++index) {
+        if (std::fabs(values[index] - reference[index]) > TOLERANCE * std::max(1.0, std::fabs(reference[index])))
+            return false;
+    }
+    return values.size() == reference.size();
+}
+
+
+/// \brief Conversion time in ms of one record with count samples per channel.
+/// \param peakDetect Keep the envelope as well.
+double measure(const RawConverter &converter, const RawBuffer &rawData, unsigned stride, unsigned downsampling,
+               unsigned count, bool scalar, bool peakDetect = false) {
+    std::vector<float> samples(count), peakMin(count), peakMax(count);
+    float *low = peakDetect ? peakMin.data() : nullptr;
+    float *high = peakDetect ? peakMax.data() : nullptr;
+    const unsigned repeat = 20;
+    QElapsedTimer timer;
+    for (unsigned run = 0; run <= repeat; ++run) {
+        if (run == 1) // the first run only faults the pages of the output in
+            timer.start();
+        for (unsigned channel = 0; channel < stride; ++channel) {
+            if (scalar)
+                converter.convertScalar(rawData, channel, stride, downsampling, count, samples.data(), low, high);
+            else
+                converter.convert(rawData, channel, stride, downsampling, count, samples.data(), low, high);
+        }
+    }
+    return timer.nsecsElapsed() / 1e6 / repeat;
+}
+
+
+/// \brief Time in ms of the baseline conversion of one record with count samples per channel.
+double measureBaseline(const std::vector<unsigned char> &rawData, const Calibration &calibration, unsigned stride,
+                       unsigned downsampling, unsigned count) {
+    std::vector<double> samples(count);
+    const unsigned repeat = 20;
+    QElapsedTimer timer;
+    for (unsigned run = 0; run <= repeat; ++run) {
+        if (run == 1)
+            timer.start();
+        for (unsigned channel = 0; channel < stride; ++channel)
+            convertBaseline(rawData, channel, stride, downsampling, count, calibration, samples.data(), nullptr,
+                            nullptr);
+    }
+    return timer.nsecsElapsed() / 1e6 / repeat;
+}
+
+
+/// \brief Compare the cached edge search with the scalar reference, like softwareTrigger() and
+/// captureSegments() use it: a search of one slope, continued from each found edge.
+/// \return The number of mismatches.
+unsigned long checkSearch(RawTrigger &trigger, unsigned sampleSet, unsigned threshold) {
+    const unsigned to = unsigned(trigger.size()) - 2 * (sampleSet + 1);
+    unsigned long mismatches = 0;
+    for (int slope : {1, -1}) {
+        for (unsigned from : {0u, 5u, 1000u}) {
+            for (unsigned edges = 0; edges < 1000 && from < to; ++edges) {
+                const unsigned found = trigger.search(slope, from, to, sampleSet, threshold);
+                const unsigned reference = trigger.searchScalar(slope, from, to, sampleSet, threshold);
+                // the following edge of the other slope gives the pulse width
+                const unsigned other = trigger.search(-slope, found, to, sampleSet, threshold);
+                if (found != reference || other != trigger.searchScalar(-slope, found, to, sampleSet, threshold)) {
+                    ++mismatches;
+                    printf("  search mismatch: slope %d, from %u, found %u, reference %u\n", slope, from, found,
+                           reference);
+                    break;
+                }
+                if (!found)
+                    break;
+                from = found + 1;
+            }
+        }
+    }
+    return mismatches;
+}
+
+
+/// \brief Time in ms to find all edges of one slope with the cached search or the scalar reference.
+double measureSearch(RawTrigger &trigger, const RawConverter &converter, double level, unsigned sampleSet,
+                     unsigned threshold, bool scalar) {
+    const unsigned to = unsigned(trigger.size()) - 2 * (sampleSet + 1);
+    const unsigned repeat = 20;
+    QElapsedTimer timer;
+    timer.start();
+    for (unsigned run = 0; run < repeat; ++run) {
+        trigger.setLevel(converter, 1, level); // a new block, the cache is empty
+        for (unsigned from = 0; from < to;) {
+            const unsigned found = scalar ? trigger.searchScalar(1, from, to, sampleSet, threshold)
+                                          : trigger.search(1, from, to, sampleSet, threshold);
+            if (!found)
+                break;
+            from = found + 1;
+        }
+    }
+    return timer.nsecsElapsed() / 1e6 / repeat;
+}
+
+} // namespace
+
+
+int main() {
+    const size_t rawSize = 5 * RAW_CHUNK_SIZE / 2; // spans three chunks
+    RawBufferPool pool;
+    RawBuffer *rawData = pool.lease(rawSize);
+    std::vector<unsigned char> contiguous; // the baseline reads a single vector
+    std::mt19937 random(6022);
+    for (size_t chunk = 0; chunk < rawData->chunkCount(); ++chunk) {
+        unsigned char *data = rawData->chunk(chunk);
+        for (size_t index = 0; index < rawData->chunkSize(chunk); ++index) // mostly in range, some clipped
+            data[index] = (unsigned char)std::max(0, std::min(255, int(128 + (int(random() % 301) - 150))));
+        contiguous.insert(contiguous.end(), data, data + rawData->chunkSize(chunk));
+    }
+
+    const Calibration calibrations[] = {
+        {0.0, 20, 0.0, 1.0}, {-1.25, 20, 0.5, 5.0 * 1.03}, {2.75, 40, -0.25, -2.0 * 0.97 * 10}, {0.4, 160, 0.0, 0.02}};
+    const unsigned downsamplings[] = {1, 2, 3, 4, 5, 8, 9, 10, 17, 31, 32, 100, 1000};
+    const size_t positions[] = {0, 1, 4096, RAW_CHUNK_SIZE - 33, RAW_CHUNK_SIZE - 1, 2 * RAW_CHUNK_SIZE - 5000};
+
+    unsigned long cases = 0;
+    unsigned long mismatches = 0;
+    RawConverter converter;
+    for (const Calibration &calibration : calibrations) {
+        converter.setCalibration(calibration.offsetError, calibration.limit, calibration.offset, calibration.scale);
+        for (unsigned stride = 1; stride <= 2; ++stride) {
+            for (unsigned downsampling : downsamplings) {
+                for (size_t position : positions) {
+                    const unsigned count = unsigned((rawSize - position) / stride / downsampling);
+                    for (unsigned length : {count, std::min(count, 37u)}) {
+                        std::vector<double> refSamples(length), refMin(length), refMax(length);
+                        const bool refClipped =
+                            convertBaseline(contiguous, position, stride, downsampling, length, calibration,
+                                            refSamples.data(), refMin.data(), refMax.data());
+                        for (bool scalar : {false, true}) {
+                            std::vector<float> samples(length), peakMin(length), peakMax(length);
+                            const bool clipped =
+                                scalar ? converter.convertScalar(*rawData, position, stride, downsampling, length,
+                                                                 samples.data(), peakMin.data(), peakMax.data())
+                                       : converter.convert(*rawData, position, stride, downsampling, length,
+                                                           samples.data(), peakMin.data(), peakMax.data());
+                            ++cases;
+                            if (clipped != refClipped || !agrees(samples, refSamples) || !agrees(peakMin, refMin) ||
+                                !agrees(peakMax, refMax)) {
+                                ++mismatches;
+                                printf("  mismatch%s: scale %g, stride %u, downsampling %u, position %zu, count %u\n",
+                                       scalar ? " (scalar)" : "", calibration.scale, stride, downsampling, position,
+                                       length);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    // an unchanged calibration must not rebuild the table
+    const unsigned long builds = converter.getTableBuilds();
+    const Calibration &last = calibrations[3];
+    converter.setCalibration(last.offsetError, last.limit, last.offset, last.scale);
+    if (converter.getTableBuilds() != builds) {
+        ++mismatches;
+        printf("  the table was rebuilt for an unchanged calibration\n");
+    }
+    // the trigger search in the raw domain has to agree with a comparison of the converted samples
+    RawTrigger trigger;
+    for (const Calibration &calibration : calibrations) {
+        converter.setCalibration(calibration.offsetError, calibration.limit, calibration.offset, calibration.scale);
+        for (unsigned downsampling : {1u, 3u, 10u, 100u}) {
+            ConversionParameters parameters;
+            parameters.position = RAW_CHUNK_SIZE - 999; // crosses a chunk boundary
+            parameters.stride = 2;
+            parameters.downsampling = downsampling;
+            parameters.count = 20000 / downsampling;
+            std::vector<float> samples(parameters.count);
+            converter.convert(*rawData, parameters.position + 1, 2, downsampling, parameters.count, samples.data());
+            trigger.prepare(*rawData, parameters, 1);
+            // levels between the samples, on the samples and outside of the ADC range
+            const double levels[] = {0.0, samples[7], samples[100], 0.5 * (samples[7] + samples[100]), 1e3, -1e3};
+            for (double level : levels) {
+                trigger.setLevel(converter, downsampling, level);
+                ++cases;
+                for (unsigned index = 0; index < parameters.count; ++index) {
+                    const bool rising = 1 * samples[index] >= 1 * level;
+                    const bool falling = -1 * samples[index] >= -1 * level;
+                    if (trigger.reached(index, 1) != rising || trigger.reached(index, -1) != falling) {
+                        ++mismatches;
+                        printf("  trigger mismatch: scale %g, downsampling %u, level %g, sample %u\n",
+                               calibration.scale, downsampling, level, index);
+                        break;
+                    }
+                }
+                // the edge search without and with smoothing
+                cases += 2;
+                mismatches += checkSearch(trigger, 1, 0) + checkSearch(trigger, 10, 5);
+            }
+        }
+    }
+    printf("Conversion check: %lu cases, %lu mismatches\n", cases, mismatches);
+
+    const unsigned record = 1000000; // raw samples per channel
+    for (unsigned stride = 1; stride <= 2; ++stride) {
+        for (unsigned downsampling : {1u, 3u, 10u, 100u}) {
+            const unsigned count = record / downsampling;
+            // the peak detect shall cost no more than the averaging of the baseline
+            printf("  %u channel(s), downsampling %4u: %6.2f ms, peak detect %6.2f ms, scalar %6.2f ms, baseline "
+                   "%6.2f ms per %u samples\n",
+                   stride, downsampling, measure(converter, *rawData, stride, downsampling, count, false),
+                   measure(converter, *rawData, stride, downsampling, count, false, downsampling > 1),
+                   measure(converter, *rawData, stride, downsampling, count, true),
+                   measureBaseline(contiguous, calibrations[3], stride, downsampling, count), record);
+        }
+    }
+
+    // edge search on a noisy sine with 100 periods per 20000 samples, the level 6.4 V is its center
+    const size_t sineSize = 2000000;
+    RawBuffer *sine = pool.lease(sineSize);
+    for (size_t index = 0; index < sineSize; ++index)
+        sine->chunk(index >> RAW_CHUNK_SHIFT)[index & (RAW_CHUNK_SIZE - 1)] =
+            (unsigned char)(128 + 100 * sin(index * 2 * M_PI / 200) + int(random() % 21) - 10);
+    converter.setCalibration(0.0, 20, 0.0, 1.0);
+    for (unsigned count : {20000u, unsigned(sineSize)}) {
+        ConversionParameters parameters;
+        parameters.count = count;
+        trigger.prepare(*sine, parameters, 0);
+        for (bool smooth : {false, true}) {
+            const unsigned sampleSet = smooth ? 10 : 1;
+            const unsigned threshold = smooth ? 5 : 0;
+            // all edges of the block and a level that is never reached (untriggered)
+            printf("  trigger %7u samples%s: all edges %7.3f ms, scalar %7.3f ms, untriggered %7.3f ms, scalar "
+                   "%7.3f ms\n",
+                   count, smooth ? ", smooth" : "        ",
+                   measureSearch(trigger, converter, 6.4, sampleSet, threshold, false),
+                   measureSearch(trigger, converter, 6.4, sampleSet, threshold, true),
+                   measureSearch(trigger, converter, 1e3, sampleSet, threshold, false),
+                   measureSearch(trigger, converter, 1e3, sampleSet, threshold, true));
+        }
+    }
+    pool.giveBack(sine);
+    pool.giveBack(rawData);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: GPL-2.0+
+
+// Stress test of USBStream and of the TransferTuner against a simulated device.
+// The simulated device produces a counting pattern with 48 MB/s and behaves like the FX2 of the
+// scope: packets that find no queued transfer and no room in its small FIFO are dropped.
+// The benchmark reads the stream block by block like HantekDsoControl and checks each block for
+// discontinuities of the pattern. It prints the sustained throughput, the dropped packet rate and
+// the number of gaps that were not flagged by the stream, the exit code is 1 if there were any.
+// With --transferTuning the TransferTuner measures its candidates instead, each completed transfer
+// costs the host some time, so small transfers have less headroom. The exit code is 1 if the
+// selected configuration lost data.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+#include "usb/transfertuner.h"
+#include "usb/usbdevicedefinitions.h"
+#include "usb/usbstream.h"
+#include "utils/threadscheduling.h"
+
+#define PACKET_SIZE 512         ///< HighSpeed bulk packet size
+#define DEVICE_FIFO_PACKETS 4   ///< The FX2 endpoint FIFO is quad buffered
+#define PATTERN_PERIOD 251      ///< Prime period of the test pattern, so lost packets break it
+#define HOST_COMPLETION_COST 50 ///< Simulated host time per completed transfer of the tuning in µs
+#define DEVICE_RATE 48e6        ///< Data rate of the simulated device in bytes per second
+
+namespace {
+
+/// \brief Produces packets with a fixed rate into the queued transfers like the scope does.
+class SimulatedDevice : public QThread {
+  public:
+    explicit SimulatedDevice(double rate) : rate(rate) {}
+
+    void submit(libusb_transfer *transfer) {
+        QMutexLocker locker(&lock);
+        queued.push_back(transfer);
+    }
+
+    void cancel(libusb_transfer *transfer) {
+        QMutexLocker locker(&lock);
+        if (transfer == current) {
+            current = nullptr;
+        } else {
+            auto it = std::find(queued.begin(), queued.end(), transfer);
+            if (it == queued.end())
+                return;
+            queued.erase(it);
+        }
+        transfer->status = LIBUSB_TRANSFER_CANCELLED;
+        transfer->actual_length = 0;
+        completed.push_back(transfer);
+        transferDone.wakeAll();
+    }
+
+    /// \brief Wait up to timeout ms for completed transfers and move them to list.
+    void takeCompleted(std::vector<libusb_transfer *> &list, unsigned timeout) {
+        QMutexLocker locker(&lock);
+        if (completed.empty())
+            transferDone.wait(&lock, timeout);
+        list.swap(completed);
+        completed.clear();
+    }
+
+    void requestStop() {
+        QMutexLocker locker(&lock);
+        stopRequested = true;
+    }
+
+    unsigned long long producedPackets = 0;
+    unsigned long long droppedPackets = 0;
+
+  protected:
+    void run() override {
+        QElapsedTimer timer;
+        timer.start();
+        unsigned long long fifo[DEVICE_FIFO_PACKETS]; // stream positions of the buffered packets
+        unsigned fifoCount = 0;
+        unsigned long long position = 0;
+        for (;;) {
+            const unsigned long long due = (unsigned long long)(timer.nsecsElapsed() * 1e-9 * rate / PACKET_SIZE);
+            {
+                QMutexLocker locker(&lock);
+                if (stopRequested)
+                    return;
+                for (; producedPackets < due; ++producedPackets, position += PACKET_SIZE) {
+                    if (fifoCount == DEVICE_FIFO_PACKETS) // no room, the ADC data is lost
+                        ++droppedPackets;
+                    else
+                        fifo[fifoCount++] = position;
+                    unsigned sent = 0;
+                    for (; sent < fifoCount && nextTransfer(); ++sent)
+                        sendPacket(fifo[sent]);
+                    std::copy(fifo + sent, fifo + fifoCount, fifo);
+                    fifoCount -= sent;
+                }
+            }
+            QThread::usleep(100);
+        }
+    }
+
+  private:
+    bool nextTransfer() {
+        if (!current && !queued.empty()) {
+            current = queued.front();
+            queued.erase(queued.begin());
+            current->actual_length = 0;
+        }
+        return current != nullptr;
+    }
+
+    void sendPacket(unsigned long long position) {
+        unsigned char *data = current->buffer + current->actual_length;
+        unsigned char value = (unsigned char)(position % PATTERN_PERIOD);
+        for (unsigned index = 0; index < PACKET_SIZE; ++index) {
+            data[index] = value;
+            if (++value == PATTERN_PERIOD)
+                value = 0;
+        }
+        current->actual_length += PACKET_SIZE;
+        if (current->actual_length >= current->length) {
+            current->status = LIBUSB_TRANSFER_COMPLETED;
+            completed.push_back(current);
+            current = nullptr;
+            transferDone.wakeAll();
+        }
+    }
+
+    const double rate;
+    QMutex lock;
+    QWaitCondition transferDone;
+    std::vector<libusb_transfer *> queued;
+    std::vector<libusb_transfer *> completed;
+    libusb_transfer *current = nullptr;
+    bool stopRequested = false;
+};
+
+
+/// \brief USBStream that talks to the SimulatedDevice instead of libusb.
+class SimulatedStream : public USBStream {
+  public:
+    /// \param completionCost Host time per completed transfer in µs, e.g. the interrupt and the callback.
+    explicit SimulatedStream(SimulatedDevice *device, unsigned completionCost = 0)
+        : USBStream(nullptr, nullptr, HANTEK_EP_IN), device(device), completionCost(completionCost) {}
+    ~SimulatedStream() override { stop(); }
+
+    int handleEvents(unsigned timeout) override {
+        device->takeCompleted(completed, timeout);
+        for (libusb_transfer *transfer : completed) {
+            if (completionCost)
+                QThread::usleep(completionCost);
+            transferCallback(transfer);
+        }
+        completed.clear();
+        return LIBUSB_SUCCESS;
+    }
+
+  protected:
+    int submitTransfer(libusb_transfer *transfer) override {
+        device->submit(transfer);
+        return LIBUSB_SUCCESS;
+    }
+
+    int cancelTransfer(libusb_transfer *transfer) override {
+        device->cancel(transfer);
+        return LIBUSB_SUCCESS;
+    }
+
+  private:
+    SimulatedDevice *device;
+    const unsigned completionCost;
+    std::vector<libusb_transfer *> completed;
+};
+
+
+bool isContinuous(const std::vector<unsigned char> &block) {
+    for (size_t index = 1; index < block.size(); ++index) {
+        unsigned char expected = block[index - 1] + 1;
+        if (expected == PATTERN_PERIOD)
+            expected = 0;
+        if (block[index] != expected)
+            return false;
+    }
+    return true;
+}
+
+
+
+int runStreamBenchmark(double rate, unsigned seconds, unsigned processingTime) {
+    const unsigned transferSize = HANTEK_STREAM_TRANSFER_SIZE_FAST;
+    const unsigned transferCount = HANTEK_STREAM_TRANSFERS_FAST;
+    const unsigned blockSize = 23 * 1024; // one record of 20000 samples plus the skipped start samples
+    printf("Stream benchmark: %.1f MB/s for %u s, %u transfers of %u bytes, blocks of %u bytes, "
+           "processing %u ms per block\n",
+           rate / 1e6, seconds, transferCount, transferSize, blockSize, processingTime);
+
+    SimulatedDevice device(rate);
+    SimulatedStream stream(&device);
+    stream.setExpectedRate(rate);
+    device.start(QThread::HighPriority);
+    int errorCode = stream.start(transferSize, transferCount, 2 * blockSize);
+    if (errorCode != LIBUSB_SUCCESS) {
+        printf("Starting the stream failed: %d\n", errorCode);
+        return 1;
+    }
+
+    std::vector<unsigned char> block(blockSize);
+    unsigned long long blocks = 0;
+    unsigned long long flagged = 0;
+    unsigned long long undetected = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < qint64(seconds) * 1000) {
+        bool gap = false;
+        stream.startBlock(); // each block is a capture of its own like in the acquisition
+        errorCode = stream.read(block.data(), blockSize, 1000, &gap);
+        if (errorCode < 0) {
+            printf("Reading the stream failed: %d\n", errorCode);
+            break;
+        }
+        ++blocks;
+        if (gap)
+            ++flagged;
+        else if (!isContinuous(block))
+            ++undetected;
+        if (processingTime)
+            QThread::msleep(processingTime);
+    }
+    const double elapsed = timer.nsecsElapsed() / 1e9;
+
+    stream.stop();
+    device.requestStop();
+    device.wait();
+
+    const double dropRate = device.producedPackets ? 100.0 * device.droppedPackets / device.producedPackets : 0.0;
+    printf("  sustained throughput  %.2f MB/s\n", blocks * blockSize / elapsed / 1e6);
+    printf("  blocks                %llu, flagged as corrupted %llu, undetected gaps %llu\n", blocks, flagged,
+           undetected);
+    printf("  dropped packets       %llu of %llu (%.4f %%)\n", device.droppedPackets, device.producedPackets,
+           dropRate);
+    printf("  detected gaps         %u\n", stream.getGaps());
+    printf("  longest completion interval %.2f ms\n", stream.getMaxCompletionInterval() * 1e-6);
+    printf("  FIFO overruns         %llu bytes\n", stream.getOverruns());
+    return undetected ? 1 : 0;
+}
+
+
+int runTransferTuning(double rate, unsigned processingTime) {
+    const unsigned blockSize = 23 * 1024;
+    printf("Transfer tuning: %.1f MB/s, blocks of %u bytes, processing %u ms per block, %u us per transfer\n",
+           rate / 1e6, blockSize, processingTime, HOST_COMPLETION_COST);
+
+    SimulatedDevice device(rate);
+    device.start(QThread::HighPriority);
+    TransferTuner tuner(
+        [&device]() { return std::unique_ptr<USBStream>(new SimulatedStream(&device, HOST_COMPLETION_COST)); },
+        rate, blockSize, processingTime);
+    const TransferConfig config = tuner.tune();
+    device.requestStop();
+    device.wait();
+
+    bool lossless = false;
+    for (const TransferTrial &trial : tuner.getTrials()) {
+        printf("  %2u x %6u bytes  %6.2f MB/s  latency %6.2f ms  headroom %5.1f  lost %llu  error %d\n",
+               trial.config.count, trial.config.size, trial.throughput / 1e6, trial.latency * 1e3,
+               trial.headroom(rate), trial.lost, trial.error);
+        if (trial.config.size == config.size && trial.config.count == config.count)
+            lossless = !trial.lost && !trial.error;
+    }
+    printf("  selected %u x %u bytes\n", config.count, config.size);
+    return lossless ? 0 : 1;
+}
+
+} // namespace
+
+
+int main(int argc, char *argv[]) {
+    QCoreApplication application(argc, argv);
+    QCommandLineParser p;
+    p.addHelpOption();
+    QCommandLineOption secondsOption("seconds", QCoreApplication::tr("Duration of the benchmark"),
+                                     QCoreApplication::tr("seconds"), "10");
+    p.addOption(secondsOption);
+    QCommandLineOption loadOption("load", QCoreApplication::tr("Simulated processing time per block"),
+                                  QCoreApplication::tr("ms"), "0");
+    p.addOption(loadOption);
+    QCommandLineOption transferTuningOption(
+        "transferTuning", QCoreApplication::tr("Tune the USB transfers instead, uses the processing time of --load"));
+    p.addOption(transferTuningOption);
+    QCommandLineOption priorityOption(
+        "priority", QCoreApplication::tr("Scheduling of the reading thread like --acquisitionPriority of OpenHantek"),
+        QCoreApplication::tr("policy"), "normal");
+    p.addOption(priorityOption);
+    QCommandLineOption cpusOption("cpus", QCoreApplication::tr("CPUs of the reading thread, e.g. 2,3 or 2-3"),
+                                  QCoreApplication::tr("cpus"));
+    p.addOption(cpusOption);
+    p.process(application);
+
+    ThreadScheduling scheduling;
+    if (!scheduling.parsePolicy(p.value(priorityOption)) || !scheduling.parseCpus(p.value(cpusOption))) {
+        qWarning() << "Invalid thread priority or CPU list";
+        return -1;
+    }
+    if (!scheduling.isDefault()) { // the stream is read like by the acquisition thread
+        QString message;
+        scheduling.apply(message);
+        qDebug() << "Scheduling:" << message;
+    }
+    if (p.isSet(transferTuningOption))
+        return runTransferTuning(DEVICE_RATE, p.value(loadOption).toUInt());
+    return runStreamBenchmark(DEVICE_RATE, p.value(secondsOption).toUInt(), p.value(loadOption).toUInt());
+}